@@ -209,6 +209,16 @@ struct s16info_s
 
   int qlen;
   int maxdlen;
+  int64_t qpad; /* paddings of the query and the targets, or -1 */
+  int64_t padlen;
+  int64_t * tpad;
+  bool padskip; /* rows are skipped in the current search16 call */
+  bool padfail; /* the last backtrack16 entered a skipped cell */
+  unsigned int padredone; /* targets aligned again by the last search16 */
+  int * dirrows; /* first and last row computed for each dir block */
+  uint64_t dirrowsalloc;
+  CELL scoremax; /* highest score of a pair of symbols, at least 0 */
+
   CELL penalty_gap_open_query_left;
   CELL penalty_gap_open_target_left;
   CELL penalty_gap_open_query_interior;
@@ -775,6 +785,20 @@ void aligncolumns_rest(VECTOR_SHORT * Sm,
   *_h_max = h_max;
 }
 
+/*
+  Set a single channel of a vector variable. Storing through a CELL
+  pointer into the vector breaks strict aliasing, and the optimizer is
+  then free to drop the store, so copy the value in and out instead.
+*/
+
+inline void v_set_channel(VECTOR_SHORT * v, int c, CELL value)
+{
+  CELL t[CHANNELS];
+  memcpy(t, v, sizeof(t));
+  t[c] = value;
+  memcpy(v, t, sizeof(t));
+}
+
 inline void pushop(s16info_s * s, char newop)
 {
   if (newop == s->op)
@@ -909,6 +933,18 @@ void backtrack16(s16info_s * s,
     {
       aligned++;
 
+      if (s->padskip)
+        {
+          /* give up at a cell not computed, see search16_padprep */
+          uint64_t block = ((offset + 16*s->qlen*(j/4)) % dirbuffersize) /
+            (16*s->qlen);
+          if ((i < s->dirrows[2*block]) || (i >= s->dirrows[2*block+1]))
+            {
+              s->padfail = true;
+              return;
+            }
+        }
+
       uint64_t d = *((uint64_t *) (dirbuffer +
                                    (offset + 16*s->qlen*(j/4) +
                                     16*i + 4*(j&3)) % dirbuffersize));
@@ -1024,6 +1060,15 @@ struct s16info_s * search16_init(CELL score_match,
   s->cigar = nullptr;
   s->cigarend = nullptr;
   s->cigaralloc = 0;
+  s->qpad = -1;
+  s->padlen = 0;
+  s->tpad = nullptr;
+  s->padskip = false;
+  s->padfail = false;
+  s->padredone = 0;
+  s->dirrows = nullptr;
+  s->dirrowsalloc = 0;
+  s->scoremax = 0;
 
   for(int i=0; i<16; i++)
     {
@@ -1044,6 +1089,7 @@ struct s16info_s * search16_init(CELL score_match,
             }
           ((CELL*)(&s->matrix))[16*i+j] = value;
           scorematrix[i][j] = value;
+          s->scoremax = MAX(s->scoremax, value);
         }
     }
 
@@ -1086,6 +1132,10 @@ void search16_exit(s16info_s * s)
     {
       xfree(s->dir);
     }
+  if (s->dirrows)
+    {
+      xfree(s->dirrows);
+    }
   if (s->hearray)
     {
       xfree(s->hearray);
@@ -1129,6 +1179,203 @@ void search16_qprep(s16info_s * s, char * qseq, int qlen)
     }
 }
 
+/* rows computed beyond the paddings, to keep alignments with indels
+   next to them inside the rows computed */
+#define PADMARGIN 16
+
+void search16_padprep(s16info_s * s, int64_t qpad, int64_t padlen,
+                      int64_t * tpad)
+{
+  /*
+    The query has a padding of padlen symbols starting at qpad, and
+    target number i one starting at tpad[i], or -1 if it has none.
+    Give -1 as qpad to align whole sequences again.
+
+    Cells where a part of the query before its padding meets a part of
+    a target after its padding, or the other way round, are then not
+    computed, which is about half of the matrix for read pairs joined
+    by the paddings. The cells next to them get the highest scores
+    the cells not computed could have instead, so that no score
+    computed is below the one of the whole matrix. If the backtracking
+    then stays in the cells computed, its path has the same score and
+    the same choices as in the whole matrix, ties included. Otherwise
+    the target is aligned again over the whole matrix.
+  */
+
+  s->qpad = qpad;
+  s->padlen = padlen;
+  s->tpad = tpad;
+}
+
+unsigned int search16_padredone(s16info_s * s)
+{
+  /* number of targets the last search16 call aligned again */
+  return s->padredone;
+}
+
+static void search16_rows(s16info_s * s,
+                          int64_t * seq_id,
+                          BYTE ** d_begin,
+                          BYTE ** d_address,
+                          int64_t * lo,
+                          int64_t * hi,
+                          int64_t * prev_lo,
+                          int64_t * prev_hi,
+                          VECTOR_SHORT * top)
+{
+  /*
+    Find the range of query rows to compute for the current four
+    columns of all channels, given the paddings. Rows that were not
+    computed for the previous columns get the highest scores they
+    could have to the left, and top gets the highest H and F values
+    the row above the first row computed could have.
+  */
+
+  int64_t qlen = s->qlen;
+
+  * lo = 0;
+  * hi = qlen;
+
+  if (! s->padskip)
+    {
+      return;
+    }
+
+  int64_t j0[CHANNELS];
+
+  * lo = qlen;
+  * hi = 0;
+
+  for(int c = 0; c < CHANNELS; c++)
+    {
+      j0[c] = 0;
+
+      if (seq_id[c] < 0)
+        {
+          continue;
+        }
+
+      int64_t tpad = s->tpad[seq_id[c]];
+      j0[c] = CDEPTH * ((d_begin[c] - d_address[c] - 1) / CDEPTH);
+      int64_t j1 = j0[c] + CDEPTH;
+
+      if (tpad < 0)
+        {
+          * lo = 0;
+          * hi = qlen;
+        }
+      else
+        {
+          /* columns after the target padding need no rows before the
+             query padding, and columns before it no rows after it */
+          * lo = MIN(* lo,
+                    (j0[c] >= tpad + s->padlen + PADMARGIN) ?
+                    MAX(s->qpad - PADMARGIN, 0) : 0);
+          * hi = MAX(* hi,
+                    (j1 + PADMARGIN <= tpad) ?
+                    MIN(s->qpad + s->padlen + PADMARGIN, qlen) : qlen);
+        }
+    }
+
+  if (* lo >= * hi)
+    {
+      * lo = 0;
+      * hi = qlen;
+    }
+
+  /* no path to cell (i,j) scores more than scoremax * min(i+1,j+1) */
+
+  CELL m = s->scoremax;
+  CELL qr_q_interior = s->penalty_gap_open_query_interior +
+    s->penalty_gap_extension_query_interior;
+  CELL qr_q_right = s->penalty_gap_open_query_right +
+    s->penalty_gap_extension_query_right;
+
+  VECTOR_SHORT * hep = s->hearray;
+  for(int64_t i = * lo; i < * hi; i++)
+    {
+      if ((i < * prev_lo) || (i >= * prev_hi))
+        {
+          CELL qr_q = (i == qlen - 1) ? qr_q_right : qr_q_interior;
+          for(int c = 0; c < CHANNELS; c++)
+            {
+              CELL h = m * MIN(i + 1, j0[c]);
+              v_set_channel(hep + 2 * i + 0, c, h);
+              v_set_channel(hep + 2 * i + 1, c, h - qr_q);
+            }
+        }
+    }
+
+  if (* lo > 0)
+    {
+      for(int c = 0; c < CHANNELS; c++)
+        {
+          for(int k = 0; k < CDEPTH; k++)
+            {
+              v_set_channel(top + k, c, m * MIN(* lo, j0[c] + k));
+              v_set_channel(top + CDEPTH + k, c,
+                            m * MIN(* lo, j0[c] + k + 1));
+            }
+        }
+
+      /* the cell above and to the left was computed with the previous
+         columns, and backtracking may go there */
+      if ((* lo > * prev_lo) && (* lo <= * prev_hi))
+        {
+          top[0] = hep[2 * (* lo - 1)];
+        }
+    }
+
+  * prev_lo = * lo;
+  * prev_hi = * hi;
+}
+
+static void search16_noquery(s16info_s * s,
+                             int64_t length,
+                             CELL * pscore,
+                             unsigned short * paligned,
+                             unsigned short * pmatches,
+                             unsigned short * pmismatches,
+                             unsigned short * pgaps,
+                             char ** pcigar)
+{
+  /* align an empty query to a target of the given length */
+
+  * paligned = length;
+  * pmatches = 0;
+  * pmismatches = 0;
+  * pgaps = length;
+
+  if (length == 0)
+    {
+      * pscore = 0;
+    }
+  else
+    {
+      * pscore =
+        MAX(- s->penalty_gap_open_target_left -
+            length * s->penalty_gap_extension_target_left,
+            - s->penalty_gap_open_target_right -
+            length * s->penalty_gap_extension_target_right);
+    }
+
+  char * cigar = nullptr;
+  if (length > 0)
+    {
+      int ret = xsprintf(&cigar, "%ldI", length);
+      if ((ret < 2) || !cigar)
+        {
+          fatal("Unable to allocate enough memory.");
+        }
+    }
+  else
+    {
+      cigar = (char *) xmalloc(1);
+      cigar[0] = 0;
+    }
+  * pcigar = cigar;
+}
+
 void search16(s16info_s * s,
               unsigned int sequences,
               unsigned int * seqnos,
@@ -1148,42 +1395,13 @@ void search16(s16info_s * s,
     {
       for (unsigned int cand_id = 0; cand_id < sequences; cand_id++)
         {
-          unsigned int seqno = seqnos[cand_id];
-          int64_t length = db_getsequencelen(seqno);
-
-          paligned[cand_id] = length;
-          pmatches[cand_id] = 0;
-          pmismatches[cand_id] = 0;
-          pgaps[cand_id] = length;
-
-          if (length == 0)
-            {
-              pscores[cand_id] = 0;
-            }
-          else
-            {
-              pscores[cand_id] =
-                MAX(- s->penalty_gap_open_target_left -
-                    length * s->penalty_gap_extension_target_left,
-                    - s->penalty_gap_open_target_right -
-                    length * s->penalty_gap_extension_target_right);
-            }
-
-          char * cigar = nullptr;
-          if (length > 0)
-            {
-              int ret = xsprintf(&cigar, "%ldI", length);
-              if ((ret < 2) || !cigar)
-                {
-                  fatal("Unable to allocate enough memory.");
-                }
-            }
-          else
-            {
-              cigar = (char *) xmalloc(1);
-              cigar[0] = 0;
-            }
-          pcigar[cand_id] = cigar;
+          search16_noquery(s, db_getsequencelen(seqnos[cand_id]),
+                           pscores + cand_id,
+                           paligned + cand_id,
+                           pmatches + cand_id,
+                           pmismatches + cand_id,
+                           pgaps + cand_id,
+                           pcigar + cand_id);
         }
       return;
     }
@@ -1219,6 +1437,27 @@ void search16(s16info_s * s,
 
   unsigned short * dirbuffer = s->dir;
 
+  /* skip rows beyond the paddings only while no score can overflow */
+  s->padskip = (s->qpad >= 0) && (s->scoremax * qlen < SHRT_MAX / 2);
+  s->padredone = 0;
+  bool * redo = nullptr;
+
+  if (s->padskip)
+    {
+      /* first and last row computed for each four columns in dir */
+      if ((uint64_t) s->maxdlen / 2 > s->dirrowsalloc)
+        {
+          s->dirrowsalloc = s->maxdlen / 2;
+          if (s->dirrows)
+            {
+              xfree(s->dirrows);
+            }
+          s->dirrows = (int *) xmalloc(s->dirrowsalloc * sizeof(int));
+        }
+      redo = (bool *) xmalloc(sequences * sizeof(bool));
+      memset(redo, 0, sequences * sizeof(bool));
+    }
+
   if (s->qlen + s->maxdlen + 1 > s->cigaralloc)
     {
       s->cigaralloc = s->qlen + s->maxdlen + 1;
@@ -1344,6 +1583,13 @@ void search16(s16info_s * s,
 
   unsigned short * dir = dirbuffer;
 
+  /* rows to compute for the current and the previous columns */
+  int64_t lo = 0;
+  int64_t hi = qlen;
+  int64_t prev_lo = 0;
+  int64_t prev_hi = 0;
+  VECTOR_SHORT top[2 * CDEPTH];
+
   while(true)
     {
       if (easy)
@@ -1412,17 +1658,36 @@ void search16(s16info_s * s,
 
           VECTOR_SHORT h_min, h_max;
 
-          aligncolumns_rest(S, hep, qp,
+          search16_rows(s, seq_id, d_begin, d_address,
+                        & lo, & hi, & prev_lo, & prev_hi, top);
+
+          if (s->padskip)
+            {
+              uint64_t block = (dir - dirbuffer) / (16 * qlen);
+              s->dirrows[2 * block + 0] = lo;
+              s->dirrows[2 * block + 1] = hi;
+            }
+
+          /* the last row computed has the query end penalties only if
+             it is the last query row, and the row above the first row
+             computed has the highest values it could have */
+          bool end = (hi == (int64_t) qlen);
+          bool first = (lo == 0);
+
+          aligncolumns_rest(S, hep + 2 * lo, qp + lo,
                             QR_query_interior, R_query_interior,
-                            QR_query_right, R_query_right,
+                            end ? QR_query_right : QR_query_interior,
+                            end ? R_query_right : R_query_interior,
                             QR_target[0], R_target[0],
                             QR_target[1], R_target[1],
                             QR_target[2], R_target[2],
                             QR_target[3], R_target[3],
-                            H0, H1, H2, H3,
-                            F0, F1, F2, F3,
+                            first ? H0 : top[0], first ? H1 : top[1],
+                            first ? H2 : top[2], first ? H3 : top[3],
+                            first ? F0 : top[4], first ? F1 : top[5],
+                            first ? F2 : top[6], first ? F3 : top[7],
                             & h_min, & h_max,
-                            qlen, dir);
+                            hi - lo, dir + 16 * lo);
 
           VECTOR_SHORT h_min_vector;
           VECTOR_SHORT h_max_vector;
@@ -1491,7 +1756,11 @@ void search16(s16info_s * s,
                       int64_t z = (dbseqlen+3) % 4;
                       int64_t score = ((CELL*)S)[z*CHANNELS+c];
 
-                      if (overflow[c])
+                      if (overflow[c] && s->padskip)
+                        {
+                          redo[cand_id] = true;
+                        }
+                      else if (overflow[c])
                         {
                           pscores[cand_id] = SHRT_MAX;
                           paligned[cand_id] = 0;
@@ -1503,14 +1772,22 @@ void search16(s16info_s * s,
                       else
                         {
                           pscores[cand_id] = score;
+                          s->padfail = false;
                           backtrack16(s, dbseq, dbseqlen, d_offset[c], c,
                                       paligned + cand_id,
                                       pmatches + cand_id,
                                       pmismatches + cand_id,
                                       pgaps + cand_id);
-                          pcigar[cand_id] =
-                            (char *) xmalloc(strlen(s->cigar)+1);
-                          strcpy(pcigar[cand_id], s->cigar);
+                          if (s->padfail)
+                            {
+                              redo[cand_id] = true;
+                            }
+                          else
+                            {
+                              pcigar[cand_id] =
+                                (char *) xmalloc(strlen(s->cigar)+1);
+                              strcpy(pcigar[cand_id], s->cigar);
+                            }
                         }
 
                       done++;
@@ -1548,22 +1825,22 @@ void search16(s16info_s * s,
                       d_offset[c] = dir - dirbuffer;
                       overflow[c] = false;
 
-                      ((CELL*)&H0)[c] = 0;
-                      ((CELL*)&H1)[c] = - s->penalty_gap_open_query_left
-                        - 1*s->penalty_gap_extension_query_left;
-                      ((CELL*)&H2)[c] = - s->penalty_gap_open_query_left
-                        - 2*s->penalty_gap_extension_query_left;
-                      ((CELL*)&H3)[c] = - s->penalty_gap_open_query_left
-                        - 3*s->penalty_gap_extension_query_left;
-
-                      ((CELL*)&F0)[c] = - s->penalty_gap_open_query_left
-                        - 1*s->penalty_gap_extension_query_left;
-                      ((CELL*)&F1)[c] = - s->penalty_gap_open_query_left
-                        - 2*s->penalty_gap_extension_query_left;
-                      ((CELL*)&F2)[c] = - s->penalty_gap_open_query_left
-                        - 3*s->penalty_gap_extension_query_left;
-                      ((CELL*)&F3)[c] = - s->penalty_gap_open_query_left
-                        - 4*s->penalty_gap_extension_query_left;
+                      v_set_channel(&H0, c, 0);
+                      v_set_channel(&H1, c, - s->penalty_gap_open_query_left
+                        - 1*s->penalty_gap_extension_query_left);
+                      v_set_channel(&H2, c, - s->penalty_gap_open_query_left
+                        - 2*s->penalty_gap_extension_query_left);
+                      v_set_channel(&H3, c, - s->penalty_gap_open_query_left
+                        - 3*s->penalty_gap_extension_query_left);
+
+                      v_set_channel(&F0, c, - s->penalty_gap_open_query_left
+                        - 1*s->penalty_gap_extension_query_left);
+                      v_set_channel(&F1, c, - s->penalty_gap_open_query_left
+                        - 2*s->penalty_gap_extension_query_left);
+                      v_set_channel(&F2, c, - s->penalty_gap_open_query_left
+                        - 3*s->penalty_gap_extension_query_left);
+                      v_set_channel(&F3, c, - s->penalty_gap_open_query_left
+                        - 4*s->penalty_gap_extension_query_left);
 
                       /* fill channel */
 
@@ -1661,21 +1938,37 @@ void search16(s16info_s * s,
 
           VECTOR_SHORT h_min, h_max;
 
-          aligncolumns_first(S, hep, qp,
+          search16_rows(s, seq_id, d_begin, d_address,
+                        & lo, & hi, & prev_lo, & prev_hi, top);
+
+          if (s->padskip)
+            {
+              uint64_t block = (dir - dirbuffer) / (16 * qlen);
+              s->dirrows[2 * block + 0] = lo;
+              s->dirrows[2 * block + 1] = hi;
+            }
+
+          bool end = (hi == (int64_t) qlen);
+          bool first = (lo == 0);
+
+          aligncolumns_first(S, hep + 2 * lo, qp + lo,
                              QR_query_interior, R_query_interior,
-                             QR_query_right, R_query_right,
+                             end ? QR_query_right : QR_query_interior,
+                             end ? R_query_right : R_query_interior,
                              QR_target[0], R_target[0],
                              QR_target[1], R_target[1],
                              QR_target[2], R_target[2],
                              QR_target[3], R_target[3],
-                             H0, H1, H2, H3,
-                             F0, F1, F2, F3,
+                             first ? H0 : top[0], first ? H1 : top[1],
+                             first ? H2 : top[2], first ? H3 : top[3],
+                             first ? F0 : top[4], first ? F1 : top[5],
+                             first ? F2 : top[6], first ? F3 : top[7],
                              & h_min, & h_max,
                              M,
                              M_QR_target_left, M_R_target_left,
                              M_QR_query_interior,
-                             M_QR_query_right,
-                             qlen, dir);
+                             end ? M_QR_query_right : M_QR_query_interior,
+                             hi - lo, dir + 16 * lo);
 
           VECTOR_SHORT h_min_vector;
           VECTOR_SHORT h_max_vector;
@@ -1713,4 +2006,71 @@ void search16(s16info_s * s,
           dir -= dirbuffersize;
         }
     }
+
+  if (s->padskip)
+    {
+      /* align the targets again whose backtracking entered a cell
+         not computed, or whose scores overflowed, over the whole
+         matrix, all together */
+
+      s->padskip = false;
+
+      unsigned int count = 0;
+      for(unsigned int cand_id = 0; cand_id < sequences; cand_id++)
+        {
+          if (redo[cand_id])
+            {
+              count++;
+            }
+        }
+
+      if (count > 0)
+        {
+          auto * rseqnos = (unsigned int *)
+            xmalloc(count * sizeof(unsigned int));
+          auto * rscores = (CELL *) xmalloc(count * sizeof(CELL));
+          auto * rstats = (unsigned short *)
+            xmalloc(4 * count * sizeof(unsigned short));
+          auto * rcigar = (char **) xmalloc(count * sizeof(char *));
+
+          unsigned int r = 0;
+          for(unsigned int cand_id = 0; cand_id < sequences; cand_id++)
+            {
+              if (redo[cand_id])
+                {
+                  rseqnos[r++] = seqnos[cand_id];
+                }
+            }
+
+          int64_t qpad = s->qpad;
+          s->qpad = -1;
+          search16(s, count, rseqnos, rscores,
+                   rstats, rstats + count, rstats + 2 * count,
+                   rstats + 3 * count, rcigar);
+          s->qpad = qpad;
+
+          r = 0;
+          for(unsigned int cand_id = 0; cand_id < sequences; cand_id++)
+            {
+              if (redo[cand_id])
+                {
+                  pscores[cand_id] = rscores[r];
+                  paligned[cand_id] = rstats[r];
+                  pmatches[cand_id] = rstats[count + r];
+                  pmismatches[cand_id] = rstats[2 * count + r];
+                  pgaps[cand_id] = rstats[3 * count + r];
+                  pcigar[cand_id] = rcigar[r];
+                  r++;
+                }
+            }
+
+          xfree(rseqnos);
+          xfree(rscores);
+          xfree(rstats);
+          xfree(rcigar);
+        }
+
+      s->padredone = count;
+      xfree(redo);
+    }
 }
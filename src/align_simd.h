@@ -88,6 +88,13 @@ search16_exit(s16info_s * s);
 void
 search16_qprep(s16info_s * s, char * qseq, int qlen);
 
+void
+search16_padprep(s16info_s * s, int64_t qpad, int64_t padlen,
+                 int64_t * tpad);
+
+unsigned int
+search16_padredone(s16info_s * s);
+
 void
 search16(s16info_s * s,
          unsigned int sequences,
@@ -394,17 +394,18 @@ void allpairs_thread_run(int64_t t)
             {
               /* perform alignments */
 
+              si->qpadpos = search_padpos(si->qsequence, si->qseqlen);
               search16_qprep(si->s, si->qsequence, si->qseqlen);
 
-              search16(si->s,
-                       si->hit_count,
-                       pseqnos,
-                       pscores,
-                       paligned,
-                       pmatches,
-                       pmismatches,
-                       pgaps,
-                       pcigar);
+              search_align16(si,
+                             si->hit_count,
+                             pseqnos,
+                             pscores,
+                             paligned,
+                             pmatches,
+                             pmismatches,
+                             pgaps,
+                             pcigar);
 
               /* convert to hit structure */
               for (int h = 0; h < si->hit_count; h++)
@@ -165,14 +165,14 @@ void arch_get_user_system_time(double * user_time, double * system_time)
 #endif
 }
 
-void arch_srandom()
+uint64_t arch_random_seed()
 {
-  /* initialize pseudo-random number generator */
-  unsigned int seed = opt_randseed;
+  /* seed for the pseudo-random number generator */
+  uint64_t seed = opt_randseed;
   if (seed == 0)
     {
 #ifdef _WIN32
-      srand(GetTickCount());
+      seed = GetTickCount64();
 #else
       int fd = open("/dev/urandom", O_RDONLY);
       if (fd < 0)
@@ -184,26 +184,9 @@ void arch_srandom()
           fatal("Unable to read from /dev/urandom");
         }
       close(fd);
-      srandom(seed);
 #endif
     }
-  else
-    {
-#ifdef _WIN32
-      srand(seed);
-#else
-      srandom(seed);
-#endif
-    }
-}
-
-uint64_t arch_random()
-{
-#ifdef _WIN32
-  return rand();
-#else
-  return random();
-#endif
+  return seed;
 }
 
 void * xmalloc(size_t size)
@@ -262,6 +245,414 @@ void xfree(void * ptr)
     }
 }
 
+/*
+  Large tables. The k-mer index and the k-mer counters of the search
+  threads are read at random positions, so with --hugepages they are
+  backed by huge pages to save TLB misses: explicit ones if the system
+  has some reserved, otherwise transparent huge pages (madvise). With
+  --numa_interleave, the pages of the tables shared by all threads are
+  spread over the NUMA nodes, so that threads on every node see the
+  same average latency and the memory bandwidth of all nodes is used.
+  The tables of a single thread are left to the first touch policy,
+  which puts them on the node of the thread. Both are only available
+  on Linux, and tables smaller than one huge page use xmalloc until
+  they grow beyond it.
+*/
+
+#define ARCH_LARGE_PAGE (2UL << 20)
+#define ARCH_NODES_MAX 1024
+#define ARCH_MASK_BITS (8 * sizeof(unsigned long))
+
+#ifndef MPOL_INTERLEAVE
+#define MPOL_INTERLEAVE 3
+#endif
+
+static std::map<void *, size_t> arch_large_maps;
+static pthread_mutex_t arch_large_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t arch_large_hugetlb = 0;
+static uint64_t arch_large_thp = 0;
+static int arch_nodes = -1;
+static unsigned long arch_nodemask[ARCH_NODES_MAX / ARCH_MASK_BITS];
+
+static bool arch_parse_list(const char * filename,
+                            void (*add)(unsigned int, void *),
+                            void * data)
+{
+  /* parse a list of ranges like "0-3,8,10-11" from a sysfs file */
+
+  FILE * fp = fopen(filename, "r");
+  if (! fp)
+    {
+      return false;
+    }
+  char line[4096];
+  bool ok = fgets(line, sizeof(line), fp) != nullptr;
+  fclose(fp);
+  if (! ok)
+    {
+      return false;
+    }
+
+  char * p = line;
+  while ((*p >= '0') && (*p <= '9'))
+    {
+      unsigned int first = strtoul(p, & p, 10);
+      unsigned int last = first;
+      if (*p == '-')
+        {
+          last = strtoul(p + 1, & p, 10);
+        }
+      for(unsigned int i = first; i <= last; i++)
+        {
+          add(i, data);
+        }
+      if (*p == ',')
+        {
+          p++;
+        }
+    }
+  return true;
+}
+
+static void arch_node_add(unsigned int node, void * data)
+{
+  (void) data;
+  if (node < ARCH_NODES_MAX)
+    {
+      arch_nodemask[node / ARCH_MASK_BITS] |= 1UL << (node % ARCH_MASK_BITS);
+      arch_nodes++;
+    }
+}
+
+static int arch_get_nodes()
+{
+  /* number of online NUMA nodes, with their mask in arch_nodemask */
+
+  if (arch_nodes < 0)
+    {
+      arch_nodes = 0;
+      memset(arch_nodemask, 0, sizeof(arch_nodemask));
+      if ((! arch_parse_list("/sys/devices/system/node/online",
+                             arch_node_add, nullptr)) ||
+          (arch_nodes == 0))
+        {
+          arch_nodes = 1;
+          arch_nodemask[0] = 1;
+        }
+    }
+  return arch_nodes;
+}
+
+static bool arch_large_mapped(size_t size, bool shared)
+{
+  /* true if a table of this size is mapped rather than allocated */
+
+#ifdef __linux__
+  return (opt_hugepages || (shared && opt_numa_interleave)) &&
+    (size >= ARCH_LARGE_PAGE);
+#else
+  (void) size;
+  (void) shared;
+  return false;
+#endif
+}
+
+void * xmalloc_large(size_t size, bool shared)
+{
+  /*
+    Allocate a large table, see above. Shared tables are read by all
+    threads and may be interleaved over the NUMA nodes.
+  */
+
+#ifdef __linux__
+  if (! arch_large_mapped(size, shared))
+    {
+      return xmalloc(size);
+    }
+
+  size_t length = (size + ARCH_LARGE_PAGE - 1) & ~ (ARCH_LARGE_PAGE - 1);
+  void * t = MAP_FAILED;
+
+  if (opt_hugepages)
+    {
+      t = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    }
+
+  bool hugetlb = t != MAP_FAILED;
+  bool thp = false;
+
+  if (! hugetlb)
+    {
+      t = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (t == MAP_FAILED)
+        {
+          fatal("Unable to allocate enough memory.");
+        }
+      thp = opt_hugepages && (madvise(t, length, MADV_HUGEPAGE) == 0);
+    }
+
+  if (shared && opt_numa_interleave && (arch_get_nodes() > 1))
+    {
+      /* may fail without harm, e.g. if not permitted */
+      syscall(SYS_mbind, t, length, MPOL_INTERLEAVE,
+              arch_nodemask, (unsigned long) ARCH_NODES_MAX, 0);
+    }
+
+  xpthread_mutex_lock(& arch_large_mutex);
+  arch_large_maps[t] = length;
+  if (hugetlb)
+    {
+      arch_large_hugetlb += length;
+    }
+  if (thp)
+    {
+      arch_large_thp += length;
+    }
+  xpthread_mutex_unlock(& arch_large_mutex);
+
+  return t;
+#else
+  (void) shared;
+  return xmalloc(size);
+#endif
+}
+
+static size_t arch_large_size(void * ptr)
+{
+  /* mapped length of a large table, or 0 if allocated by xmalloc */
+
+  size_t length = 0;
+  xpthread_mutex_lock(& arch_large_mutex);
+  auto it = arch_large_maps.find(ptr);
+  if (it != arch_large_maps.end())
+    {
+      length = it->second;
+    }
+  xpthread_mutex_unlock(& arch_large_mutex);
+  return length;
+}
+
+void * xrealloc_large(void * ptr, size_t oldsize, size_t size)
+{
+  /*
+    Tables only change size while the index is built, keep them
+    shared. A table that started below the size of a huge page is
+    moved to a mapping when it grows beyond it, and one that is
+    already mapped stays in place if the mapped length still fits.
+  */
+
+  size_t length = arch_large_size(ptr);
+  bool mapped = arch_large_mapped(size, true);
+  if ((length == 0) && ! mapped)
+    {
+      return xrealloc(ptr, size);
+    }
+  if (mapped &&
+      (length == ((size + ARCH_LARGE_PAGE - 1) & ~ (ARCH_LARGE_PAGE - 1))))
+    {
+      return ptr;
+    }
+  void * t = xmalloc_large(size, true);
+  memcpy(t, ptr, MIN(size, oldsize));
+  xfree_large(ptr);
+  return t;
+}
+
+void xfree_large(void * ptr)
+{
+#ifdef __linux__
+  size_t length = arch_large_size(ptr);
+  if (length)
+    {
+      xpthread_mutex_lock(& arch_large_mutex);
+      arch_large_maps.erase(ptr);
+      xpthread_mutex_unlock(& arch_large_mutex);
+      munmap(ptr, length);
+      return;
+    }
+#endif
+  xfree(ptr);
+}
+
+void arch_large_report(const char * name, uint64_t size)
+{
+  /* report the backing of a table, or of several, of the given size */
+
+  if (! (opt_hugepages || opt_numa_interleave))
+    {
+      return;
+    }
+
+  const char * pages = "normal pages";
+  if (opt_hugepages)
+    {
+      if (arch_large_hugetlb)
+        {
+          pages = "huge pages";
+        }
+      else if (arch_large_thp)
+        {
+          pages = "transparent huge pages";
+        }
+      else
+        {
+          pages = "normal pages (no huge pages available)";
+        }
+    }
+
+  int nodes = opt_numa_interleave ? arch_get_nodes() : 1;
+
+  for(int i = 0; i < 2; i++)
+    {
+      FILE * fp = i ? fp_log : stderr;
+      if ((! fp) || ((! i) && opt_quiet))
+        {
+          continue;
+        }
+      fprintf(fp, "%s: %.1f MB in %s", name, size / 1048576.0, pages);
+      if (nodes > 1)
+        {
+          fprintf(fp, ", interleaved over %d NUMA nodes", nodes);
+        }
+      fprintf(fp, "\n");
+    }
+}
+
+/*
+  Thread pinning (--pin_threads). Worker threads are bound to single
+  CPUs among those the process may use, taking the NUMA nodes in turn
+  so that the threads are spread evenly over the nodes.
+*/
+
+static int * arch_pin_cpus = nullptr;
+static int arch_pin_count = 0;
+
+struct arch_cpulist_s
+{
+  int * cpus;
+  int count;
+};
+
+static void arch_cpu_add(unsigned int cpu, void * data)
+{
+  auto * list = (struct arch_cpulist_s *) data;
+  list->cpus = (int *) xrealloc(list->cpus, (list->count + 1) * sizeof(int));
+  list->cpus[list->count++] = cpu;
+}
+
+void arch_pin_init()
+{
+#ifdef __linux__
+  if (! opt_pin_threads)
+    {
+      return;
+    }
+
+  cpu_set_t allowed;
+  CPU_ZERO(& allowed);
+  if (sched_getaffinity(0, sizeof(allowed), & allowed) != 0)
+    {
+      return;
+    }
+
+  /* the allowed cpus of each node */
+  int nodes = arch_get_nodes();
+  auto * lists = (struct arch_cpulist_s *)
+    xmalloc(nodes * sizeof(struct arch_cpulist_s));
+  int listcount = 0;
+  for(int node = 0; (node < ARCH_NODES_MAX) && (listcount < nodes); node++)
+    {
+      if (! (arch_nodemask[node / ARCH_MASK_BITS] &
+             (1UL << (node % ARCH_MASK_BITS))))
+        {
+          continue;
+        }
+      struct arch_cpulist_s all = { nullptr, 0 };
+      char filename[64];
+      snprintf(filename, sizeof(filename),
+               "/sys/devices/system/node/node%d/cpulist", node);
+      arch_parse_list(filename, arch_cpu_add, & all);
+      struct arch_cpulist_s * list = lists + listcount++;
+      list->cpus = nullptr;
+      list->count = 0;
+      for(int i = 0; i < all.count; i++)
+        {
+          if ((all.cpus[i] < CPU_SETSIZE) && CPU_ISSET(all.cpus[i], & allowed))
+            {
+              arch_cpu_add(all.cpus[i], list);
+            }
+        }
+      xfree(all.cpus);
+    }
+
+  /* take the nodes in turn */
+  arch_pin_cpus = (int *) xmalloc(CPU_SETSIZE * sizeof(int));
+  arch_pin_count = 0;
+  bool more = true;
+  for(int i = 0; more; i++)
+    {
+      more = false;
+      for(int n = 0; n < listcount; n++)
+        {
+          if (i < lists[n].count)
+            {
+              arch_pin_cpus[arch_pin_count++] = lists[n].cpus[i];
+              more = true;
+            }
+        }
+    }
+
+  /* without node information, use the allowed cpus in order */
+  if (arch_pin_count == 0)
+    {
+      for(int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        {
+          if (CPU_ISSET(cpu, & allowed))
+            {
+              arch_pin_cpus[arch_pin_count++] = cpu;
+            }
+        }
+    }
+
+  for(int n = 0; n < listcount; n++)
+    {
+      xfree(lists[n].cpus);
+    }
+  xfree(lists);
+
+  for(int i = 0; i < 2; i++)
+    {
+      FILE * fp = i ? fp_log : stderr;
+      if ((! fp) || ((! i) && opt_quiet))
+        {
+          continue;
+        }
+      fprintf(fp, "Pinning threads to %d CPUs on %d NUMA node%s\n",
+              arch_pin_count, nodes, nodes > 1 ? "s" : "");
+    }
+#endif
+}
+
+void arch_pin_thread(int64_t t)
+{
+  /* bind the calling worker thread number t to its cpu */
+
+#ifdef __linux__
+  if (arch_pin_count == 0)
+    {
+      return;
+    }
+  cpu_set_t set;
+  CPU_ZERO(& set);
+  CPU_SET(arch_pin_cpus[t % arch_pin_count], & set);
+  pthread_setaffinity_np(pthread_self(), sizeof(set), & set);
+#else
+  (void) t;
+#endif
+}
+
 int xfstat(int fd, xstat_t * buf)
 {
 #ifdef _WIN32
@@ -320,6 +711,43 @@ int xopen_write(const char * path)
 #endif
 }
 
+uint64_t xpwrite(int fd, const void * buf, uint64_t nbyte, uint64_t offset)
+{
+  /* write at the given offset, leaving the file position alone, so that
+     threads may write to different parts of the file at the same time;
+     returns the number of bytes written */
+
+  uint64_t done = 0;
+  while (done < nbyte)
+    {
+      uint64_t rem = MIN(nbyte - done, (uint64_t) 1 << 30);
+#ifdef _WIN32
+      OVERLAPPED ov;
+      memset(& ov, 0, sizeof(OVERLAPPED));
+      ov.Offset = (DWORD) (offset + done);
+      ov.OffsetHigh = (DWORD) ((offset + done) >> 32);
+      DWORD written = 0;
+      if (! WriteFile((HANDLE) _get_osfhandle(fd),
+                      ((const char *) buf) + done,
+                      (DWORD) rem,
+                      & written,
+                      & ov))
+        {
+          break;
+        }
+      int64_t res = written;
+#else
+      int64_t res = pwrite(fd, ((const char *) buf) + done, rem, offset + done);
+#endif
+      if (res <= 0)
+        {
+          break;
+        }
+      done += res;
+    }
+  return done;
+}
+
 const char * xstrcasestr(const char * haystack, const char * needle)
 {
 #ifdef _WIN32
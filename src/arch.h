@@ -71,11 +71,16 @@ uint64_t arch_get_memused();
 uint64_t arch_get_memtotal();
 long arch_get_cores();
 void arch_get_user_system_time(double * user_time, double * system_time);
-void arch_srandom();
-uint64_t arch_random();
+uint64_t arch_random_seed();
 void * xmalloc(size_t size);
 void * xrealloc(void * ptr, size_t size);
 void xfree(void * ptr);
+void * xmalloc_large(size_t size, bool shared);
+void * xrealloc_large(void * ptr, size_t oldsize, size_t size);
+void xfree_large(void * ptr);
+void arch_large_report(const char * name, uint64_t size);
+void arch_pin_init();
+void arch_pin_thread(int64_t t);
 
 int xfstat(int fd, xstat_t * buf);
 int xstat(const char * path, xstat_t  * buf);
@@ -84,6 +89,7 @@ uint64_t xftello(FILE * stream);
 
 int xopen_read(const char * path);
 int xopen_write(const char * path);
+uint64_t xpwrite(int fd, const void * buf, uint64_t nbyte, uint64_t offset);
 
 const char * xstrcasestr(const char * haystack, const char * needle);
 
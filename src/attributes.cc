@@ -134,20 +134,126 @@ bool header_find_attribute(const char * header,
   return false;
 }
 
+static bool header_field_is_attribute(const char * field,
+                                      int field_length,
+                                      const char * attribute,
+                                      int attribute_length,
+                                      bool allow_decimal)
+{
+  /* check for attribute followed by at least one digit (or dot) only */
+
+  if ((field_length <= attribute_length) ||
+      memcmp(field, attribute, attribute_length))
+    {
+      return false;
+    }
+
+  for(int i = attribute_length; i < field_length; i++)
+    {
+      char c = field[i];
+      if (! (((c >= '0') && (c <= '9')) || (allow_decimal && (c == '.'))))
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+void header_scan_attributes(const char * header,
+                            int header_length,
+                            struct header_attributes_s * attributes)
+{
+  /*
+    Record the spans of the first size= and ee= annotations in a single
+    pass over the semicolon-separated fields of the header. The spans
+    are the same as those found by header_find_attribute.
+  */
+
+  attributes->size_start = 0;
+  attributes->size_end = 0;
+  attributes->ee_start = 0;
+  attributes->ee_end = 0;
+
+  if (! header)
+    {
+      return;
+    }
+
+  int i = 0;
+  while (i < header_length)
+    {
+      auto * semicolon =
+        (const char *) memchr(header + i, ';', header_length - i);
+      int field_end = semicolon ? semicolon - header : header_length;
+      int field_length = field_end - i;
+
+      if ((attributes->size_end == 0) &&
+          header_field_is_attribute(header + i, field_length,
+                                    "size=", 5, false))
+        {
+          attributes->size_start = i;
+          attributes->size_end = field_end;
+        }
+      else if ((attributes->ee_end == 0) &&
+               header_field_is_attribute(header + i, field_length,
+                                         "ee=", 3, true))
+        {
+          attributes->ee_start = i;
+          attributes->ee_end = field_end;
+        }
+
+      i = field_end + 1;
+    }
+}
+
+bool header_find_field_value(const char * header,
+                             int header_length,
+                             const char * name,
+                             int * start,
+                             int * end)
+{
+  /*
+    Find the value of the first field of the form name=value, where
+    name includes the equal sign and value may be empty, i.e. the first
+    match of (^|;)name([^;]*)($|;). Start and end delimit the value.
+  */
+
+  int nlen = strlen(name);
+
+  int i = 0;
+  while (i <= header_length)
+    {
+      auto * semicolon =
+        (const char *) memchr(header + i, ';', header_length - i);
+      int field_end = semicolon ? semicolon - header : header_length;
+
+      if ((field_end - i >= nlen) && ! memcmp(header + i, name, nlen))
+        {
+          * start = i + nlen;
+          * end = field_end;
+          return true;
+        }
+
+      i = field_end + 1;
+    }
+  return false;
+}
+
 int64_t header_get_size(char * header, int header_length)
+{
+  struct header_attributes_s attributes;
+  header_scan_attributes(header, header_length, & attributes);
+  return header_get_size_attributes(header, & attributes);
+}
+
+int64_t header_get_size_attributes(char * header,
+                                   struct header_attributes_s * attributes)
 {
   /* read size/abundance annotation */
   int64_t abundance = 0;
-  int start = 0;
-  int end = 0;
-  if (header_find_attribute(header,
-                            header_length,
-                            "size=",
-                            & start,
-                            & end,
-                            false))
+  if (attributes->size_end > 0)
     {
-      int64_t number = atol(header + start + 5);
+      int64_t number = atol(header + attributes->size_start + 5);
       if (number > 0)
         {
           abundance = number;
@@ -166,97 +272,90 @@ void header_fprint_strip_size_ee(FILE * fp,
                                  bool strip_size,
                                  bool strip_ee)
 {
-  int attributes = 0;
+  if (! (strip_size || strip_ee))
+    {
+      fwrite(header, 1, header_length, fp);
+      return;
+    }
+
+  struct header_attributes_s attributes;
+  header_scan_attributes(header, header_length, & attributes);
+  header_fprint_strip_attributes(fp,
+                                 header,
+                                 header_length,
+                                 & attributes,
+                                 strip_size,
+                                 strip_ee);
+}
+
+void header_fprint_strip_attributes(FILE * fp,
+                                    char * header,
+                                    int header_length,
+                                    struct header_attributes_s * attributes,
+                                    bool strip_size,
+                                    bool strip_ee)
+{
+  /*
+    Print the header without the size and/or ee annotations, using
+    spans recorded by header_scan_attributes.
+  */
+
+  int count = 0;
   int attribute_start[2];
   int attribute_end[2];
 
-  /* look for size attribute */
-
-  int size_start = 0;
-  int size_end = 0;
-  bool size_found = false;
-  if (strip_size)
+  if (strip_size && (attributes->size_end > 0))
     {
-      size_found = header_find_attribute(header,
-                                         header_length,
-                                         "size=",
-                                         & size_start,
-                                         & size_end,
-                                         false);
+      attribute_start[count] = attributes->size_start;
+      attribute_end[count] = attributes->size_end;
+      count++;
     }
-  if (size_found)
+
+  if (strip_ee && (attributes->ee_end > 0))
     {
-      attribute_start[attributes] = size_start;
-      attribute_end[attributes] = size_end;
-      attributes++;
+      attribute_start[count] = attributes->ee_start;
+      attribute_end[count] = attributes->ee_end;
+      count++;
     }
 
-  /* look for ee attribute */
+  /* sort */
 
-  int ee_start = 0;
-  int ee_end = 0;
-  bool ee_found = false;
-  if (strip_ee)
-    {
-      ee_found = header_find_attribute(header,
-                                       header_length,
-                                       "ee=",
-                                       & ee_start,
-                                       & ee_end,
-                                       true);
-    }
-  if (ee_found)
+  if ((count > 1) && (attribute_start[0] > attribute_start[1]))
     {
-      attribute_start[attributes] = ee_start;
-      attribute_end[attributes] = ee_end;
-      attributes++;
+      /* swap */
+
+      int s = attribute_start[0];
+      int e = attribute_end[0];
+      attribute_start[0] = attribute_start[1];
+      attribute_end[0] = attribute_end[1];
+      attribute_start[1] = s;
+      attribute_end[1] = e;
     }
 
-  /* sort */
+  /* print */
 
-  if (attributes > 1)
+  int prev_end = 0;
+  for (int i = 0; i < count; i++)
     {
-      if (attribute_start[0] > attribute_start[1])
+      /* print part of header in front of this attribute */
+      if (attribute_start[i] > prev_end + 1)
         {
-          /* swap */
-
-          int s = attribute_start[0];
-          int e = attribute_end[0];
-          attribute_start[0] = attribute_start[1];
-          attribute_end[0] = attribute_end[1];
-          attribute_start[1] = s;
-          attribute_end[1] = e;
+          fwrite(header + prev_end,
+                 1,
+                 attribute_start[i] - prev_end - 1,
+                 fp);
         }
+      prev_end = attribute_end[i];
     }
 
-  /* print */
-
-  if (attributes == 0)
+  /* print the rest, if any */
+  if (count == 0)
     {
-      fprintf(fp, "%.*s", header_length, header);
+      fwrite(header, 1, header_length, fp);
     }
-  else
+  else if (header_length > prev_end + 1)
     {
-      int prev_end = 0;
-      for (int i = 0; i < attributes; i++)
-        {
-          /* print part of header in front of this attribute */
-          if (attribute_start[i] > prev_end + 1)
-            {
-              fprintf(fp, "%.*s",
-                      attribute_start[i] - prev_end - 1,
-                      header + prev_end);
-            }
-          prev_end = attribute_end[i];
-        }
-
-      /* print the rest, if any */
-      if (header_length > prev_end + 1)
-        {
-          fprintf(fp, "%.*s",
-                  header_length - prev_end,
-                  header + prev_end);
-        }
+      fwrite(header + prev_end, 1, header_length - prev_end, fp);
     }
 }
 
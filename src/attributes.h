@@ -61,8 +61,37 @@
 
 */
 
+struct header_attributes_s
+{
+  /* spans of the size= and ee= annotations in a header, end is 0 if absent */
+  unsigned int size_start;
+  unsigned int size_end;
+  unsigned int ee_start;
+  unsigned int ee_end;
+};
+
+void header_scan_attributes(const char * header,
+                            int header_length,
+                            struct header_attributes_s * attributes);
+
+bool header_find_field_value(const char * header,
+                             int header_length,
+                             const char * name,
+                             int * start,
+                             int * end);
+
+bool header_find_attribute(const char * header,
+                           int header_length,
+                           const char * attribute,
+                           int * start,
+                           int * end,
+                           bool allow_decimal);
+
 int64_t header_get_size(char * header, int header_length);
 
+int64_t header_get_size_attributes(char * header,
+                                   struct header_attributes_s * attributes);
+
 void header_fprint_strip_size(FILE * fp,
                               char * header,
                               int header_length);
@@ -72,3 +101,10 @@ void header_fprint_strip_size_ee(FILE * fp,
                                  int header_length,
                                  bool strip_size,
                                  bool strip_ee);
+
+void header_fprint_strip_attributes(FILE * fp,
+                                    char * header,
+                                    int header_length,
+                                    struct header_attributes_s * attributes,
+                                    bool strip_size,
+                                    bool strip_ee);
@@ -0,0 +1,499 @@
+/*
+
+  VSEARCH5D: a modified version of VSEARCH
+
+  Copyright (C) 2016-2021, Akifumi S. Tanabe
+
+  Contact: Akifumi S. Tanabe
+  https://github.com/astanabe/vsearch5d
+
+  Original version of VSEARCH
+  Copyright (C) 2014-2021, Torbjorn Rognes, Frederic Mahe and Tomas Flouri
+  All rights reserved.
+
+
+  This software is dual-licensed and available under a choice
+  of one of two licenses, either under the terms of the GNU
+  General Public License version 3 or the BSD 2-Clause License.
+
+
+  GNU General Public License version 3
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+  The BSD 2-Clause License
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "vsearch5d.h"
+
+/*
+  BAM output, with the same records as the SAM output of
+  results_show_samout, encoded directly from the alignments.
+
+  https://samtools.github.io/hts-specs/SAMv1.pdf, section 4.2
+
+  The reference dictionary lists all database sequences, and the
+  reference of a hit is the number of its target in the database. The
+  text header has the same @HD, @SQ and @PG lines as the SAM header.
+  It precedes the dictionary and its length comes first, so both are
+  kept in memory until the header is complete.
+  Queries are written as they are: BAM cannot store lower case letters,
+  and labels are cut after 254 characters.
+*/
+
+const uint64_t bam_name_max = 254;
+
+static char * bam_buffer = nullptr;
+static uint64_t bam_length = 0;
+static uint64_t bam_alloc = 0;
+
+static char * bam_text = nullptr;
+static uint64_t bam_text_length = 0;
+static uint64_t bam_text_alloc = 0;
+static uint64_t bam_refs = 0;
+static char * bam_cmdline = nullptr;
+
+static void bam_put(const void * data, uint64_t length)
+{
+  if (bam_length + length > bam_alloc)
+    {
+      bam_alloc = MAX(bam_length + length, 2 * bam_alloc);
+      bam_buffer = (char *) xrealloc(bam_buffer, bam_alloc);
+    }
+  memcpy(bam_buffer + bam_length, data, length);
+  bam_length += length;
+}
+
+static void bam_set_u8(uint64_t offset, uint64_t x)
+{
+  bam_buffer[offset] = x & 0xff;
+}
+
+static void bam_set_u16(uint64_t offset, uint64_t x)
+{
+  bam_set_u8(offset, x);
+  bam_set_u8(offset + 1, x >> 8);
+}
+
+static void bam_set_u32(uint64_t offset, uint64_t x)
+{
+  bam_set_u16(offset, x);
+  bam_set_u16(offset + 2, x >> 16);
+}
+
+static void bam_put_u8(uint64_t x)
+{
+  bam_put("", 1);
+  bam_set_u8(bam_length - 1, x);
+}
+
+static void bam_put_u16(uint64_t x)
+{
+  bam_put("\0", 2);
+  bam_set_u16(bam_length - 2, x);
+}
+
+static void bam_put_u32(uint64_t x)
+{
+  bam_put("\0\0\0", 4);
+  bam_set_u32(bam_length - 4, x);
+}
+
+static void bam_put_tag_int(const char * tag, int32_t value)
+{
+  bam_put(tag, 2);
+  bam_put_u8('i');
+  bam_put_u32((uint32_t) value);
+}
+
+static void bam_put_number(int64_t value)
+{
+  char digits[32];
+  int n = snprintf(digits, sizeof(digits), "%" PRId64, value);
+  bam_put(digits, n);
+}
+
+static void bam_put_text(const char * s)
+{
+  uint64_t length = strlen(s);
+  if (bam_text_length + length > bam_text_alloc)
+    {
+      bam_text_alloc = MAX(bam_text_length + length, 2 * bam_text_alloc);
+      bam_text = (char *) xrealloc(bam_text, bam_text_alloc);
+    }
+  memcpy(bam_text + bam_text_length, s, length);
+  bam_text_length += length;
+}
+
+static void bam_write_u32(uint64_t x)
+{
+  unsigned char bytes[4];
+  for(int i = 0; i < 4; i++)
+    {
+      bytes[i] = (x >> (8 * i)) & 0xff;
+    }
+  bgzf_write(bytes, 4);
+}
+
+static void bam_write_buffer()
+{
+  bgzf_write(bam_buffer, bam_length);
+  bam_length = 0;
+}
+
+static int bam_reg2bin(int beg, int end)
+{
+  /* the binning index of the specification */
+
+  --end;
+  if (beg >> 14 == end >> 14)
+    {
+      return ((1 << 15) - 1) / 7 + (beg >> 14);
+    }
+  if (beg >> 17 == end >> 17)
+    {
+      return ((1 << 12) - 1) / 7 + (beg >> 17);
+    }
+  if (beg >> 20 == end >> 20)
+    {
+      return ((1 << 9) - 1) / 7 + (beg >> 20);
+    }
+  if (beg >> 23 == end >> 23)
+    {
+      return ((1 << 6) - 1) / 7 + (beg >> 23);
+    }
+  if (beg >> 26 == end >> 26)
+    {
+      return ((1 << 3) - 1) / 7 + (beg >> 26);
+    }
+  return 0;
+}
+
+void bam_open(const char * filename)
+{
+  bgzf_open(filename, opt_threads);
+}
+
+void bam_header_begin(char * cmdline, uint64_t refs)
+{
+  bam_refs = refs;
+  bam_cmdline = cmdline;
+  bam_text_length = 0;
+  bam_length = 0;
+  bam_put_text("@HD\tVN:1.0\tSO:unsorted\tGO:query\n");
+}
+
+void bam_header_refs(char * dbname)
+{
+  /* one @SQ line and reference for each database sequence in memory */
+
+  for(uint64_t i = 0; i < db_getsequencecount(); i++)
+    {
+      char md5hex[LEN_HEX_DIG_MD5];
+      get_hex_seq_digest_md5(md5hex,
+                             db_getsequence(i),
+                             db_getsequencelen(i));
+      char length[32];
+      snprintf(length, sizeof(length), "%" PRIu64, db_getsequencelen(i));
+
+      bam_put_text("@SQ\tSN:");
+      bam_put_text(db_getheader(i));
+      bam_put_text("\tLN:");
+      bam_put_text(length);
+      bam_put_text("\tM5:");
+      bam_put_text(md5hex);
+      bam_put_text("\tUR:file:");
+      bam_put_text(dbname);
+      bam_put_text("\n");
+
+      bam_put_u32(db_getheaderlen(i) + 1);
+      bam_put(db_getheader(i), db_getheaderlen(i) + 1);
+      bam_put_u32(db_getsequencelen(i));
+    }
+}
+
+void bam_header_end()
+{
+  bam_put_text("@PG\tID:");
+  bam_put_text(PROG_NAME);
+  bam_put_text("\tVN:");
+  bam_put_text(PROG_VERSION);
+  bam_put_text("\tCL:");
+  bam_put_text(bam_cmdline);
+  bam_put_text("\n");
+
+  bgzf_write("BAM\1", 4);
+  bam_write_u32(bam_text_length);
+  bgzf_write(bam_text, bam_text_length);
+  bam_write_u32(bam_refs);
+  bam_write_buffer();
+
+  if (bam_text)
+    {
+      xfree(bam_text);
+    }
+  bam_text = nullptr;
+  bam_text_length = 0;
+  bam_text_alloc = 0;
+
+  /* alignments start in a block of their own */
+  bgzf_flush();
+}
+
+static void bam_put_record(struct hit * hp,
+                           int flag,
+                           char * query_head,
+                           char * sequence,
+                           int64_t seqlen,
+                           const unsigned int * targetmap)
+{
+  uint64_t namelen = MIN(strlen(query_head), bam_name_max);
+
+  /* the record starts the buffer, its fields are at fixed offsets */
+  bam_put_u32(0); /* block_size, set when complete */
+  bam_put_u32(hp ? (targetmap ? targetmap[hp->target] : hp->target) : -1);
+  bam_put_u32(hp ? 0 : -1); /* pos */
+  bam_put_u8(namelen + 1);
+  bam_put_u8(255); /* mapq */
+  bam_put_u16(4680); /* bin of unmapped reads, set below for hits */
+  bam_put_u16(0); /* n_cigar_op, set below */
+  bam_put_u16(flag);
+  bam_put_u32(seqlen);
+  bam_put_u32(-1); /* next_refID */
+  bam_put_u32(-1); /* next_pos */
+  bam_put_u32(0); /* tlen */
+  bam_put(query_head, namelen);
+  bam_put_u8(0);
+
+  if (hp)
+    {
+      /*
+        binary cigar, with the direction of the indels flipped as in
+        build_sam_strings: M=0, I=1, D=2
+      */
+
+      uint64_t ops = 0;
+      int64_t reflen = 0;
+      char * p = hp->nwalignment;
+      while (*p)
+        {
+          int64_t run = 1;
+          if (isdigit(*p))
+            {
+              run = strtol(p, & p, 10);
+            }
+          char op = *p++;
+          uint64_t code = 0;
+          if (op == 'D')
+            {
+              code = 1;
+            }
+          else
+            {
+              reflen += run;
+              code = (op == 'I') ? 2 : 0;
+            }
+          bam_put_u32((run << 4) | code);
+          ops++;
+        }
+
+      if (ops > 65535)
+        {
+          fatal("Alignment too long for BAM output");
+        }
+
+      bam_set_u16(14, bam_reg2bin(0, reflen));
+      bam_set_u16(16, ops);
+    }
+
+  /*
+    sequence, two bases per byte; the 4-bit nucleotide codes are those
+    of BAM, "=ACMGRSVTWYHKDBN"
+  */
+  for(int64_t i = 0; i < seqlen; i += 2)
+    {
+      uint64_t hi = chrmap_4bit[(unsigned char) sequence[i]];
+      uint64_t lo = (i + 1 < seqlen) ?
+        chrmap_4bit[(unsigned char) sequence[i + 1]] : 0;
+      bam_put_u8((hi << 4) | lo);
+    }
+
+  /* no qualities */
+  for(int64_t i = 0; i < seqlen; i++)
+    {
+      bam_put_u8(0xff);
+    }
+}
+
+static void bam_put_md(char * alignment, char * queryseq, char * targetseq)
+{
+  /* the MD string, as built by build_sam_strings */
+
+  bam_put("MDZ", 3);
+
+  char * p = alignment;
+  int qpos = 0;
+  int tpos = 0;
+  int matched = 0;
+  bool flag = false; /* MD string ends with a number */
+
+  while (*p)
+    {
+      int run = 1;
+      if (isdigit(*p))
+        {
+          run = strtol(p, & p, 10);
+        }
+      char op = *p++;
+
+      switch (op)
+        {
+        case 'M':
+          for(int i = 0; i < run; i++)
+            {
+              if (chrmap_4bit[(unsigned char) queryseq[qpos]] ==
+                  chrmap_4bit[(unsigned char) targetseq[tpos]])
+                {
+                  matched++;
+                }
+              else
+                {
+                  if (!flag)
+                    {
+                      bam_put_number(matched);
+                      matched = 0;
+                    }
+                  bam_put(targetseq + tpos, 1);
+                  flag = false;
+                }
+              qpos++;
+              tpos++;
+            }
+          break;
+
+        case 'D':
+          qpos += run;
+          break;
+
+        case 'I':
+          if (!flag)
+            {
+              bam_put_number(matched);
+              matched = 0;
+            }
+          bam_put_u8('^');
+          bam_put(targetseq + tpos, run);
+          tpos += run;
+          flag = false;
+          break;
+        }
+    }
+
+  if (!flag)
+    {
+      bam_put_number(matched);
+    }
+  bam_put_u8(0);
+}
+
+void bam_write_hits(struct hit * hits,
+                    int hitcount,
+                    char * query_head,
+                    char * qsequence,
+                    int64_t qseqlen,
+                    char * rc,
+                    const unsigned int * targetmap)
+{
+  if (hitcount > 0)
+    {
+      double top_hit_id = hits[0].id;
+
+      for(int t = 0; t < hitcount; t++)
+        {
+          struct hit * hp = hits + t;
+
+          if (opt_top_hits_only && (hp->id < top_hit_id))
+            {
+              break;
+            }
+
+          char * sequence = hp->strand ? rc : qsequence;
+
+          bam_put_record(hp,
+                         0x10 * hp->strand | (t > 0 ? 0x100 : 0),
+                         query_head,
+                         sequence,
+                         qseqlen,
+                         targetmap);
+
+          bam_put_tag_int("AS", (int32_t) nearbyint(hp->id));
+          bam_put_tag_int("XN", 0);
+          bam_put_tag_int("XM", hp->mismatches);
+          bam_put_tag_int("XO", hp->internal_gaps);
+          bam_put_tag_int("XG", hp->internal_indels);
+          bam_put_tag_int("NM", hp->mismatches + hp->internal_indels);
+          bam_put_md(hp->nwalignment, sequence, db_getsequence(hp->target));
+          bam_put("YTZUU", 6);
+
+          bam_set_u32(0, bam_length - 4);
+          bgzf_reserve(bam_length);
+          bam_write_buffer();
+        }
+    }
+  else if (opt_output_no_hits)
+    {
+      bam_put_record(nullptr, 0x04, query_head, qsequence, qseqlen, targetmap);
+      bam_set_u32(0, bam_length - 4);
+      bgzf_reserve(bam_length);
+      bam_write_buffer();
+    }
+}
+
+void bam_close()
+{
+  bgzf_close();
+  if (bam_buffer)
+    {
+      xfree(bam_buffer);
+      bam_buffer = nullptr;
+    }
+  bam_alloc = 0;
+  bam_length = 0;
+}
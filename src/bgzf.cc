@@ -0,0 +1,403 @@
+/*
+
+  VSEARCH5D: a modified version of VSEARCH
+
+  Copyright (C) 2016-2021, Akifumi S. Tanabe
+
+  Contact: Akifumi S. Tanabe
+  https://github.com/astanabe/vsearch5d
+
+  Original version of VSEARCH
+  Copyright (C) 2014-2021, Torbjorn Rognes, Frederic Mahe and Tomas Flouri
+  All rights reserved.
+
+
+  This software is dual-licensed and available under a choice
+  of one of two licenses, either under the terms of the GNU
+  General Public License version 3 or the BSD 2-Clause License.
+
+
+  GNU General Public License version 3
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+  The BSD 2-Clause License
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "vsearch5d.h"
+
+/*
+  Writer of BGZF files, the blocked gzip format used by BAM files.
+
+  The data is collected in blocks of at most 65280 bytes. Full blocks
+  are compressed by a pool of threads, and each compressed block is
+  written as a gzip member of its own, in the original order, by the
+  thread that completes the oldest pending block. The file ends with
+  the empty block marking the end of a BGZF file.
+
+  https://samtools.github.io/hts-specs/SAMv1.pdf, section 4.1
+*/
+
+#ifdef HAVE_ZLIB_H
+
+const uint64_t bgzf_data_max = 65280;
+const uint64_t bgzf_block_max = 65536;
+const uint64_t bgzf_header_size = 18;
+const uint64_t bgzf_footer_size = 8;
+
+static const unsigned char bgzf_eof[28] =
+  {
+    0x1f, 0x8b, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0xff, 0x06, 0x00, 0x42, 0x43, 0x02, 0x00,
+    0x1b, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00
+  };
+
+enum
+  {
+    bgzf_slot_free,
+    bgzf_slot_filling,
+    bgzf_slot_full,
+    bgzf_slot_busy,
+    bgzf_slot_done
+  };
+
+struct bgzf_slot_s
+{
+  unsigned char data[bgzf_data_max];
+  unsigned char block[bgzf_block_max];
+  uint64_t length;
+  uint64_t block_length;
+  int state;
+};
+
+static FILE * fp_bgzf = nullptr;
+static struct bgzf_slot_s * bgzf_slots = nullptr;
+static uint64_t bgzf_slot_count = 0;
+static uint64_t bgzf_next_fill = 0;     /* block being filled */
+static uint64_t bgzf_next_compress = 0; /* first block not yet taken */
+static uint64_t bgzf_next_write = 0;    /* first block not yet written */
+static bool bgzf_closing = false;
+static pthread_mutex_t mutex_bgzf;
+static pthread_cond_t cond_bgzf;
+static pthread_t * bgzf_threads = nullptr;
+static int bgzf_thread_count = 0;
+
+static void bgzf_put_u16(unsigned char * p, uint64_t x)
+{
+  p[0] = x & 0xff;
+  p[1] = (x >> 8) & 0xff;
+}
+
+static void bgzf_put_u32(unsigned char * p, uint64_t x)
+{
+  bgzf_put_u16(p, x);
+  bgzf_put_u16(p + 2, x >> 16);
+}
+
+static bool bgzf_deflate(struct bgzf_slot_s * s, int level)
+{
+  /* raw deflate into the block; false if it does not fit */
+
+  z_stream zs;
+  memset(& zs, 0, sizeof(z_stream));
+  if ((*deflateInit2_p)(& zs, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY,
+                        ZLIB_VERSION, (int) sizeof(z_stream)) != Z_OK)
+    {
+      fatal("Unable to initialize compression");
+    }
+
+  zs.next_in = s->data;
+  zs.avail_in = s->length;
+  zs.next_out = s->block + bgzf_header_size;
+  zs.avail_out = bgzf_block_max - bgzf_header_size - bgzf_footer_size;
+
+  int status = (*deflate_p)(& zs, Z_FINISH);
+  uint64_t compressed = zs.total_out;
+  (*deflateEnd_p)(& zs);
+
+  if (status != Z_STREAM_END)
+    {
+      return false;
+    }
+
+  s->block_length = bgzf_header_size + compressed + bgzf_footer_size;
+  return true;
+}
+
+static void bgzf_compress(struct bgzf_slot_s * s)
+{
+  /* stored blocks always fit, with 5 bytes of overhead */
+  if (! bgzf_deflate(s, Z_DEFAULT_COMPRESSION))
+    {
+      if (! bgzf_deflate(s, Z_NO_COMPRESSION))
+        {
+          fatal("Unable to compress BGZF block");
+        }
+    }
+
+  unsigned char * p = s->block;
+  p[0] = 0x1f;
+  p[1] = 0x8b;
+  p[2] = 0x08;
+  p[3] = 0x04;
+  bgzf_put_u32(p + 4, 0);
+  p[8] = 0x00;
+  p[9] = 0xff;
+  bgzf_put_u16(p + 10, 6);
+  p[12] = 'B';
+  p[13] = 'C';
+  bgzf_put_u16(p + 14, 2);
+  bgzf_put_u16(p + 16, s->block_length - 1);
+
+  unsigned char * f = s->block + s->block_length - bgzf_footer_size;
+  bgzf_put_u32(f, (*crc32_p)((*crc32_p)(0, Z_NULL, 0), s->data, s->length));
+  bgzf_put_u32(f + 4, s->length);
+}
+
+static void * bgzf_worker(void * vp)
+{
+  (void) vp;
+
+  xpthread_mutex_lock(&mutex_bgzf);
+  while (true)
+    {
+      if (bgzf_next_compress < bgzf_next_fill)
+        {
+          struct bgzf_slot_s * s =
+            bgzf_slots + bgzf_next_compress % bgzf_slot_count;
+          bgzf_next_compress++;
+          s->state = bgzf_slot_busy;
+          xpthread_mutex_unlock(&mutex_bgzf);
+
+          bgzf_compress(s);
+
+          xpthread_mutex_lock(&mutex_bgzf);
+          s->state = bgzf_slot_done;
+
+          /* write the completed blocks that are next in order */
+          while (bgzf_next_write < bgzf_next_compress)
+            {
+              struct bgzf_slot_s * w =
+                bgzf_slots + bgzf_next_write % bgzf_slot_count;
+              if (w->state != bgzf_slot_done)
+                {
+                  break;
+                }
+              if (fwrite(w->block, 1, w->block_length, fp_bgzf)
+                  != w->block_length)
+                {
+                  fatal("Unable to write to BAM output file");
+                }
+              w->state = bgzf_slot_free;
+              bgzf_next_write++;
+            }
+          xpthread_cond_broadcast(&cond_bgzf);
+        }
+      else if (bgzf_closing)
+        {
+          break;
+        }
+      else
+        {
+          xpthread_cond_wait(&cond_bgzf, &mutex_bgzf);
+        }
+    }
+  xpthread_mutex_unlock(&mutex_bgzf);
+
+  return nullptr;
+}
+
+static struct bgzf_slot_s * bgzf_current()
+{
+  return bgzf_slots + bgzf_next_fill % bgzf_slot_count;
+}
+
+static void bgzf_submit()
+{
+  /* hand the current block to the threads and wait for a free one */
+
+  xpthread_mutex_lock(&mutex_bgzf);
+  bgzf_current()->state = bgzf_slot_full;
+  bgzf_next_fill++;
+  xpthread_cond_broadcast(&cond_bgzf);
+  while (bgzf_current()->state != bgzf_slot_free)
+    {
+      xpthread_cond_wait(&cond_bgzf, &mutex_bgzf);
+    }
+  bgzf_current()->state = bgzf_slot_filling;
+  bgzf_current()->length = 0;
+  xpthread_mutex_unlock(&mutex_bgzf);
+}
+
+void bgzf_open(const char * filename, int threads)
+{
+  if (! gz_lib)
+    {
+      fatal("BAM output requires the zlib library");
+    }
+
+  fp_bgzf = fopen_output(filename);
+  if (! fp_bgzf)
+    {
+      fatal("Unable to open BAM output file for writing");
+    }
+
+  /* a few blocks per thread keep them busy while the next is filled */
+  bgzf_thread_count = threads;
+  bgzf_slot_count = 4 * threads + 1;
+  bgzf_slots = (struct bgzf_slot_s *)
+    xmalloc(bgzf_slot_count * sizeof(struct bgzf_slot_s));
+  for(uint64_t i = 0; i < bgzf_slot_count; i++)
+    {
+      bgzf_slots[i].state = bgzf_slot_free;
+      bgzf_slots[i].length = 0;
+    }
+  bgzf_next_fill = 0;
+  bgzf_next_compress = 0;
+  bgzf_next_write = 0;
+  bgzf_closing = false;
+  bgzf_current()->state = bgzf_slot_filling;
+
+  xpthread_mutex_init(&mutex_bgzf, nullptr);
+  xpthread_cond_init(&cond_bgzf, nullptr);
+
+  bgzf_threads = (pthread_t *) xmalloc(threads * sizeof(pthread_t));
+  for(int t = 0; t < threads; t++)
+    {
+      xpthread_create(bgzf_threads + t, nullptr, bgzf_worker, nullptr);
+    }
+}
+
+void bgzf_write(const void * buffer, uint64_t length)
+{
+  auto * p = (const unsigned char *) buffer;
+  while (length > 0)
+    {
+      struct bgzf_slot_s * s = bgzf_current();
+      uint64_t n = MIN(length, bgzf_data_max - s->length);
+      memcpy(s->data + s->length, p, n);
+      s->length += n;
+      p += n;
+      length -= n;
+      if (s->length == bgzf_data_max)
+        {
+          bgzf_submit();
+        }
+    }
+}
+
+void bgzf_reserve(uint64_t length)
+{
+  /* start a new block unless the data fits in the current one */
+
+  struct bgzf_slot_s * s = bgzf_current();
+  if ((s->length > 0) && (s->length + length > bgzf_data_max))
+    {
+      bgzf_submit();
+    }
+}
+
+void bgzf_flush()
+{
+  if (bgzf_current()->length > 0)
+    {
+      bgzf_submit();
+    }
+}
+
+void bgzf_close()
+{
+  bgzf_flush();
+
+  xpthread_mutex_lock(&mutex_bgzf);
+  bgzf_closing = true;
+  xpthread_cond_broadcast(&cond_bgzf);
+  xpthread_mutex_unlock(&mutex_bgzf);
+
+  for(int t = 0; t < bgzf_thread_count; t++)
+    {
+      xpthread_join(bgzf_threads[t], nullptr);
+    }
+
+  if (fwrite(bgzf_eof, 1, sizeof(bgzf_eof), fp_bgzf) != sizeof(bgzf_eof))
+    {
+      fatal("Unable to write to BAM output file");
+    }
+  fclose(fp_bgzf);
+  fp_bgzf = nullptr;
+
+  xpthread_cond_destroy(&cond_bgzf);
+  xpthread_mutex_destroy(&mutex_bgzf);
+  xfree(bgzf_threads);
+  bgzf_threads = nullptr;
+  xfree(bgzf_slots);
+  bgzf_slots = nullptr;
+}
+
+#else
+
+void bgzf_open(const char * filename, int threads)
+{
+  (void) filename;
+  (void) threads;
+  fatal("BAM output requires the zlib library");
+}
+
+void bgzf_write(const void * buffer, uint64_t length)
+{
+  (void) buffer;
+  (void) length;
+}
+
+void bgzf_reserve(uint64_t length)
+{
+  (void) length;
+}
+
+void bgzf_flush()
+{
+}
+
+void bgzf_close()
+{
+}
+
+#endif
@@ -79,3 +79,17 @@ void bitmap_free(bitmap_t* b)
     }
   xfree(b);
 }
+
+void bitmap_resize(bitmap_t * b, unsigned int size)
+{
+  /* change the size, keeping the bits and resetting any new bits */
+
+  unsigned int oldbytes = (b->size+7)/8;
+  unsigned int newbytes = (size+7)/8;
+  b->bitmap = (unsigned char *) xrealloc(b->bitmap, newbytes);
+  if (newbytes > oldbytes)
+    {
+      memset(b->bitmap + oldbytes, 0, newbytes - oldbytes);
+    }
+  b->size = size;
+}
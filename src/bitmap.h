@@ -71,6 +71,8 @@ bitmap_t * bitmap_init(unsigned int size);
 
 void bitmap_free(bitmap_t* b);
 
+void bitmap_resize(bitmap_t * b, unsigned int size);
+
 inline unsigned char bitmap_get(bitmap_t * b, unsigned int x)
 {
   return (b->bitmap[x >> 3] >> (x & 7)) & 1;
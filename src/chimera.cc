@@ -1137,8 +1137,7 @@ void query_init(struct searchinfo_s * si)
   si->qsequence = nullptr;
   si->kmers = nullptr;
   si->hits = (struct hit *) xmalloc(sizeof(struct hit) * tophits);
-  si->kmers = (count_t *) xmalloc(db_getsequencecount() *
-                                  sizeof(count_t) + 32);
+  si->kmers = search_kmers_alloc(db_getsequencecount());
   si->hit_count = 0;
   si->uh = unique_init();
   si->s = search16_init(opt_match,
@@ -1176,7 +1175,7 @@ void query_exit(struct searchinfo_s * si)
     }
   if (si->kmers)
     {
-      xfree(si->kmers);
+      xfree_large(si->kmers);
     }
 }
 
@@ -1678,6 +1677,7 @@ uint64_t chimera_thread_core(struct chimera_info_s * ci)
 
 void * chimera_thread_worker(void * vp)
 {
+  arch_pin_thread((int64_t) vp);
   return (void *) chimera_thread_core(cia + (int64_t) vp);
 }
 
@@ -1774,19 +1774,27 @@ void chimera()
   /* prepare queries / database */
   if (opt_uchime_ref)
     {
-      db_read(opt_db, 0);
-
-      if (opt_dbmask == MASK_DUST)
-        {
-          dust_all();
-        }
-      else if ((opt_dbmask == MASK_SOFT) && (opt_hardmask))
+      if (! (opt_index_cache && dbcache_read(opt_db, true)))
         {
-          hardmask_all();
-        }
+          db_read(opt_db, 0);
 
-      dbindex_prepare(1, opt_dbmask);
-      dbindex_addallsequences(opt_dbmask);
+          if (opt_dbmask == MASK_DUST)
+            {
+              dust_all();
+            }
+          else if ((opt_dbmask == MASK_SOFT) && (opt_hardmask))
+            {
+              hardmask_all();
+            }
+
+          dbindex_prepare(1, opt_dbmask);
+          dbindex_addallsequences(opt_dbmask);
+
+          if (opt_index_cache)
+            {
+              dbcache_write(opt_db, true);
+            }
+        }
       query_fasta_h = fasta_open(opt_uchime_ref);
       progress_total = fasta_get_size(query_fasta_h);
     }
@@ -1818,7 +1826,7 @@ void chimera()
         }
 
       db_sortbyabundance();
-      dbindex_prepare(1, opt_qmask);
+      dbindex_prepare_growable(1);
       progress_total = db_getnucleotidecount();
     }
 
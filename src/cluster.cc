@@ -65,6 +65,7 @@
 
 static int tophits; /* the maximum number of hits to keep */
 static int seqcount; /* number of database sequences */
+static int clusterdb_count = 0; /* number of centroids from earlier run */
 
 typedef struct clusterinfo_s
 {
@@ -80,7 +81,11 @@ static int clusters = 0;
 static int count_matched = 0;
 static int count_notmatched = 0;
 
-static int64_t * cluster_abundance;
+static int64_t * cluster_abundance = nullptr;
+static int * cluster_sizes = nullptr; /* number of sequences in each cluster */
+static int clusters_counted = 0;
+
+static int lastlength = INT_MAX; /* for the sort check of cluster_smallmem */
 
 static FILE * fp_centroids = nullptr;
 static FILE * fp_uc = nullptr;
@@ -213,6 +218,7 @@ void * threads_worker(void * vp)
 {
   auto t = (int64_t) vp;
   thread_info_s * tip = ti + t;
+  arch_pin_thread(t);
   xpthread_mutex_lock(&tip->mutex);
   /* loop until signalled to quit */
   while (tip->work >= 0)
@@ -326,7 +332,7 @@ void cluster_query_init(struct searchinfo_s * si)
   si->seq_alloc = db_getlongestsequence() + 1;
   si->qsequence = (char *) xmalloc(si->seq_alloc);
 
-  si->kmers = (count_t *) xmalloc(seqcount * sizeof(count_t) + 32);
+  si->kmers = search_kmers_alloc(seqcount);
   si->hits = (struct hit *) xmalloc(sizeof(struct hit) * tophits);
 
   si->uh = unique_init();
@@ -367,7 +373,7 @@ void cluster_query_exit(struct searchinfo_s * si)
     }
   if (si->kmers)
     {
-      xfree(si->kmers);
+      xfree_large(si->kmers);
     }
 }
 
@@ -562,7 +568,7 @@ int compare_kmersample(const void * a, const void * b)
     }
 }
 
-void cluster_core_parallel()
+void cluster_core_parallel(int first)
 {
   /* create threads and set them in stand-by mode */
   threads_init();
@@ -610,9 +616,7 @@ void cluster_core_parallel()
 
   int aligncount = 0;
 
-  int lastlength = INT_MAX;
-
-  int seqno = 0;
+  int seqno = first;
 
   int64_t sum_nucleotides = 0;
 
@@ -796,15 +800,15 @@ void cluster_core_parallel()
                               unsigned short snwmismatches;
                               unsigned short snwgaps;
 
-                              search16(si->s,
-                                       1,
-                                       & nwtarget,
-                                       & snwscore,
-                                       & snwalignmentlength,
-                                       & snwmatches,
-                                       & snwmismatches,
-                                       & snwgaps,
-                                       & nwcigar);
+                              search_align16(si,
+                                             1,
+                                             & nwtarget,
+                                             & snwscore,
+                                             & snwalignmentlength,
+                                             & snwmatches,
+                                             & snwmismatches,
+                                             & snwgaps,
+                                             & nwcigar);
 
                               int64_t tseqlen = db_getsequencelen(target);
 
@@ -1022,7 +1026,7 @@ void cluster_core_parallel()
   xfree(scorematrix);
 }
 
-void cluster_core_serial()
+void cluster_core_serial(int first)
 {
   struct searchinfo_s si_p[1];
   struct searchinfo_s si_m[1];
@@ -1033,10 +1037,8 @@ void cluster_core_serial()
       cluster_query_init(si_m);
     }
 
-  int lastlength = INT_MAX;
-
   progress_init("Clustering", seqcount);
-  for (int seqno=0; seqno<seqcount; seqno++)
+  for (int seqno=first; seqno<seqcount; seqno++)
     {
       int length = db_getsequencelen(seqno);
 
@@ -1129,11 +1131,337 @@ void cluster_core_serial()
     }
 }
 
+static void cluster_count_members(int first)
+{
+  /* add the sequences from first on to the size and abundance of
+     their clusters */
+
+  cluster_abundance = (int64_t *) xrealloc(cluster_abundance,
+                                           clusters * sizeof(int64_t));
+  cluster_sizes = (int *) xrealloc(cluster_sizes, clusters * sizeof(int));
+
+  for(int z = clusters_counted; z < clusters; z++)
+    {
+      cluster_abundance[z] = 0;
+      cluster_sizes[z] = 0;
+    }
+  clusters_counted = clusters;
+
+  for(int i=first; i<seqcount; i++)
+    {
+      int seqno = clusterinfo[i].seqno;
+      int clusterno = clusterinfo[i].clusterno;
+      /* earlier centroids carry the abundance of their whole cluster */
+      cluster_abundance[clusterno] +=
+        (opt_sizein || (seqno < clusterdb_count)) ? db_getabundance(seqno) : 1;
+      cluster_sizes[clusterno]++;
+    }
+}
+
+/*
+  Sharded clustering with --shard_count. A first pass over the input
+  only collects the sort key of each sequence: its length and abundance
+  with cluster_fast, its abundance with cluster_size and cluster_unoise.
+  The keys are then split into shards of about the same number of
+  sequences, never splitting sequences with equal keys, so that the
+  shards in turn hold the sorted input. With cluster_smallmem the input
+  order is kept and the shards are consecutive parts of the input.
+
+  Each shard is then read from the input, sorted and clustered against
+  the centroids of all earlier shards as in a single run, after which
+  only the centroids are kept. Only the centroids and one shard are in
+  memory at a time, and the result is that of a single run.
+*/
+
+struct shard_key_s
+{
+  uint64_t seqlen; /* 0 unless sorted by length */
+  uint64_t abundance;
+  uint64_t count;
+};
+
+static struct shard_key_s * shard_keys = nullptr;
+static uint64_t shard_keys_count = 0;
+static uint64_t shard_keys_alloc = 0;
+static uint64_t shard_scanned = 0;
+static uint64_t * shard_bounds = nullptr;
+static uint64_t shard_first = 0;
+static uint64_t shard_last = 0;
+static uint64_t shard_ordinal = 0;
+
+static int shard_compare_keys(const void * a, const void * b)
+{
+  auto * x = (struct shard_key_s *) a;
+  auto * y = (struct shard_key_s *) b;
+
+  /* in clustering order: longest, then most abundant first */
+
+  if (x->seqlen > y->seqlen)
+    {
+      return -1;
+    }
+  else if (x->seqlen < y->seqlen)
+    {
+      return +1;
+    }
+  else if (x->abundance > y->abundance)
+    {
+      return -1;
+    }
+  else if (x->abundance < y->abundance)
+    {
+      return +1;
+    }
+  else
+    {
+      return 0;
+    }
+}
+
+static void shard_keys_merge()
+{
+  /* sort the keys and merge the equal ones */
+
+  qsort(shard_keys, shard_keys_count, sizeof(struct shard_key_s),
+        shard_compare_keys);
+
+  uint64_t n = 0;
+  for(uint64_t i = 0; i < shard_keys_count; i++)
+    {
+      if ((n > 0) && (shard_compare_keys(shard_keys + n - 1,
+                                         shard_keys + i) == 0))
+        {
+          shard_keys[n - 1].count += shard_keys[i].count;
+        }
+      else
+        {
+          shard_keys[n++] = shard_keys[i];
+        }
+    }
+  shard_keys_count = n;
+}
+
+static void shard_add(uint64_t seqlen, uint64_t abundance)
+{
+  shard_scanned++;
+
+  if (opt_cluster_smallmem)
+    {
+      return;
+    }
+
+  if (shard_keys_count == shard_keys_alloc)
+    {
+      /* merge before growing, as most keys are usually repeated */
+      shard_keys_merge();
+      if (2 * shard_keys_count >= shard_keys_alloc)
+        {
+          shard_keys_alloc = MAX(2 * shard_keys_alloc, 1024);
+          shard_keys = (struct shard_key_s *)
+            xrealloc(shard_keys,
+                     shard_keys_alloc * sizeof(struct shard_key_s));
+        }
+    }
+
+  struct shard_key_s * k = shard_keys + shard_keys_count++;
+  k->seqlen = opt_cluster_fast ? seqlen : 0;
+  k->abundance = abundance;
+  k->count = 1;
+}
+
+static bool shard_select(uint64_t seqlen, uint64_t abundance)
+{
+  /* is this record in the current shard? */
+
+  if (opt_cluster_smallmem)
+    {
+      uint64_t ordinal = shard_ordinal++;
+      return (ordinal >= shard_first) && (ordinal < shard_last);
+    }
+
+  struct shard_key_s k;
+  k.seqlen = opt_cluster_fast ? seqlen : 0;
+  k.abundance = abundance;
+  k.count = 0;
+
+  return (shard_compare_keys(& k, shard_keys + shard_first) >= 0) &&
+    (shard_compare_keys(& k, shard_keys + shard_last - 1) <= 0);
+}
+
+static void shard_split()
+{
+  /* find the first key (or input record) of each shard */
+
+  shard_bounds = (uint64_t *) xmalloc((opt_shard_count + 1) *
+                                      sizeof(uint64_t));
+
+  if (opt_cluster_smallmem)
+    {
+      for(int64_t s = 0; s <= opt_shard_count; s++)
+        {
+          shard_bounds[s] = shard_scanned * s / opt_shard_count;
+        }
+      return;
+    }
+
+  shard_keys_merge();
+
+  uint64_t k = 0;
+  uint64_t sum = 0;
+  shard_bounds[0] = 0;
+  for(int64_t s = 1; s < opt_shard_count; s++)
+    {
+      uint64_t target = shard_scanned * s / opt_shard_count;
+      while ((k < shard_keys_count) && (sum + shard_keys[k].count <= target))
+        {
+          sum += shard_keys[k].count;
+          k++;
+        }
+      shard_bounds[s] = k;
+    }
+  shard_bounds[opt_shard_count] = shard_keys_count;
+}
+
+static uint64_t shard_size(int64_t s)
+{
+  /* number of sequences in shard s */
+
+  if (opt_cluster_smallmem)
+    {
+      return shard_bounds[s + 1] - shard_bounds[s];
+    }
+
+  uint64_t n = 0;
+  for(uint64_t k = shard_bounds[s]; k < shard_bounds[s + 1]; k++)
+    {
+      n += shard_keys[k].count;
+    }
+  return n;
+}
+
+static void cluster_shards(char * dbname)
+{
+  cluster_count_members(0);
+
+  for(int64_t s = 0; s < opt_shard_count; s++)
+    {
+      uint64_t expected = shard_size(s);
+      if (expected == 0)
+        {
+          continue;
+        }
+
+      shard_first = shard_bounds[s];
+      shard_last = shard_bounds[s + 1];
+      shard_ordinal = 0;
+
+      int first = db_getsequencecount();
+      db_read_append_selected(dbname, 0, shard_select);
+      seqcount = db_getsequencecount();
+
+      if ((uint64_t) (seqcount - first) != expected)
+        {
+          fatal("Input file changed while clustering (%s)", dbname);
+        }
+
+      if (! opt_quiet)
+        {
+          fprintf(stderr, "Shard %" PRId64 " of %" PRId64 ": %" PRIu64
+                  " sequences\n", s + 1, opt_shard_count, expected);
+        }
+
+      if (opt_log)
+        {
+          fprintf(fp_log, "Shard %" PRId64 " of %" PRId64 ": %" PRIu64
+                  " sequences\n\n", s + 1, opt_shard_count, expected);
+        }
+
+      if (opt_qmask == MASK_DUST)
+        {
+          dust_all(first);
+        }
+      else if ((opt_qmask == MASK_SOFT) && (opt_hardmask))
+        {
+          hardmask_all(first);
+        }
+
+      if (opt_cluster_fast)
+        {
+          db_sortbylength(first);
+        }
+      else if (opt_cluster_size || opt_cluster_unoise)
+        {
+          db_sortbyabundance(first);
+        }
+
+      clusterinfo = (clusterinfo_t *) xrealloc(clusterinfo,
+                                               seqcount * sizeof(clusterinfo_t));
+
+      if (opt_threads == 1)
+        {
+          cluster_core_serial(first);
+        }
+      else
+        {
+          cluster_core_parallel(first);
+        }
+
+      cluster_count_members(first);
+
+      /* keep only the centroids, which are the indexed sequences; the
+         centroid of cluster i becomes sequence i */
+
+      for(int i = first; i < seqcount; i++)
+        {
+          if (clusterinfo[i].cigar)
+            {
+              xfree(clusterinfo[i].cigar);
+            }
+        }
+
+      auto * keep = (uint64_t *) xmalloc(MAX(clusters, 1) * sizeof(uint64_t));
+      for(int z = 0; z < clusters; z++)
+        {
+          keep[z] = dbindex_getmapping(z);
+        }
+      db_keep(keep, clusters);
+      xfree(keep);
+      dbindex_renumber();
+
+      seqcount = clusters;
+      for(int z = 0; z < clusters; z++)
+        {
+          clusterinfo[z].seqno = z;
+          clusterinfo[z].clusterno = z;
+          clusterinfo[z].cigar = nullptr;
+          clusterinfo[z].strand = 0;
+        }
+
+      show_rusage();
+    }
+
+  if (shard_keys)
+    {
+      xfree(shard_keys);
+    }
+  xfree(shard_bounds);
+}
+
 
 void cluster(char * dbname,
              char * cmdline,
              char * progheader)
 {
+  int fd_clusterdbout = 0;
+  if (opt_clusterdbout)
+    {
+      fd_clusterdbout = xopen_write(opt_clusterdbout);
+      if (fd_clusterdbout < 0)
+        {
+          fatal("Unable to open UDB file for writing");
+        }
+    }
+
   if (opt_centroids)
     {
       fp_centroids = fopen_output(opt_centroids);
@@ -1245,7 +1573,53 @@ void cluster(char * dbname,
         }
     }
 
-  db_read(dbname, 0);
+  bool sharded = (opt_shard_count > 1);
+
+  if (sharded)
+    {
+      /* the input is read once to find the shards and once per shard */
+      xstat_t fs;
+      if ((strcmp(dbname, "-") == 0) ||
+          ((xstat(dbname, & fs) == 0) && S_ISFIFO(fs.st_mode)))
+        {
+          fatal("Cannot read the input from a pipe with --shard_count");
+        }
+
+      db_scan(dbname, shard_add);
+      shard_split();
+    }
+
+  if (opt_clusterdb)
+    {
+      /* centroids of the earlier run go first, in their original order */
+      if (udb_detect_isudb(opt_clusterdb))
+        {
+          udb_read(opt_clusterdb, false, true);
+          dbindex_free();
+        }
+      else
+        {
+          db_read(opt_clusterdb, 0);
+        }
+      clusterdb_count = db_getsequencecount();
+      if (! sharded)
+        {
+          db_read_append(dbname, 0);
+        }
+
+      if (!opt_quiet)
+        {
+          fprintf(stderr, "Centroids from earlier run: %d\n", clusterdb_count);
+        }
+      if (opt_log)
+        {
+          fprintf(fp_log, "Centroids from earlier run: %d\n\n", clusterdb_count);
+        }
+    }
+  else if (! sharded)
+    {
+      db_read(dbname, 0);
+    }
 
   otutable_init();
 
@@ -1266,32 +1640,43 @@ void cluster(char * dbname,
 
   if (opt_cluster_fast)
     {
-      db_sortbylength();
+      db_sortbylength(clusterdb_count);
     }
   else if (opt_cluster_size || opt_cluster_unoise)
     {
-      db_sortbyabundance();
+      db_sortbyabundance(clusterdb_count);
     }
 
-  dbindex_prepare(1, opt_qmask);
+  dbindex_prepare_growable(1);
+
+  /* the number of sequences to cluster, including earlier centroids */
+  int total = sharded ? clusterdb_count + shard_scanned : seqcount;
+
+  /* the number of sequences in all clusters, for the statistics; each
+     centroid of an earlier run stands for its saved abundance */
+  int64_t total_seqs = total - clusterdb_count;
+  for(int seqno = 0; seqno < clusterdb_count; seqno++)
+    {
+      total_seqs += db_getabundance(seqno);
+    }
 
   /* tophits = the maximum number of hits we need to store */
 
-  if ((opt_maxrejects == 0) || (opt_maxrejects > seqcount))
+  if ((opt_maxrejects == 0) || (opt_maxrejects > total))
     {
-      opt_maxrejects = seqcount;
+      opt_maxrejects = total;
     }
 
-  if ((opt_maxaccepts == 0) || (opt_maxaccepts > seqcount))
+  if ((opt_maxaccepts == 0) || (opt_maxaccepts > total))
     {
-      opt_maxaccepts = seqcount;
+      opt_maxaccepts = total;
     }
 
   tophits = opt_maxrejects + opt_maxaccepts + MAXDELAYED;
 
-  if (tophits > seqcount)
+  if (tophits > total)
     {
-      tophits = seqcount;
+      tophits = total;
     }
 
   clusterinfo = (clusterinfo_t *) xmalloc(seqcount * sizeof(clusterinfo_t));
@@ -1312,30 +1697,45 @@ void cluster(char * dbname,
       fprintf(fp_log, "\n");
     }
 
-  if (opt_threads == 1)
+  /* the centroids of an earlier run are the first clusters */
+  for(int seqno = 0; seqno < clusterdb_count; seqno++)
+    {
+      if (opt_uc)
+        {
+          fprintf(fp_uc, "S\t%d\t%" PRIu64 "\t*\t*\t*\t*\t*\t%s\t*\n",
+                  clusters, db_getsequencelen(seqno), db_getheader(seqno));
+        }
+      clusterinfo[seqno].seqno = seqno;
+      clusterinfo[seqno].clusterno = clusters;
+      clusterinfo[seqno].cigar = nullptr;
+      clusterinfo[seqno].strand = 0;
+      dbindex_addsequence(seqno, opt_qmask);
+      clusters++;
+    }
+
+  if (sharded)
     {
-      cluster_core_serial();
+      cluster_shards(dbname);
     }
   else
     {
-      cluster_core_parallel();
-    }
-
-
-  /* find size and abundance of each cluster and save stats */
-
-  cluster_abundance = (int64_t *) xmalloc(clusters * sizeof(int64_t));
-  int * cluster_size = (int *) xmalloc(clusters * sizeof(int));
+      if (opt_threads == 1)
+        {
+          cluster_core_serial(clusterdb_count);
+        }
+      else
+        {
+          cluster_core_parallel(clusterdb_count);
+        }
 
-  memset(cluster_abundance, 0, clusters * sizeof(int64_t));
-  memset(cluster_size, 0, clusters * sizeof(int));
+      /* find size and abundance of each cluster and save stats */
+      cluster_count_members(0);
+    }
 
-  for(int i=0; i<seqcount; i++)
+  if (opt_clusterdbout)
     {
-      int seqno = clusterinfo[i].seqno;
-      int clusterno = clusterinfo[i].clusterno;
-      cluster_abundance[clusterno] += opt_sizein ? db_getabundance(seqno) : 1;
-      cluster_size[clusterno]++;
+      /* index element i is the centroid of cluster i */
+      udb_write(fd_clusterdbout, cluster_abundance);
     }
 
   int64_t abundance_min = LONG_MAX;
@@ -1360,7 +1760,7 @@ void cluster(char * dbname,
           singletons++;
         }
 
-      int size = cluster_size[z];
+      int size = cluster_sizes[z];
       if (size > size_max)
         {
           size_max = size;
@@ -1395,6 +1795,25 @@ void cluster(char * dbname,
       fn_clusters = (char *) xmalloc(strlen(opt_clusters) + 25);
     }
 
+  /* register the relabeled sequences in output order for digests */
+  digest_prefetch_init();
+  for(int i=0; i<seqcount; i++)
+    {
+      int seqno = clusterinfo[i].seqno;
+      bool first = (i == 0) ||
+        (clusterinfo[i].clusterno != clusterinfo[i-1].clusterno);
+      if (first && opt_centroids)
+        {
+          digest_prefetch_add(db_getsequence(seqno),
+                              db_getsequencelen(seqno));
+        }
+      if (opt_clusters)
+        {
+          digest_prefetch_add(db_getsequence(seqno),
+                              db_getsequencelen(seqno));
+        }
+    }
+
   int lastcluster = -1;
   int ordinal = 0;
 
@@ -1422,7 +1841,8 @@ void cluster(char * dbname,
                                   -1.0,
                                   -1,
                                   opt_clusterout_id ? clusterno : -1,
-                                  nullptr, 0.0);
+                                  nullptr, 0.0,
+                                  db_getattributes(seqno));
             }
 
           if (opt_uc)
@@ -1478,6 +1898,7 @@ void cluster(char * dbname,
     }
 
   progress_done();
+  digest_prefetch_exit();
 
   if (clusters < 1)
     {
@@ -1501,11 +1922,11 @@ void cluster(char * dbname,
                   clusters,
                   abundance_min,
                   abundance_max,
-                  1.0 * seqcount / clusters);
+                  1.0 * total_seqs / clusters);
           fprintf(stderr,
                   "Singletons: %d, %.1f%% of seqs, %.1f%% of clusters\n",
                   singletons,
-                  100.0 * singletons / seqcount,
+                  100.0 * singletons / total_seqs,
                   100.0 * singletons / clusters);
         }
 
@@ -1516,11 +1937,11 @@ void cluster(char * dbname,
                   clusters,
                   abundance_min,
                   abundance_max,
-                  1.0 * seqcount / clusters);
+                  1.0 * total_seqs / clusters);
           fprintf(fp_log,
                   "Singletons: %d, %.1f%% of seqs, %.1f%% of clusters\n",
                   singletons,
-                  100.0 * singletons / seqcount,
+                  100.0 * singletons / total_seqs,
                   100.0 * singletons / clusters);
           fprintf(fp_log, "\n");
         }
@@ -1528,10 +1949,10 @@ void cluster(char * dbname,
 
   if (opt_msaout || opt_consout || opt_profile)
     {
-      int msa_target_count = 0;
       auto * msa_target_list =
-        (struct msa_target_s *) xmalloc(sizeof(struct msa_target_s) * size_max);
-      progress_init("Multiple alignments", seqcount);
+        (struct msa_target_s *) xmalloc(sizeof(struct msa_target_s) * seqcount);
+      auto * msa_cluster_list =
+        (struct msa_cluster_s *) xmalloc(sizeof(struct msa_cluster_s) * clusters);
 
       FILE * fp_msaout = nullptr;
       FILE * fp_consout = nullptr;
@@ -1561,50 +1982,37 @@ void cluster(char * dbname,
             }
         }
 
+      /* collect the members of each cluster, centroid first */
+      int msa_cluster_count = 0;
       lastcluster = -1;
 
       for(int i=0; i<seqcount; i++)
         {
           int clusterno = clusterinfo[i].clusterno;
-          int seqno = clusterinfo[i].seqno;
-          char * cigar = clusterinfo[i].cigar;
-          int strand = clusterinfo[i].strand;
 
           if (clusterno != lastcluster)
             {
-              if (lastcluster != -1)
-                {
-                  /* compute msa & consensus */
-                  msa(fp_msaout, fp_consout, fp_profile,
-                      lastcluster,
-                      msa_target_count, msa_target_list,
-                      cluster_abundance[lastcluster]);
-                }
-
               /* start new cluster */
-              msa_target_count = 0;
+              struct msa_cluster_s * mcp = msa_cluster_list + msa_cluster_count;
+              mcp->cluster = clusterno;
+              mcp->target_count = 0;
+              mcp->target_list = msa_target_list + i;
+              mcp->totalabundance = cluster_abundance[clusterno];
+              msa_cluster_count++;
               lastcluster = clusterno;
             }
 
           /* add current sequence to the cluster */
-          msa_target_list[msa_target_count].seqno = seqno;
-          msa_target_list[msa_target_count].cigar = cigar;
-          msa_target_list[msa_target_count].strand = strand;
-          msa_target_count++;
-
-          progress_update(i);
-        }
-
-      if (lastcluster != -1)
-        {
-          /* compute msa & consensus */
-          msa(fp_msaout, fp_consout, fp_profile,
-              lastcluster,
-              msa_target_count, msa_target_list,
-              cluster_abundance[lastcluster]);
+          struct msa_cluster_s * mcp = msa_cluster_list + msa_cluster_count - 1;
+          msa_target_list[i].seqno = clusterinfo[i].seqno;
+          msa_target_list[i].cigar = clusterinfo[i].cigar;
+          msa_target_list[i].strand = clusterinfo[i].strand;
+          mcp->target_count++;
         }
 
-      progress_done();
+      /* compute msa & consensus */
+      msa_all(fp_msaout, fp_consout, fp_profile,
+              msa_cluster_count, msa_cluster_list);
 
       if (fp_profile)
         {
@@ -1621,11 +2029,12 @@ void cluster(char * dbname,
           fclose(fp_consout);
         }
 
+      xfree(msa_cluster_list);
       xfree(msa_target_list);
     }
 
   xfree(cluster_abundance);
-  xfree(cluster_size);
+  xfree(cluster_sizes);
 
   /* free cigar strings for all aligned sequences */
 
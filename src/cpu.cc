@@ -118,6 +118,119 @@ void increment_counters_from_bitmap(count_t * counters,
     }
 }
 
+/*
+  The 8 and 32 bit variants below are used when the counts cannot
+  exceed the counter width (see search_topscores), so they add
+  without saturation. The 8 bit one handles 16 counters per vector.
+*/
+
+void increment_counters8_from_bitmap(unsigned char * counters,
+                                     unsigned char * bitmap,
+                                     unsigned int totalbits)
+{
+  const uint8x16_t c1 =
+    { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80,
+      0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80 };
+
+  unsigned char * p = bitmap;
+  uint8x16_t * q = (uint8x16_t *)(counters);
+  int r = (totalbits + 15) / 16;
+
+  for(int j=0; j<r; j++)
+    {
+      // low byte in the first half, high byte in the second half
+      uint8x16_t r0 = vcombine_u8(vdup_n_u8(p[0]), vdup_n_u8(p[1]));
+      p += 2;
+
+      // bit test with mask giving 0x00 or 0xff
+      uint8x16_t r1 = vtstq_u8(r0, c1);
+
+      // subtract 0 or -1 (i.e. add 0 or 1)
+      *q = vsubq_u8(*q, r1);
+      q++;
+    }
+}
+
+void increment_counters32_from_bitmap(unsigned int * counters,
+                                      unsigned char * bitmap,
+                                      unsigned int totalbits)
+{
+  const uint8x16_t c1 =
+    { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80,
+      0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80 };
+
+  unsigned char * p = bitmap;
+  int32x4_t * q = (int32x4_t *)(counters);
+  int r = (totalbits + 15) / 16;
+
+  for(int j=0; j<r; j++)
+    {
+      uint8x16_t r0 = vcombine_u8(vdup_n_u8(p[0]), vdup_n_u8(p[1]));
+      p += 2;
+
+      // 0 or -1 for each counter, widened to 32 bits
+      int8x16_t r1 = vreinterpretq_s8_u8(vtstq_u8(r0, c1));
+      int16x8_t r2 = vmovl_s8(vget_low_s8(r1));
+      int16x8_t r3 = vmovl_s8(vget_high_s8(r1));
+
+      *q = vsubq_s32(*q, vmovl_s16(vget_low_s16(r2)));
+      q++;
+      *q = vsubq_s32(*q, vmovl_s16(vget_high_s16(r2)));
+      q++;
+      *q = vsubq_s32(*q, vmovl_s16(vget_low_s16(r3)));
+      q++;
+      *q = vsubq_s32(*q, vmovl_s16(vget_high_s16(r3)));
+      q++;
+    }
+}
+
+int64_t reverse_complement_blocks(char * rc, char * seq, int64_t len)
+{
+  /*
+    Reverse complement whole blocks of 16 nucleotides from the end of
+    seq into the start of rc. All symbols outside the range 64-127 map
+    to N, the remaining 64 entries of the complement map are looked up
+    with a single table instruction. Returns the number of symbols done.
+  */
+
+  uint8x16x4_t t;
+  t.val[0] = vld1q_u8(chrmap_complement + 64);
+  t.val[1] = vld1q_u8(chrmap_complement + 80);
+  t.val[2] = vld1q_u8(chrmap_complement + 96);
+  t.val[3] = vld1q_u8(chrmap_complement + 112);
+
+  const uint8x16_t c64 = vdupq_n_u8(64);
+  const uint8x16_t cn = vdupq_n_u8('N');
+
+  int64_t done = len & ~ (int64_t) 15;
+
+  for(int64_t i = 0; i < done; i += 16)
+    {
+      uint8x16_t x = vld1q_u8((uint8_t *) seq + len - 16 - i);
+      uint8x16_t idx = vsubq_u8(x, c64);
+      uint8x16_t c = vbslq_u8(vcltq_u8(idx, c64), vqtbl4q_u8(t, idx), cn);
+      c = vrev64q_u8(c);
+      vst1q_u8((uint8_t *) rc + i, vextq_u8(c, c, 8));
+    }
+
+  return done;
+}
+
+int64_t reverse_blocks(char * dst, char * src, int64_t len)
+{
+  /* Reverse whole blocks of 16 bytes from the end of src into dst. */
+
+  int64_t done = len & ~ (int64_t) 15;
+
+  for(int64_t i = 0; i < done; i += 16)
+    {
+      uint8x16_t x = vrev64q_u8(vld1q_u8((uint8_t *) src + len - 16 - i));
+      vst1q_u8((uint8_t *) dst + i, vextq_u8(x, x, 8));
+    }
+
+  return done;
+}
+
 #elif defined __PPC__
 
 void increment_counters_from_bitmap(count_t * counters,
@@ -157,6 +270,149 @@ void increment_counters_from_bitmap(count_t * counters,
     }
 }
 
+/*
+  The 8 and 32 bit variants below are used when the counts cannot
+  exceed the counter width (see search_topscores), so they add
+  without saturation. The 8 bit one handles 16 counters per vector.
+*/
+
+void increment_counters8_from_bitmap(unsigned char * counters,
+                                     unsigned char * bitmap,
+                                     unsigned int totalbits)
+{
+  const vector unsigned char c1 =
+    { 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0 };
+  const vector unsigned char c2 =
+    { 0xfe, 0xfd, 0xfb, 0xf7, 0xef, 0xdf, 0xbf, 0x7f,
+      0xfe, 0xfd, 0xfb, 0xf7, 0xef, 0xdf, 0xbf, 0x7f };
+  const vector unsigned char c3 =
+    { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+
+  unsigned short * p = (unsigned short *)(bitmap);
+  vector signed char * q = (vector signed char *) (counters);
+  int r = (totalbits + 15) / 16;
+
+  for(int j=0; j<r; j++)
+    {
+      vector unsigned char r0, r1, r2;
+      vector __bool char r3;
+      vector signed short r4, r5;
+
+      r0 = * (vector unsigned char *) p;
+      p++;
+      r1 = vec_perm(r0, r0, c1);
+      r2 = vec_or(r1, c2);
+      r3 = vec_cmpeq(r2, c3);
+      /* as in the 16 bit version, then packed in counter order */
+      r4 = (vector signed short) vec_unpackl(r3);
+      r5 = (vector signed short) vec_unpackh(r3);
+      *q = vec_sub(*q, vec_pack(r4, r5));
+      q++;
+    }
+}
+
+void increment_counters32_from_bitmap(unsigned int * counters,
+                                      unsigned char * bitmap,
+                                      unsigned int totalbits)
+{
+  const vector unsigned char c1 =
+    { 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0 };
+  const vector unsigned char c2 =
+    { 0xfe, 0xfd, 0xfb, 0xf7, 0xef, 0xdf, 0xbf, 0x7f,
+      0xfe, 0xfd, 0xfb, 0xf7, 0xef, 0xdf, 0xbf, 0x7f };
+  const vector unsigned char c3 =
+    { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+      0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+
+  unsigned short * p = (unsigned short *)(bitmap);
+  vector signed int * q = (vector signed int *) (counters);
+  int r = (totalbits + 15) / 16;
+
+  for(int j=0; j<r; j++)
+    {
+      vector unsigned char r0, r1, r2;
+      vector __bool char r3;
+      vector signed short r4, r5;
+
+      r0 = * (vector unsigned char *) p;
+      p++;
+      r1 = vec_perm(r0, r0, c1);
+      r2 = vec_or(r1, c2);
+      r3 = vec_cmpeq(r2, c3);
+      r4 = (vector signed short) vec_unpackl(r3);
+      r5 = (vector signed short) vec_unpackh(r3);
+      *q = vec_sub(*q, vec_unpackh(r4));
+      q++;
+      *q = vec_sub(*q, vec_unpackl(r4));
+      q++;
+      *q = vec_sub(*q, vec_unpackh(r5));
+      q++;
+      *q = vec_sub(*q, vec_unpackl(r5));
+      q++;
+    }
+}
+
+int64_t reverse_complement_blocks(char * rc, char * seq, int64_t len)
+{
+  /*
+    Reverse complement whole blocks of 16 nucleotides from the end of
+    seq into the start of rc. All symbols outside the range 64-127 map
+    to N, the remaining 64 entries of the complement map are looked up
+    with two permutes of 32 entries each. Returns the number of symbols
+    done.
+  */
+
+  const vector unsigned char t0 =
+    * (vector unsigned char *) (chrmap_complement + 64);
+  const vector unsigned char t1 =
+    * (vector unsigned char *) (chrmap_complement + 80);
+  const vector unsigned char t2 =
+    * (vector unsigned char *) (chrmap_complement + 96);
+  const vector unsigned char t3 =
+    * (vector unsigned char *) (chrmap_complement + 112);
+  const vector unsigned char c31 = vec_splats((unsigned char) 31);
+  const vector unsigned char c64 = vec_splats((unsigned char) 64);
+  const vector unsigned char cn = vec_splats((unsigned char) 'N');
+  const vector unsigned char rev =
+    { 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0 };
+
+  int64_t done = len & ~ (int64_t) 15;
+
+  for(int64_t i = 0; i < done; i += 16)
+    {
+      vector unsigned char x, idx, lo, hi, c;
+
+      x = * (vector unsigned char *) (seq + len - 16 - i);
+      idx = vec_sub(x, c64);
+      lo = vec_perm(t0, t1, idx);
+      hi = vec_perm(t2, t3, idx);
+      c = vec_sel(lo, hi, vec_cmpgt(idx, c31));
+      c = vec_sel(cn, c, vec_cmplt(idx, c64));
+      * (vector unsigned char *) (rc + i) = vec_perm(c, c, rev);
+    }
+
+  return done;
+}
+
+int64_t reverse_blocks(char * dst, char * src, int64_t len)
+{
+  /* Reverse whole blocks of 16 bytes from the end of src into dst. */
+
+  const vector unsigned char rev =
+    { 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0 };
+
+  int64_t done = len & ~ (int64_t) 15;
+
+  for(int64_t i = 0; i < done; i += 16)
+    {
+      vector unsigned char x = * (vector unsigned char *) (src + len - 16 - i);
+      * (vector unsigned char *) (dst + i) = vec_perm(x, x, rev);
+    }
+
+  return done;
+}
+
 #elif __x86_64__
 
 #ifdef SSSE3
@@ -225,6 +481,178 @@ void increment_counters_from_bitmap_sse2(count_t * counters,
     }
 }
 
+/*
+  The 8 and 32 bit variants below are used when the counts cannot
+  exceed the counter width (see search_topscores), so they add
+  without saturation. The 8 bit one handles 16 counters per vector,
+  using the byte masks directly.
+*/
+
+#ifdef SSSE3
+void increment_counters8_from_bitmap_ssse3(unsigned char * counters,
+                                           unsigned char * bitmap,
+                                           unsigned int totalbits)
+#else
+void increment_counters8_from_bitmap_sse2(unsigned char * counters,
+                                          unsigned char * bitmap,
+                                          unsigned int totalbits)
+#endif
+{
+#ifdef SSSE3
+  const __m128i c1 =
+    _mm_set_epi32(0x01010101, 0x01010101, 0x00000000, 0x00000000);
+#endif
+
+  const __m128i c2 =
+    _mm_set_epi32(0x7fbfdfef, 0xf7fbfdfe, 0x7fbfdfef, 0xf7fbfdfe);
+
+  const __m128i c3 =
+    _mm_set_epi32(0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff);
+
+  auto * p = (unsigned short *)(bitmap);
+  auto * q = (__m128i *)(counters);
+  int r = (totalbits + 15) / 16;
+
+  for(int j=0; j<r; j++)
+    {
+      __m128i xmm0, xmm1, xmm2, xmm3;
+      xmm0 = _mm_loadu_si128((__m128i*)p++);
+#ifdef SSSE3
+      xmm1 = _mm_shuffle_epi8(xmm0, c1);
+#else
+      __m128i xmm6, xmm7;
+      xmm6 = _mm_unpacklo_epi8(xmm0, xmm0);
+      xmm7 = _mm_unpacklo_epi16(xmm6, xmm6);
+      xmm1 = _mm_unpacklo_epi32(xmm7, xmm7);
+#endif
+      xmm2 = _mm_or_si128(xmm1, c2);
+      xmm3 = _mm_cmpeq_epi8(xmm2, c3);
+      *q = _mm_sub_epi8(*q, xmm3);
+      q++;
+    }
+}
+
+#ifdef SSSE3
+void increment_counters32_from_bitmap_ssse3(unsigned int * counters,
+                                            unsigned char * bitmap,
+                                            unsigned int totalbits)
+#else
+void increment_counters32_from_bitmap_sse2(unsigned int * counters,
+                                           unsigned char * bitmap,
+                                           unsigned int totalbits)
+#endif
+{
+#ifdef SSSE3
+  const __m128i c1 =
+    _mm_set_epi32(0x01010101, 0x01010101, 0x00000000, 0x00000000);
+#endif
+
+  const __m128i c2 =
+    _mm_set_epi32(0x7fbfdfef, 0xf7fbfdfe, 0x7fbfdfef, 0xf7fbfdfe);
+
+  const __m128i c3 =
+    _mm_set_epi32(0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff);
+
+  auto * p = (unsigned short *)(bitmap);
+  auto * q = (__m128i *)(counters);
+  int r = (totalbits + 15) / 16;
+
+  for(int j=0; j<r; j++)
+    {
+      __m128i xmm0, xmm1, xmm2, xmm3, xmm4, xmm5;
+      xmm0 = _mm_loadu_si128((__m128i*)p++);
+#ifdef SSSE3
+      xmm1 = _mm_shuffle_epi8(xmm0, c1);
+#else
+      __m128i xmm6, xmm7;
+      xmm6 = _mm_unpacklo_epi8(xmm0, xmm0);
+      xmm7 = _mm_unpacklo_epi16(xmm6, xmm6);
+      xmm1 = _mm_unpacklo_epi32(xmm7, xmm7);
+#endif
+      xmm2 = _mm_or_si128(xmm1, c2);
+      xmm3 = _mm_cmpeq_epi8(xmm2, c3);
+      xmm4 = _mm_unpacklo_epi8(xmm3, xmm3);
+      xmm5 = _mm_unpackhi_epi8(xmm3, xmm3);
+      *q = _mm_sub_epi32(*q, _mm_unpacklo_epi16(xmm4, xmm4));
+      q++;
+      *q = _mm_sub_epi32(*q, _mm_unpackhi_epi16(xmm4, xmm4));
+      q++;
+      *q = _mm_sub_epi32(*q, _mm_unpacklo_epi16(xmm5, xmm5));
+      q++;
+      *q = _mm_sub_epi32(*q, _mm_unpackhi_epi16(xmm5, xmm5));
+      q++;
+    }
+}
+
+#ifdef SSSE3
+
+int64_t reverse_complement_blocks_ssse3(char * rc, char * seq, int64_t len)
+{
+  /*
+    Reverse complement whole blocks of 16 nucleotides from the end of
+    seq into the start of rc. Returns the number of symbols done.
+
+    All symbols outside the range 64-127 map to N. The remaining
+    64 entries of the complement map are split by the high nibble
+    into four tables of 16 entries, each looked up with PSHUFB using
+    the low nibble, and the right one is selected for each byte.
+  */
+
+  const __m128i * map = (const __m128i *) (chrmap_complement + 64);
+  const __m128i t4 = _mm_loadu_si128(map);
+  const __m128i t5 = _mm_loadu_si128(map + 1);
+  const __m128i t6 = _mm_loadu_si128(map + 2);
+  const __m128i t7 = _mm_loadu_si128(map + 3);
+  const __m128i c0f = _mm_set1_epi8(0x0f);
+  const __m128i cn = _mm_set1_epi8('N');
+  const __m128i rev = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7,
+                                   8, 9, 10, 11, 12, 13, 14, 15);
+
+  int64_t done = len & ~ (int64_t) 15;
+
+  for(int64_t i = 0; i < done; i += 16)
+    {
+      __m128i x, lo, hi, m4, m5, m6, m7, c;
+
+      x = _mm_loadu_si128((__m128i *) (seq + len - 16 - i));
+      lo = _mm_and_si128(x, c0f);
+      hi = _mm_and_si128(_mm_srli_epi16(x, 4), c0f);
+      m4 = _mm_cmpeq_epi8(hi, _mm_set1_epi8(4));
+      m5 = _mm_cmpeq_epi8(hi, _mm_set1_epi8(5));
+      m6 = _mm_cmpeq_epi8(hi, _mm_set1_epi8(6));
+      m7 = _mm_cmpeq_epi8(hi, _mm_set1_epi8(7));
+      c = _mm_andnot_si128(_mm_or_si128(_mm_or_si128(m4, m5),
+                                        _mm_or_si128(m6, m7)), cn);
+      c = _mm_or_si128(c, _mm_and_si128(m4, _mm_shuffle_epi8(t4, lo)));
+      c = _mm_or_si128(c, _mm_and_si128(m5, _mm_shuffle_epi8(t5, lo)));
+      c = _mm_or_si128(c, _mm_and_si128(m6, _mm_shuffle_epi8(t6, lo)));
+      c = _mm_or_si128(c, _mm_and_si128(m7, _mm_shuffle_epi8(t7, lo)));
+      _mm_storeu_si128((__m128i *) (rc + i), _mm_shuffle_epi8(c, rev));
+    }
+
+  return done;
+}
+
+int64_t reverse_blocks_ssse3(char * dst, char * src, int64_t len)
+{
+  /* Reverse whole blocks of 16 bytes from the end of src into dst. */
+
+  const __m128i rev = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7,
+                                   8, 9, 10, 11, 12, 13, 14, 15);
+
+  int64_t done = len & ~ (int64_t) 15;
+
+  for(int64_t i = 0; i < done; i += 16)
+    {
+      __m128i x = _mm_loadu_si128((__m128i *) (src + len - 16 - i));
+      _mm_storeu_si128((__m128i *) (dst + i), _mm_shuffle_epi8(x, rev));
+    }
+
+  return done;
+}
+
+#endif
+
 #else
 
 #error Unknown architecture
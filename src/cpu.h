@@ -68,8 +68,30 @@ void increment_counters_from_bitmap_sse2(count_t * counters,
 void increment_counters_from_bitmap_ssse3(count_t * counters,
                                           unsigned char * bitmap,
                                           unsigned int totalbits);
+void increment_counters8_from_bitmap_sse2(unsigned char * counters,
+                                          unsigned char * bitmap,
+                                          unsigned int totalbits);
+void increment_counters8_from_bitmap_ssse3(unsigned char * counters,
+                                           unsigned char * bitmap,
+                                           unsigned int totalbits);
+void increment_counters32_from_bitmap_sse2(unsigned int * counters,
+                                           unsigned char * bitmap,
+                                           unsigned int totalbits);
+void increment_counters32_from_bitmap_ssse3(unsigned int * counters,
+                                            unsigned char * bitmap,
+                                            unsigned int totalbits);
+int64_t reverse_complement_blocks_ssse3(char * rc, char * seq, int64_t len);
+int64_t reverse_blocks_ssse3(char * dst, char * src, int64_t len);
 #else
 void increment_counters_from_bitmap(count_t * counters,
                                     unsigned char * bitmap,
                                     unsigned int totalbits);
+void increment_counters8_from_bitmap(unsigned char * counters,
+                                     unsigned char * bitmap,
+                                     unsigned int totalbits);
+void increment_counters32_from_bitmap(unsigned int * counters,
+                                      unsigned char * bitmap,
+                                      unsigned int totalbits);
+int64_t reverse_complement_blocks(char * rc, char * seq, int64_t len);
+int64_t reverse_blocks(char * dst, char * src, int64_t len);
 #endif
@@ -68,6 +68,43 @@ static uint64_t fragment_rev_no = 0;
 static uint64_t fragment_discarded_no = 0;
 static uint64_t fragment_discarded_rev_no = 0;
 
+/*
+  Patterns of up to 64 symbols are matched with the bit-parallel
+  shift-and algorithm. Bit j of cut_masks[c] is set if symbol c is
+  compatible with pattern position j, taking IUPAC ambiguity into
+  account. Longer (or empty) patterns use the direct comparison.
+*/
+
+static bool cut_shift_and = false;
+static uint64_t cut_masks[256];
+static uint64_t cut_final = 0;
+
+static char * cut_rc = nullptr;
+static int64_t cut_rc_alloc = 0;
+
+static void cut_compile(char * pattern, int pattern_length)
+{
+  cut_shift_and = (pattern_length > 0) && (pattern_length <= 64);
+  if (! cut_shift_and)
+    {
+      return;
+    }
+
+  for(int c = 0; c < 256; c++)
+    {
+      uint64_t mask = 0;
+      for(int j = 0; j < pattern_length; j++)
+        {
+          if (chrmap_4bit[(unsigned char)(pattern[j])] & chrmap_4bit[c])
+            {
+              mask |= 1ULL << j;
+            }
+        }
+      cut_masks[c] = mask;
+    }
+  cut_final = 1ULL << (pattern_length - 1);
+}
+
 int cut_one(fastx_handle h,
             FILE * fp_fastaout,
             FILE * fp_fastaout_discarded,
@@ -82,7 +119,12 @@ int cut_one(fastx_handle h,
   int seq_length = fasta_get_sequence_length(h);
 
   /* get reverse complement */
-  char * rc = (char *) xmalloc(seq_length + 1);
+  if (seq_length + 1 > cut_rc_alloc)
+    {
+      cut_rc_alloc = seq_length + 1;
+      cut_rc = (char *) xrealloc(cut_rc, cut_rc_alloc);
+    }
+  char * rc = cut_rc;
   reverse_complement(rc, seq, seq_length);
 
   int frag_start = 0;
@@ -92,16 +134,35 @@ int cut_one(fastx_handle h,
   int rc_start = seq_length;
   int rc_length = 0;
 
+  /* state of the shift-and matcher after the first pattern_length-1 symbols */
+  uint64_t state = 0;
+  if (cut_shift_and)
+    {
+      for(int k = 0; (k < pattern_length - 1) && (k < seq_length); k++)
+        {
+          state = ((state << 1) | 1) & cut_masks[(unsigned char)(seq[k])];
+        }
+    }
+
   for(int i = 0; i < seq_length - pattern_length + 1; i++)
     {
       bool match = true;
-      for(int j = 0; j < pattern_length; j++)
+      if (cut_shift_and)
+        {
+          unsigned char x = seq[i + pattern_length - 1];
+          state = ((state << 1) | 1) & cut_masks[x];
+          match = state & cut_final;
+        }
+      else
         {
-          if ((chrmap_4bit[(unsigned char)(pattern[j])] &
-               chrmap_4bit[(unsigned char)(seq[i+j])]) == 0)
+          for(int j = 0; j < pattern_length; j++)
             {
-              match = false;
-              break;
+              if ((chrmap_4bit[(unsigned char)(pattern[j])] &
+                   chrmap_4bit[(unsigned char)(seq[i+j])]) == 0)
+                {
+                  match = false;
+                  break;
+                }
             }
         }
 
@@ -242,8 +303,6 @@ int cut_one(fastx_handle h,
         }
     }
 
-  xfree(rc);
-
   return matches;
 }
 
@@ -368,6 +427,8 @@ void cut()
       fatal("No reverse sequence cut site (_) found in pattern");
     }
 
+  cut_compile(pattern, n - 2);
+
   progress_init("Cutting sequences", filesize);
 
   int64_t cut = 0;
@@ -435,4 +496,11 @@ void cut()
     }
 
   fasta_close(h);
+
+  if (cut_rc)
+    {
+      xfree(cut_rc);
+      cut_rc = nullptr;
+      cut_rc_alloc = 0;
+    }
 }
@@ -108,67 +108,65 @@ char * db_getquality(uint64_t seqno)
     }
 }
 
-void db_read(const char * filename, int upcase)
+/* state of the reading of sequences, kept between the shards */
+static uint64_t dataalloc = 0;
+static uint64_t datalen = 0;
+static size_t seqindex_alloc = 0;
+static int64_t discarded_short = 0;
+static int64_t discarded_long = 0;
+static int64_t discarded_unoise = 0;
+
+static bool db_accept_record(size_t sequencelength, int64_t abundance)
 {
-  h = fastx_open(filename);
+  /* apply the length and abundance limits, counting the discarded */
 
-  if (!h)
+  if (sequencelength < (size_t)opt_minseqlength)
     {
-      fatal("Unrecognized file type (not proper FASTA or FASTQ format)");
+      discarded_short++;
+      return false;
     }
-
-  is_fastq = fastx_is_fastq(h);
-
-  int64_t filesize = fastx_get_size(h);
-
-  char * prompt = nullptr;
-  if (xsprintf(& prompt, "Reading file %s", filename) == -1)
+  else if (sequencelength > (size_t)opt_maxseqlength)
     {
-      fatal("Out of memory");
+      discarded_long++;
+      return false;
     }
+  else if (opt_cluster_unoise && (abundance < (int64_t)opt_minsize))
+    {
+      discarded_unoise++;
+      return false;
+    }
+  return true;
+}
 
-  progress_init(prompt, filesize);
-
-  longest = 0;
-  shortest = LONG_MAX;
-  longestheader = 0;
-  sequences = 0;
-  nucleotides = 0;
-
-  int64_t discarded_short = 0;
-  int64_t discarded_long = 0;
-  int64_t discarded_unoise = 0;
-
-  /* allocate space for data */
-  uint64_t dataalloc = 0;
-  datap = nullptr;
-  uint64_t datalen = 0;
-
-  /* allocate space for index */
-  size_t seqindex_alloc = 0;
-  seqindex = nullptr;
+static void db_read_records(int upcase,
+                            uint64_t limit,
+                            bool show_progress,
+                            db_select_t select)
+{
+  /* read sequences from h until EOF or until limit sequences are kept;
+     if select is given, only the records it selects are kept */
 
-  while(fastx_next(h,
+  uint64_t kept = 0;
+  while((kept < limit) &&
+        fastx_next(h,
                    ! opt_notrunclabels,
                    upcase ? chrmap_upcase : chrmap_no_change))
     {
       size_t headerlength = fastx_get_header_length(h);
       size_t sequencelength = fastx_get_sequence_length(h);
-      int64_t abundance = fastx_get_abundance(h);
 
-      if (sequencelength < (size_t)opt_minseqlength)
-        {
-          discarded_short++;
-        }
-      else if (sequencelength > (size_t)opt_maxseqlength)
+      /* parse the header annotations once and keep their spans */
+      struct header_attributes_s attributes;
+      header_scan_attributes(fastx_get_header(h), headerlength, & attributes);
+      int64_t abundance = header_get_size_attributes(fastx_get_header(h),
+                                                     & attributes);
+      if (abundance == 0)
         {
-          discarded_long++;
+          abundance = 1;
         }
-      else if (opt_cluster_unoise && (abundance < (int64_t)opt_minsize))
-        {
-          discarded_unoise++;
-        }
-      else
+
+      if (db_accept_record(sequencelength, abundance) &&
+          ((! select) || select(sequencelength, abundance)))
         {
           /* grow space for data, if necessary */
           size_t dataalloc_old = dataalloc;
@@ -229,9 +227,11 @@ void db_read(const char * filename, int upcase)
           seqindex_p->seq_p = sequence_p;
           seqindex_p->qual_p = quality_p;
           seqindex_p->size = abundance;
+          seqindex_p->attributes = attributes;
 
           /* update statistics */
           sequences++;
+          kept++;
           nucleotides += sequencelength;
           if (sequencelength > longest)
             {
@@ -246,12 +246,30 @@ void db_read(const char * filename, int upcase)
               longestheader = headerlength;
             }
         }
-      progress_update(fastx_get_position(h));
+      if (show_progress)
+        {
+          progress_update(fastx_get_position(h));
+        }
     }
+}
 
-  progress_done();
-  xfree(prompt);
-  fastx_close(h);
+static void db_reset()
+{
+  longest = 0;
+  shortest = LONG_MAX;
+  longestheader = 0;
+  sequences = 0;
+  nucleotides = 0;
+  datap = nullptr;
+  seqindex = nullptr;
+  dataalloc = 0;
+  datalen = 0;
+  seqindex_alloc = 0;
+}
+
+static void db_show_info()
+{
+  /* show statistics of the sequences read and warn about discarded ones */
 
   if (!opt_quiet)
     {
@@ -356,6 +374,353 @@ void db_read(const char * filename, int upcase)
   show_rusage();
 }
 
+static void db_read_file(const char * filename,
+                         int upcase,
+                         bool append,
+                         db_select_t select)
+{
+  h = fastx_open(filename);
+
+  if (!h)
+    {
+      fatal("Unrecognized file type (not proper FASTA or FASTQ format)");
+    }
+
+  /* quality scores are only kept if all sequences have them */
+  if (append && (sequences > 0))
+    {
+      is_fastq = is_fastq && fastx_is_fastq(h);
+    }
+  else
+    {
+      is_fastq = fastx_is_fastq(h);
+    }
+
+  int64_t filesize = fastx_get_size(h);
+
+  char * prompt = nullptr;
+  if (xsprintf(& prompt, "Reading file %s", filename) == -1)
+    {
+      fatal("Out of memory");
+    }
+
+  progress_init(prompt, filesize);
+
+  discarded_short = 0;
+  discarded_long = 0;
+  discarded_unoise = 0;
+
+  if (append && (sequences > 0))
+    {
+      /* continue after the data already present, e.g. from an UDB file */
+      datalen = 0;
+      for(uint64_t i = 0; i < sequences; i++)
+        {
+          seqinfo_t * p = seqindex + i;
+          datalen = MAX(datalen, p->header_p + p->headerlen + 1);
+          datalen = MAX(datalen, p->seq_p + p->seqlen + 1);
+          if (is_fastq)
+            {
+              datalen = MAX(datalen, p->qual_p + p->seqlen + 1);
+            }
+        }
+      dataalloc = datalen;
+      seqindex_alloc = sequences * sizeof(seqinfo_t);
+    }
+  else
+    {
+      db_reset();
+    }
+
+  db_read_records(upcase, UINT64_MAX, true, select);
+
+  progress_done();
+  xfree(prompt);
+  fastx_close(h);
+  h = nullptr;
+
+  if (! select)
+    {
+      db_show_info();
+    }
+}
+
+void db_read(const char * filename, int upcase)
+{
+  db_read_file(filename, upcase, false, nullptr);
+}
+
+void db_read_append(const char * filename, int upcase)
+{
+  db_read_file(filename, upcase, true, nullptr);
+}
+
+void db_read_append_selected(const char * filename,
+                             int upcase,
+                             db_select_t select)
+{
+  /* append only the records selected, in the order of the file */
+  db_read_file(filename, upcase, true, select);
+}
+
+void db_scan(const char * filename, db_scan_t add)
+{
+  /*
+    Pass over a FASTA or FASTQ file without keeping the sequences, for
+    the sharded clustering with --shard_count. Each record that would
+    be kept by db_read() is given to add(), and the statistics of the
+    whole file are shown as if it had been read.
+  */
+
+  db_reset();
+
+  h = fastx_open(filename);
+  if (!h)
+    {
+      fatal("Unrecognized file type (not proper FASTA or FASTQ format)");
+    }
+
+  char * prompt = nullptr;
+  if (xsprintf(& prompt, "Scanning file %s", filename) == -1)
+    {
+      fatal("Out of memory");
+    }
+
+  progress_init(prompt, fastx_get_size(h));
+
+  discarded_short = 0;
+  discarded_long = 0;
+  discarded_unoise = 0;
+
+  while(fastx_next(h, ! opt_notrunclabels, chrmap_no_change))
+    {
+      size_t headerlength = fastx_get_header_length(h);
+      size_t sequencelength = fastx_get_sequence_length(h);
+      int64_t abundance = header_get_size(fastx_get_header(h),
+                                          headerlength);
+      if (abundance == 0)
+        {
+          abundance = 1;
+        }
+      if (db_accept_record(sequencelength, abundance))
+        {
+          add(sequencelength, abundance);
+          sequences++;
+          nucleotides += sequencelength;
+          longest = MAX(longest, sequencelength);
+          shortest = MIN(shortest, sequencelength);
+          longestheader = MAX(longestheader, headerlength);
+        }
+      progress_update(fastx_get_position(h));
+    }
+
+  progress_done();
+  xfree(prompt);
+  fastx_close(h);
+  h = nullptr;
+
+  db_show_info();
+
+  db_reset();
+}
+
+/*
+  Sharded reading of a database too large to keep in memory at once,
+  for the searches with --dbshard_size. A first scan over the file
+  splits the sequences into consecutive shards of about the given
+  memory size and collects what the search needs to know about the
+  whole database. Each pass over the database then reads the shards in
+  order, each replacing the sequences of the previous one. UDB files
+  are read by udb_shards_scan() and udb_shards_read().
+*/
+
+static const char * shards_filename = nullptr;
+static bool shards_udb = false;
+static uint64_t shards_size = 0;
+static uint64_t shards_count = 0;
+static uint64_t shards_alloc = 0;
+static uint64_t * shards_first = nullptr;
+static uint64_t shards_used = 0;
+
+void db_shards_add(uint64_t headerlen, uint64_t seqlen)
+{
+  /* add a sequence to the shards while scanning the database */
+
+  /* approximate memory for the sequence and its k-mer index entries */
+  uint64_t memory = sizeof(seqinfo_t) + headerlen + 1 + 5 * (seqlen + 1);
+
+  if ((shards_used > 0) && (shards_used + memory > shards_size))
+    {
+      if (shards_count + 2 > shards_alloc)
+        {
+          shards_alloc += 1024;
+          shards_first = (uint64_t *) xrealloc(shards_first,
+                                               shards_alloc * sizeof(uint64_t));
+        }
+      shards_first[++shards_count] = sequences;
+      shards_used = 0;
+    }
+  shards_used += memory;
+
+  sequences++;
+  nucleotides += seqlen;
+  longest = MAX(longest, seqlen);
+  shortest = MIN(shortest, seqlen);
+  longestheader = MAX(longestheader, headerlen);
+}
+
+void db_shards_open(const char * filename, uint64_t shard_size)
+{
+  shards_filename = filename;
+  shards_size = shard_size;
+  shards_udb = udb_detect_isudb(filename);
+  shards_alloc = 1024;
+  shards_first = (uint64_t *) xmalloc(shards_alloc * sizeof(uint64_t));
+  shards_first[0] = 0;
+  shards_count = 0;
+  shards_used = 0;
+
+  db_reset();
+
+  if (shards_udb)
+    {
+      udb_shards_scan(filename);
+    }
+  else
+    {
+      h = fastx_open(filename);
+      if (!h)
+        {
+          fatal("Unrecognized file type (not proper FASTA or FASTQ format)");
+        }
+
+      char * prompt = nullptr;
+      if (xsprintf(& prompt, "Scanning file %s", filename) == -1)
+        {
+          fatal("Out of memory");
+        }
+
+      progress_init(prompt, fastx_get_size(h));
+
+      discarded_short = 0;
+      discarded_long = 0;
+      discarded_unoise = 0;
+
+      while(fastx_next(h, ! opt_notrunclabels, chrmap_no_change))
+        {
+          size_t headerlength = fastx_get_header_length(h);
+          size_t sequencelength = fastx_get_sequence_length(h);
+          int64_t abundance = header_get_size(fastx_get_header(h),
+                                              headerlength);
+          if (abundance == 0)
+            {
+              abundance = 1;
+            }
+          if (db_accept_record(sequencelength, abundance))
+            {
+              db_shards_add(headerlength, sequencelength);
+            }
+          progress_update(fastx_get_position(h));
+        }
+
+      progress_done();
+      xfree(prompt);
+      fastx_close(h);
+      h = nullptr;
+    }
+
+  db_show_info();
+
+  if (sequences > 0)
+    {
+      shards_count++;
+    }
+  shards_first[shards_count] = sequences;
+
+  if (!opt_quiet)
+    {
+      fprintf(stderr, "Database split into %" PRIu64 " %s\n",
+              shards_count, shards_count == 1 ? "shard" : "shards");
+    }
+
+  if (opt_log)
+    {
+      fprintf(fp_log, "Database split into %" PRIu64 " %s\n\n",
+              shards_count, shards_count == 1 ? "shard" : "shards");
+    }
+
+  db_reset();
+}
+
+uint64_t db_shards_getcount()
+{
+  return shards_count;
+}
+
+uint64_t db_shards_getfirst(uint64_t shard)
+{
+  /* number of the first sequence of the shard in the whole database */
+  return shards_first[shard];
+}
+
+void db_shards_read(uint64_t shard)
+{
+  /* replace the sequences in memory with those of the given shard;
+     the shards must be read in order, starting with shard 0 */
+
+  db_free();
+  db_reset();
+
+  uint64_t count = shards_first[shard + 1] - shards_first[shard];
+
+  if (shards_udb)
+    {
+      udb_shards_read(shards_first[shard], count);
+      return;
+    }
+
+  if (shard == 0)
+    {
+      h = fastx_open(shards_filename);
+      if (!h)
+        {
+          fatal("Unrecognized file type (not proper FASTA or FASTQ format)");
+        }
+    }
+
+  is_fastq = fastx_is_fastq(h);
+  db_read_records(0, count, false, nullptr);
+
+  if (sequences != count)
+    {
+      fatal("Database file changed while searching (%s)", shards_filename);
+    }
+
+  if (shard + 1 == shards_count)
+    {
+      fastx_close(h);
+      h = nullptr;
+    }
+}
+
+void db_shards_close()
+{
+  db_free();
+  db_reset();
+  if (h)
+    {
+      fastx_close(h);
+      h = nullptr;
+    }
+  if (shards_udb)
+    {
+      udb_shards_close();
+    }
+  xfree(shards_first);
+  shards_first = nullptr;
+  shards_count = 0;
+}
+
 uint64_t db_getsequencecount()
 {
   return sequences;
@@ -393,6 +758,100 @@ void db_free()
     }
 }
 
+struct db_piece_s
+{
+  size_t offset;
+  size_t length;
+  size_t * pointer;
+};
+
+static int db_compare_pieces(const void * a, const void * b)
+{
+  auto * x = (struct db_piece_s *) a;
+  auto * y = (struct db_piece_s *) b;
+
+  if (x->offset < y->offset)
+    {
+      return -1;
+    }
+  else if (x->offset > y->offset)
+    {
+      return +1;
+    }
+  else
+    {
+      return 0;
+    }
+}
+
+void db_keep(const uint64_t * seqnos, uint64_t count)
+{
+  /*
+    Keep only the given sequences, given in increasing order, and
+    release the memory used by the others. The headers, sequences and
+    quality scores kept are moved down in place in the order they are
+    stored, which after sorting is not the order of the sequences, so
+    no second copy of them is needed.
+  */
+
+  longest = 0;
+  shortest = LONG_MAX;
+  longestheader = 0;
+  nucleotides = 0;
+
+  uint64_t piececount = is_fastq ? 3 * count : 2 * count;
+  auto * pieces = (struct db_piece_s *)
+    xmalloc(MAX(piececount, 1) * sizeof(struct db_piece_s));
+
+  uint64_t n = 0;
+  for(uint64_t i = 0; i < count; i++)
+    {
+      seqinfo_t * q = seqindex + i;
+      * q = seqindex[seqnos[i]];
+
+      pieces[n].offset = q->header_p;
+      pieces[n].length = q->headerlen + 1;
+      pieces[n].pointer = & q->header_p;
+      n++;
+
+      pieces[n].offset = q->seq_p;
+      pieces[n].length = q->seqlen + 1;
+      pieces[n].pointer = & q->seq_p;
+      n++;
+
+      if (is_fastq)
+        {
+          pieces[n].offset = q->qual_p;
+          pieces[n].length = q->seqlen + 1;
+          pieces[n].pointer = & q->qual_p;
+          n++;
+        }
+
+      nucleotides += q->seqlen;
+      longest = MAX(longest, q->seqlen);
+      shortest = MIN(shortest, q->seqlen);
+      longestheader = MAX(longestheader, q->headerlen);
+    }
+
+  qsort(pieces, piececount, sizeof(struct db_piece_s), db_compare_pieces);
+
+  datalen = 0;
+  for(uint64_t i = 0; i < piececount; i++)
+    {
+      memmove(datap + datalen, datap + pieces[i].offset, pieces[i].length);
+      * pieces[i].pointer = datalen;
+      datalen += pieces[i].length;
+    }
+
+  xfree(pieces);
+
+  dataalloc = MAX(datalen, 1);
+  datap = (char *) xrealloc(datap, dataalloc);
+  seqindex_alloc = MAX(count, 1) * sizeof(seqinfo_t);
+  seqindex = (seqinfo_t *) xrealloc(seqindex, seqindex_alloc);
+  sequences = count;
+}
+
 int compare_bylength(const void * a, const void * b)
 {
   auto * x = (seqinfo_t *) a;
@@ -535,11 +994,11 @@ inline int compare_byabundance(const void * a, const void * b)
     }
 }
 
-void db_sortbylength()
+void db_sortbylength(uint64_t first)
 {
   progress_init("Sorting by length", 100);
-  qsort(seqindex,
-        sequences,
+  qsort(seqindex + first,
+        sequences - first,
         sizeof(seqinfo_t),
         compare_bylength);
   progress_done();
@@ -555,11 +1014,11 @@ void db_sortbylength_shortest_first()
   progress_done();
 }
 
-void db_sortbyabundance()
+void db_sortbyabundance(uint64_t first)
 {
   progress_init("Sorting by abundance", 100);
-  qsort(seqindex,
-        sequences,
+  qsort(seqindex + first,
+        sequences - first,
         sizeof(seqinfo_t),
         compare_byabundance);
   progress_done();
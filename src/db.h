@@ -69,6 +69,7 @@ struct seqinfo_s
   unsigned int headerlen;
   unsigned int seqlen;
   unsigned int size;
+  struct header_attributes_s attributes;
 };
 
 typedef struct seqinfo_s seqinfo_t;
@@ -101,9 +102,29 @@ inline uint64_t db_getheaderlen(uint64_t seqno)
   return seqindex[seqno].headerlen;
 }
 
+inline struct header_attributes_s * db_getattributes(uint64_t seqno)
+{
+  return & seqindex[seqno].attributes;
+}
+
+typedef bool (*db_select_t)(uint64_t seqlen, uint64_t abundance);
+typedef void (*db_scan_t)(uint64_t seqlen, uint64_t abundance);
+
 void db_read(const char * filename, int upcase);
+void db_read_append(const char * filename, int upcase);
+void db_read_append_selected(const char * filename,
+                             int upcase,
+                             db_select_t select);
+void db_scan(const char * filename, db_scan_t add);
 void db_free();
 
+void db_shards_open(const char * filename, uint64_t shard_size);
+void db_shards_add(uint64_t headerlen, uint64_t seqlen);
+uint64_t db_shards_getcount();
+uint64_t db_shards_getfirst(uint64_t shard);
+void db_shards_read(uint64_t shard);
+void db_shards_close();
+
 uint64_t db_getsequencecount();
 uint64_t db_getnucleotidecount();
 uint64_t db_getlongestheader();
@@ -111,12 +132,14 @@ uint64_t db_getlongestsequence();
 uint64_t db_getshortestsequence();
 
 /* Note: the sorting functions below must be called after db_read,
-   but before dbindex_prepare */
+   but before dbindex_prepare. Sequences before first keep their order. */
 
-void db_sortbylength();
+void db_sortbylength(uint64_t first = 0);
 void db_sortbylength_shortest_first();
 
-void db_sortbyabundance();
+void db_sortbyabundance(uint64_t first = 0);
+
+void db_keep(const uint64_t * seqnos, uint64_t count);
 
 bool db_is_fastq();
 char * db_getquality(uint64_t seqno);
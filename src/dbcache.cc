@@ -0,0 +1,312 @@
+/*
+
+  VSEARCH5D: a modified version of VSEARCH
+
+  Copyright (C) 2016-2021, Akifumi S. Tanabe
+
+  Contact: Akifumi S. Tanabe
+  https://github.com/astanabe/vsearch5d
+
+  Original version of VSEARCH
+  Copyright (C) 2014-2021, Torbjorn Rognes, Frederic Mahe and Tomas Flouri
+  All rights reserved.
+
+
+  This software is dual-licensed and available under a choice
+  of one of two licenses, either under the terms of the GNU
+  General Public License version 3 or the BSD 2-Clause License.
+
+
+  GNU General Public License version 3
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+  The BSD 2-Clause License
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "vsearch5d.h"
+
+/*
+  Database index cache (--index_cache). The masked sequences and the
+  k-mer index of a FASTA/FASTQ database are saved as an UDB file in the
+  cache directory, named by a hash of the contents of the database file
+  and of the options that affect the sequences or the index. Later runs
+  with the same database and options read that file instead of reading,
+  masking and indexing the database again. Entries are written to a
+  temporary file and renamed, so that concurrent runs never see a
+  partial entry. Databases with quality scores are not cached, as UDB
+  files do not keep them.
+*/
+
+#define DBCACHE_VERSION 1
+#define DBCACHE_CHUNK (1024 * 1024)
+
+static const char * dbcache_filename = nullptr;
+static uint64_t dbcache_key = 0;
+
+static void dbcache_warning(const char * message, const char * name)
+{
+  fprintf(stderr, "WARNING: %s (%s)\n", message, name);
+  if (opt_log)
+    {
+      fprintf(fp_log, "WARNING: %s (%s)\n", message, name);
+    }
+}
+
+static uint64_t dbcache_getkey(const char * filename, bool masked)
+{
+  /* hash the database file contents and the relevant options */
+
+  if (dbcache_filename && (strcmp(dbcache_filename, filename) == 0))
+    {
+      return dbcache_key;
+    }
+
+  FILE * fp = fopen_input(filename);
+  if (! fp)
+    {
+      fatal("Unable to open input file for reading (%s)", filename);
+    }
+
+  xstat_t fs;
+  if (xstat(filename, & fs))
+    {
+      fatal("Unable to get status for input file (%s)", filename);
+    }
+
+  char * buffer = (char *) xmalloc(DBCACHE_CHUNK);
+  uint64_t key = DBCACHE_VERSION;
+  uint64_t done = 0;
+
+  progress_init("Hashing database", fs.st_size);
+  size_t n = 0;
+  while ((n = fread(buffer, 1, DBCACHE_CHUNK, fp)) > 0)
+    {
+      key = CityHash64WithSeed(buffer, n, key);
+      done += n;
+      progress_update(done);
+    }
+  progress_done();
+  fclose(fp);
+
+  int len = snprintf(buffer, DBCACHE_CHUNK,
+                     "%" PRIu64 " %" PRId64 " %" PRId64 " %d %d %d"
+                     " %" PRId64 " %" PRId64,
+                     done,
+                     opt_wordlength,
+                     opt_dbmask,
+                     opt_hardmask ? 1 : 0,
+                     masked ? 1 : 0,
+                     opt_notrunclabels ? 1 : 0,
+                     opt_minseqlength,
+                     opt_maxseqlength);
+  if (opt_maxwordfreq < 1.0)
+    {
+      /* the stop list is part of the saved index */
+      len += snprintf(buffer + len, DBCACHE_CHUNK - len,
+                      " %.6f", opt_maxwordfreq);
+    }
+  if (opt_minimizer_window > 1)
+    {
+      len += snprintf(buffer + len, DBCACHE_CHUNK - len,
+                      " w%" PRId64, opt_minimizer_window);
+    }
+  key = CityHash64WithSeed(buffer, len, key);
+
+  xfree(buffer);
+
+  dbcache_filename = filename;
+  dbcache_key = key;
+  return key;
+}
+
+bool dbcache_usable(const char * filename)
+{
+  /*
+    The key is a hash of the contents of the database file, which is
+    then read again, so only regular files can be cached. A pipe or
+    standard input would be consumed by the hashing. The cache is
+    optional, so a missing cache directory only gives a warning.
+  */
+
+  static bool warned = false;
+
+  xstat_t fs;
+  if ((xstat(opt_index_cache, & fs) != 0) || ! S_ISDIR(fs.st_mode))
+    {
+      if (! warned)
+        {
+          dbcache_warning("Index cache not used, directory not found",
+                          opt_index_cache);
+          warned = true;
+        }
+      return false;
+    }
+
+  if ((xstat(filename, & fs) != 0) || ! S_ISREG(fs.st_mode))
+    {
+      if (! warned)
+        {
+          dbcache_warning("Index cache not used, database is not a regular"
+                          " file", filename);
+          warned = true;
+        }
+      return false;
+    }
+
+  return true;
+}
+
+void dbcache_unwritable(const char * temp)
+{
+  /* the cache directory may be read-only, then the entry is not saved */
+
+  static bool warned = false;
+
+  if (! warned)
+    {
+      dbcache_warning("Index cache not written, unable to create file",
+                      temp);
+      warned = true;
+    }
+}
+
+char * dbcache_entry(const char * filename, bool masked,
+                     const char * extension)
+{
+  /* name of the cache entry for the database, which may not exist */
+
+  char * path = nullptr;
+  if (xsprintf(& path, "%s/%016" PRIx64 ".%s",
+               opt_index_cache,
+               dbcache_getkey(filename, masked),
+               extension) == -1)
+    {
+      fatal("Out of memory");
+    }
+  return path;
+}
+
+bool dbcache_exists(const char * path)
+{
+  xstat_t fs;
+  return (xstat(path, & fs) == 0) && S_ISREG(fs.st_mode);
+}
+
+char * dbcache_tempname(const char * path)
+{
+  char * temp = nullptr;
+  if (xsprintf(& temp, "%s.%d.tmp", path, (int) getpid()) == -1)
+    {
+      fatal("Out of memory");
+    }
+  return temp;
+}
+
+void dbcache_commit(char * temp, const char * path)
+{
+  /* move a completely written entry into place */
+
+  if (rename(temp, path))
+    {
+      remove(temp);
+    }
+  xfree(temp);
+}
+
+bool dbcache_read(const char * filename, bool masked)
+{
+  /*
+    Read the sequences and index of the database from the cache,
+    returning false if there is no entry for it.
+  */
+
+  if (! dbcache_usable(filename))
+    {
+      return false;
+    }
+
+  char * path = dbcache_entry(filename, masked, "udb");
+  bool found = dbcache_exists(path) && udb_detect_isudb(path);
+
+  if (found)
+    {
+      if (! opt_quiet)
+        {
+          fprintf(stderr, "Using cached index %s\n", path);
+        }
+      if (opt_log)
+        {
+          fprintf(fp_log, "Using cached index %s\n", path);
+        }
+      udb_read(path, true, true);
+    }
+
+  xfree(path);
+  return found;
+}
+
+void dbcache_write(const char * filename, bool masked)
+{
+  /* save the database and index in memory to the cache */
+
+  if (db_is_fastq() || ! dbcache_usable(filename))
+    {
+      return;
+    }
+
+  char * path = dbcache_entry(filename, masked, "udb");
+  char * temp = dbcache_tempname(path);
+
+  int fd = xopen_write(temp);
+  if (fd < 0)
+    {
+      dbcache_unwritable(temp);
+      xfree(temp);
+      xfree(path);
+      return;
+    }
+
+  /* udb_write closes the file */
+  udb_write(fd, nullptr);
+
+  dbcache_commit(temp, path);
+  xfree(path);
+}
@@ -72,11 +72,388 @@ unsigned int kmerhashsize;
 uint64_t kmerindexsize;
 unsigned int dbindex_count;
 uhandle_s * dbindex_uh;
+bitmap_t * dbindex_stoplist = nullptr;
+unsigned int dbindex_stopcount = 0;
+unsigned int dbindex_stop_ppm = 0;
 
 #define BITMAP_THRESHOLD 8
 
 static unsigned int bitmap_mincount;
 
+/*
+  With more than one thread, the counting and filling passes over the
+  database are split into contiguous ranges of sequences, one per
+  thread, each with its own unique k-mer handle and k-mer counts. The
+  counts per range give each thread its own offsets into the k-mer
+  lists, so the lists are filled in the same order as by the serial
+  code without any locking. Range starts are multiples of 8 so that
+  no two threads set bits in the same byte of a bitmap. The number of
+  ranges is limited by the memory needed for the counts.
+*/
+
+#define DBINDEX_RANGE_COUNTS_MAX (1 << 26)
+#define DBINDEX_PROGRESS_STEP 1024
+
+static pthread_t * dbindex_pthread;
+static pthread_attr_t dbindex_attr;
+static pthread_mutex_t dbindex_mutex;
+static bool dbindex_filling;
+static int dbindex_seqmask;
+static unsigned int dbindex_ranges = 0;
+static unsigned int * dbindex_range_start = nullptr;
+static unsigned int * dbindex_range_kmercount = nullptr;
+static unsigned int dbindex_progress;
+
+static void * dbindex_worker(void * vp)
+{
+  auto t = (unsigned int) (int64_t) vp;
+  unsigned int * counts = dbindex_range_kmercount + (uint64_t) t * kmerhashsize;
+  struct uhandle_s * uh = unique_init();
+
+  if (! dbindex_filling)
+    {
+      memset(counts, 0, kmerhashsize * sizeof(unsigned int));
+    }
+
+  for(unsigned int seqno = dbindex_range_start[t];
+      seqno < dbindex_range_start[t+1];
+      seqno++)
+    {
+      unsigned int uniquecount;
+      unsigned int * uniquelist;
+      dbindex_words(uh,
+                    db_getsequencelen(seqno), db_getsequence(seqno),
+                    & uniquecount, & uniquelist, dbindex_seqmask);
+
+      if (dbindex_filling)
+        {
+          for(unsigned int i = 0; i < uniquecount; i++)
+            {
+              unsigned int kmer = uniquelist[i];
+              if (kmerbitmap[kmer])
+                {
+                  bitmap_set(kmerbitmap[kmer], seqno);
+                }
+              else if (! dbindex_stopped(kmer))
+                {
+                  kmerindex[kmerhash[kmer] + (counts[kmer]++)] = seqno;
+                }
+            }
+        }
+      else
+        {
+          for(unsigned int i = 0; i < uniquecount; i++)
+            {
+              counts[uniquelist[i]]++;
+            }
+        }
+
+      if ((seqno + 1 - dbindex_range_start[t]) % DBINDEX_PROGRESS_STEP == 0)
+        {
+          xpthread_mutex_lock(&dbindex_mutex);
+          dbindex_progress += DBINDEX_PROGRESS_STEP;
+          progress_update(dbindex_progress);
+          xpthread_mutex_unlock(&dbindex_mutex);
+        }
+    }
+
+  unique_exit(uh);
+  return nullptr;
+}
+
+static void dbindex_threads_run(bool filling, int seqmask)
+{
+  dbindex_filling = filling;
+  dbindex_seqmask = seqmask;
+  dbindex_progress = 0;
+
+  xpthread_mutex_init(&dbindex_mutex, nullptr);
+  xpthread_attr_init(&dbindex_attr);
+  xpthread_attr_setdetachstate(&dbindex_attr, PTHREAD_CREATE_JOINABLE);
+
+  dbindex_pthread = (pthread_t *) xmalloc(dbindex_ranges * sizeof(pthread_t));
+
+  for(unsigned int t = 0; t < dbindex_ranges; t++)
+    {
+      xpthread_create(dbindex_pthread + t, &dbindex_attr,
+                      dbindex_worker, (void*)(int64_t)t);
+    }
+
+  for(unsigned int t = 0; t < dbindex_ranges; t++)
+    {
+      xpthread_join(dbindex_pthread[t], nullptr);
+    }
+
+  xfree(dbindex_pthread);
+  xpthread_attr_destroy(&dbindex_attr);
+  xpthread_mutex_destroy(&dbindex_mutex);
+}
+
+static void dbindex_ranges_init(unsigned int seqcount)
+{
+  /* split the sequences into ranges with similar amounts of residues */
+
+  uint64_t ranges = MIN((uint64_t) opt_threads,
+                        DBINDEX_RANGE_COUNTS_MAX / kmerhashsize);
+  ranges = MIN(ranges, (uint64_t) seqcount / 8);
+
+  if (ranges < 2)
+    {
+      dbindex_ranges = 0;
+      return;
+    }
+
+  dbindex_ranges = ranges;
+  dbindex_range_start = (unsigned int *)
+    xmalloc((dbindex_ranges + 1) * sizeof(unsigned int));
+  dbindex_range_kmercount = (unsigned int *)
+    xmalloc(dbindex_ranges * kmerhashsize * sizeof(unsigned int));
+
+  uint64_t nucleotides = db_getnucleotidecount();
+  uint64_t sum = 0;
+  unsigned int t = 1;
+  dbindex_range_start[0] = 0;
+  for(unsigned int seqno = 0; seqno < seqcount; seqno++)
+    {
+      if ((t < dbindex_ranges) && (seqno % 8 == 0) &&
+          (sum >= t * nucleotides / dbindex_ranges))
+        {
+          dbindex_range_start[t++] = seqno;
+        }
+      sum += db_getsequencelen(seqno);
+    }
+  while (t <= dbindex_ranges)
+    {
+      dbindex_range_start[t++] = seqcount;
+    }
+}
+
+static void dbindex_ranges_exit()
+{
+  if (dbindex_ranges)
+    {
+      xfree(dbindex_range_start);
+      xfree(dbindex_range_kmercount);
+      dbindex_range_start = nullptr;
+      dbindex_range_kmercount = nullptr;
+      dbindex_ranges = 0;
+    }
+}
+
+/*
+  Growable index (dbindex_prepare_growable), used when only some of the
+  sequences are added, such as the centroids when clustering. Memory is
+  allocated as sequences are added instead of from the k-mer counts of
+  all sequences. The list of each k-mer is a block in kmerindex, with
+  sizes 4, 6, 8, 12, 16, 24, ... elements, moved to a block of the next
+  size when full. Free blocks are kept in one list per size for reuse,
+  with the offset of the next free block in their first two elements.
+  When kmerindex is full it is compacted in place if more than a
+  quarter of it is free blocks, and enlarged if still more than four
+  fifths full. A k-mer gets a bitmap instead
+  of a list once it is found in at least one in BITMAP_THRESHOLD of the
+  indexed sequences and in at least DBINDEX_BITMAP_MINCOUNT of them.
+  The bitmaps and the index map grow together with the index.
+*/
+
+#define DBINDEX_BLOCK_CLASSES 64
+#define DBINDEX_BITMAP_MINCOUNT 64
+#define DBINDEX_NO_BLOCK UINT64_MAX
+
+static bool dbindex_growable = false;
+static bool dbindex_grow_bitmaps;
+static uint64_t dbindex_index_alloc;
+static uint64_t dbindex_index_live;
+static uint64_t dbindex_free_blocks[DBINDEX_BLOCK_CLASSES];
+static unsigned int dbindex_map_alloc;
+static unsigned int * dbindex_bitmap_kmers = nullptr;
+static unsigned int dbindex_bitmap_count;
+static unsigned int dbindex_bitmap_alloc;
+
+inline uint64_t dbindex_block_size(unsigned int c)
+{
+  return (uint64_t) ((c & 1) ? 6 : 4) << (c >> 1);
+}
+
+static unsigned int dbindex_block_class(unsigned int count)
+{
+  /* the smallest block for a list of count elements */
+
+  unsigned int c = 0;
+  while (dbindex_block_size(c) < count)
+    {
+      c++;
+    }
+  return c;
+}
+
+inline bool dbindex_block_full(unsigned int count)
+{
+  /* is count the size of a block, i.e. 4 or 6 times a power of two */
+
+  if (count < 4)
+    {
+      return false;
+    }
+  unsigned int x = count;
+  while ((x & 1) == 0)
+    {
+      x >>= 1;
+    }
+  return (x == 1) || ((x == 3) && (count >= 6));
+}
+
+static void dbindex_compact()
+{
+  /*
+    Move the lists down over the free blocks, in place. The start of
+    each list is marked in a bitmap and its first element replaced by
+    the kmer, with the element kept in kmerhash meanwhile.
+  */
+
+  bitmap_t * starts = bitmap_init(kmerindexsize);
+  bitmap_reset_all(starts);
+
+  for(unsigned int kmer = 0; kmer < kmerhashsize; kmer++)
+    {
+      if (kmercount[kmer] && ! kmerbitmap[kmer])
+        {
+          uint64_t block = kmerhash[kmer];
+          bitmap_set(starts, block);
+          kmerhash[kmer] = kmerindex[block];
+          kmerindex[block] = kmer;
+        }
+    }
+
+  uint64_t pos = 0;
+  for(uint64_t block = 0; block < kmerindexsize; block++)
+    {
+      if (bitmap_get(starts, block))
+        {
+          unsigned int kmer = kmerindex[block];
+          unsigned int count = kmercount[kmer];
+          memmove(kmerindex + pos, kmerindex + block,
+                  count * sizeof(unsigned int));
+          kmerindex[pos] = kmerhash[kmer];
+          kmerhash[kmer] = pos;
+          pos += dbindex_block_size(dbindex_block_class(count));
+        }
+    }
+
+  bitmap_free(starts);
+
+  kmerindexsize = pos;
+  dbindex_index_live = pos;
+
+  for(unsigned int c = 0; c < DBINDEX_BLOCK_CLASSES; c++)
+    {
+      dbindex_free_blocks[c] = DBINDEX_NO_BLOCK;
+    }
+}
+
+static uint64_t dbindex_block_alloc(unsigned int c)
+{
+  uint64_t size = dbindex_block_size(c);
+  uint64_t block = dbindex_free_blocks[c];
+
+  if (block != DBINDEX_NO_BLOCK)
+    {
+      memcpy(dbindex_free_blocks + c, kmerindex + block, sizeof(uint64_t));
+    }
+  else
+    {
+      if (kmerindexsize + size > dbindex_index_alloc)
+        {
+          if (kmerindexsize - dbindex_index_live > kmerindexsize / 4)
+            {
+              dbindex_compact();
+            }
+          if (kmerindexsize + size > dbindex_index_alloc * 4 / 5)
+            {
+              uint64_t old_alloc = dbindex_index_alloc;
+              dbindex_index_alloc = (kmerindexsize + size) / 4 * 5;
+              kmerindex = (unsigned int *)
+                xrealloc_large(kmerindex,
+                               old_alloc * sizeof(unsigned int),
+                               dbindex_index_alloc * sizeof(unsigned int));
+            }
+        }
+
+      block = kmerindexsize;
+      kmerindexsize += size;
+    }
+
+  dbindex_index_live += size;
+  return block;
+}
+
+static void dbindex_block_free(uint64_t block, unsigned int c)
+{
+  memcpy(kmerindex + block, dbindex_free_blocks + c, sizeof(uint64_t));
+  dbindex_free_blocks[c] = block;
+  dbindex_index_live -= dbindex_block_size(c);
+}
+
+static void dbindex_grow_map()
+{
+  /* make room for more sequences in the map and the bitmaps */
+
+  dbindex_map_alloc *= 2;
+  dbindex_map = (unsigned int *)
+    xrealloc(dbindex_map, dbindex_map_alloc * sizeof(unsigned int));
+
+  for(unsigned int i = 0; i < dbindex_bitmap_count; i++)
+    {
+      bitmap_resize(kmerbitmap[dbindex_bitmap_kmers[i]],
+                    dbindex_map_alloc + 127); // pad for xmm
+    }
+}
+
+static void dbindex_grow_list(unsigned int kmer)
+{
+  /* make room for one more element for the kmer, or use a bitmap */
+
+  unsigned int count = kmercount[kmer];
+
+  if (dbindex_grow_bitmaps &&
+      (count + 1 >= DBINDEX_BITMAP_MINCOUNT) &&
+      ((uint64_t) (count + 1) * BITMAP_THRESHOLD >= dbindex_count + 1))
+    {
+      bitmap_t * b = bitmap_init(dbindex_map_alloc + 127); // pad for xmm
+      bitmap_reset_all(b);
+      unsigned int * list = kmerindex + kmerhash[kmer];
+      for(unsigned int j = 0; j < count; j++)
+        {
+          bitmap_set(b, list[j]);
+        }
+      dbindex_block_free(kmerhash[kmer], dbindex_block_class(count));
+      kmerbitmap[kmer] = b;
+
+      if (dbindex_bitmap_count == dbindex_bitmap_alloc)
+        {
+          dbindex_bitmap_alloc = MAX(64, 2 * dbindex_bitmap_alloc);
+          dbindex_bitmap_kmers = (unsigned int *)
+            xrealloc(dbindex_bitmap_kmers,
+                     dbindex_bitmap_alloc * sizeof(unsigned int));
+        }
+      dbindex_bitmap_kmers[dbindex_bitmap_count++] = kmer;
+    }
+  else if (count == 0)
+    {
+      kmerhash[kmer] = dbindex_block_alloc(0);
+    }
+  else if (dbindex_block_full(count))
+    {
+      /* move the list to a larger block, kmerindex may move */
+      unsigned int c = dbindex_block_class(count);
+      uint64_t block = dbindex_block_alloc(c + 1);
+      memcpy(kmerindex + block, kmerindex + kmerhash[kmer],
+             count * sizeof(unsigned int));
+      dbindex_block_free(kmerhash[kmer], c);
+      kmerhash[kmer] = block;
+    }
+}
+
 void fprint_kmer(FILE * f, unsigned int kk, uint64_t kmer)
 {
   uint64_t x = kmer;
@@ -86,6 +463,30 @@ void fprint_kmer(FILE * f, unsigned int kk, uint64_t kmer)
     }
 }
 
+void dbindex_words(struct uhandle_s * uh,
+                   int seqlen,
+                   char * seq,
+                   unsigned int * listlen,
+                   unsigned int * * list,
+                   int seqmask)
+{
+  /*
+    The unique words of a sequence as stored in the index: all k-mers,
+    or only the window minimizers with --minimizer_window. Queries
+    must be sampled in the same way as the indexed sequences.
+  */
+
+  if (opt_minimizer_window > 1)
+    {
+      unique_count_minimizers(uh, opt_wordlength, opt_minimizer_window,
+                              seqlen, seq, listlen, list, seqmask);
+    }
+  else
+    {
+      unique_count(uh, opt_wordlength, seqlen, seq, listlen, list, seqmask);
+    }
+}
+
 void dbindex_addsequence(unsigned int seqno, int seqmask)
 {
 #if 0
@@ -94,19 +495,27 @@ void dbindex_addsequence(unsigned int seqno, int seqmask)
 
   unsigned int uniquecount;
   unsigned int * uniquelist;
-  unique_count(dbindex_uh, opt_wordlength,
-               db_getsequencelen(seqno), db_getsequence(seqno),
-               & uniquecount, & uniquelist, seqmask);
+  dbindex_words(dbindex_uh,
+                db_getsequencelen(seqno), db_getsequence(seqno),
+                & uniquecount, & uniquelist, seqmask);
+  if (dbindex_growable && (dbindex_count == dbindex_map_alloc))
+    {
+      dbindex_grow_map();
+    }
   dbindex_map[dbindex_count] = seqno;
   for(unsigned int i=0; i<uniquecount; i++)
     {
       unsigned int kmer = uniquelist[i];
+      if (dbindex_growable && ! kmerbitmap[kmer])
+        {
+          dbindex_grow_list(kmer);
+        }
       if (kmerbitmap[kmer])
         {
           kmercount[kmer]++;
           bitmap_set(kmerbitmap[kmer], dbindex_count);
         }
-      else
+      else if (! dbindex_stopped(kmer))
         {
           kmerindex[kmerhash[kmer]+(kmercount[kmer]++)] = dbindex_count;
         }
@@ -114,18 +523,239 @@ void dbindex_addsequence(unsigned int seqno, int seqmask)
   dbindex_count++;
 }
 
+void dbindex_renumber()
+{
+  /* after db_keep() has kept just the sequences in the index, in index
+     order, index element i is sequence i */
+
+  for(unsigned int i = 0; i < dbindex_count; i++)
+    {
+      dbindex_map[i] = i;
+    }
+}
+
 void dbindex_addallsequences(int seqmask)
 {
   unsigned int seqcount = db_getsequencecount();
   progress_init("Creating k-mer index", seqcount);
-  for(unsigned int seqno = 0; seqno < seqcount ; seqno++)
+  if (dbindex_ranges && (dbindex_count == 0))
     {
-      dbindex_addsequence(seqno, seqmask);
-      progress_update(seqno);
+      /* turn the counts of each range into its first list positions */
+      for(unsigned int kmer = 0; kmer < kmerhashsize; kmer++)
+        {
+          unsigned int sum = 0;
+          for(unsigned int t = 0; t < dbindex_ranges; t++)
+            {
+              unsigned int * count = dbindex_range_kmercount
+                + (uint64_t) t * kmerhashsize + kmer;
+              unsigned int c = * count;
+              * count = sum;
+              sum += c;
+            }
+          kmercount[kmer] = dbindex_stopped(kmer) ? 0 : sum;
+        }
+
+      dbindex_threads_run(true, seqmask);
+
+      for(unsigned int seqno = 0; seqno < seqcount; seqno++)
+        {
+          dbindex_map[seqno] = seqno;
+        }
+      dbindex_count = seqcount;
     }
+  else
+    {
+      for(unsigned int seqno = 0; seqno < seqcount ; seqno++)
+        {
+          dbindex_addsequence(seqno, seqmask);
+          progress_update(seqno);
+        }
+    }
+  dbindex_ranges_exit();
   progress_done();
 }
 
+/*
+  Stop list (--maxwordfreq). K-mers found in more than the given
+  fraction of the sequences are left out of the index: they are mostly
+  in conserved regions and low complexity words, which do not help to
+  rank the targets, while their bitmaps are scanned in full for every
+  query that contains them. The queries ignore these k-mers too (see
+  search_onequery), so that the number of k-mers required in common
+  with a target only counts informative ones. The fraction is kept in
+  parts per million, and the stop list is saved in UDB files.
+*/
+
+static unsigned int dbindex_maxwordfreq_ppm()
+{
+  if (opt_maxwordfreq >= 1.0)
+    {
+      return 0;
+    }
+  return MAX(1, (unsigned int) (opt_maxwordfreq * 1000000.0 + 0.5));
+}
+
+void dbindex_stoplist_add(unsigned int kmer)
+{
+  if (! dbindex_stoplist)
+    {
+      dbindex_stoplist = bitmap_init(kmerhashsize);
+      bitmap_reset_all(dbindex_stoplist);
+    }
+  if (! bitmap_get(dbindex_stoplist, kmer))
+    {
+      bitmap_set(dbindex_stoplist, kmer);
+      dbindex_stopcount++;
+    }
+}
+
+static void dbindex_stoplist_mark(unsigned int * counts, unsigned int seqcount)
+{
+  /* add the k-mers above the --maxwordfreq cutoff to the stop list */
+
+  unsigned int ppm = dbindex_maxwordfreq_ppm();
+  if (ppm == 0)
+    {
+      return;
+    }
+
+  uint64_t limit = (uint64_t) ppm * seqcount;
+  for(unsigned int kmer = 0; kmer < kmerhashsize; kmer++)
+    {
+      if ((uint64_t) counts[kmer] * 1000000 > limit)
+        {
+          dbindex_stoplist_add(kmer);
+        }
+    }
+
+  if ((dbindex_stop_ppm == 0) || (ppm < dbindex_stop_ppm))
+    {
+      dbindex_stop_ppm = ppm;
+    }
+}
+
+void dbindex_stoplist_apply(unsigned int seqcount)
+{
+  /*
+    Add the k-mers above the --maxwordfreq cutoff to the stop list of
+    an index read from an UDB file, and remove the lists of all the
+    k-mers on it from the index.
+  */
+
+  dbindex_stoplist_mark(kmercount, seqcount);
+
+  if (! dbindex_stoplist)
+    {
+      return;
+    }
+
+  uint64_t sum = 0;
+  for(unsigned int kmer = 0; kmer < kmerhashsize; kmer++)
+    {
+      if (dbindex_stopped(kmer))
+        {
+          kmercount[kmer] = 0;
+        }
+      else if (kmercount[kmer] > 0)
+        {
+          if (kmerhash[kmer] != sum)
+            {
+              memmove(kmerindex + sum,
+                      kmerindex + kmerhash[kmer],
+                      kmercount[kmer] * sizeof(unsigned int));
+            }
+        }
+      kmerhash[kmer] = sum;
+      sum += kmercount[kmer];
+    }
+
+  if (sum < kmerindexsize)
+    {
+      kmerindex = (unsigned int *)
+        xrealloc_large(kmerindex,
+                       kmerindexsize * sizeof(unsigned int),
+                       MAX(1, sum) * sizeof(unsigned int));
+      kmerindexsize = sum;
+    }
+}
+
+void dbindex_stoplist_report()
+{
+  if (! dbindex_stoplist)
+    {
+      return;
+    }
+
+  if (! opt_quiet)
+    {
+      fprintf(stderr,
+              "Stop list: %u words found in more than %.4g%% of the sequences\n",
+              dbindex_stopcount,
+              dbindex_stop_ppm / 10000.0);
+    }
+
+  if (opt_log)
+    {
+      fprintf(fp_log,
+              "Stop list: %u words found in more than %.4g%% of the sequences\n",
+              dbindex_stopcount,
+              dbindex_stop_ppm / 10000.0);
+    }
+}
+
+static void dbindex_count_pass(unsigned int * counts, int seqmask)
+{
+  /* add the number of sequences containing each k-mer to the counts */
+
+  unsigned int seqcount = db_getsequencecount();
+  progress_init("Counting k-mers", seqcount);
+  dbindex_ranges_init(seqcount);
+  if (dbindex_ranges)
+    {
+      dbindex_threads_run(false, seqmask);
+      for(unsigned int t = 0; t < dbindex_ranges; t++)
+        {
+          unsigned int * range_counts = dbindex_range_kmercount
+            + (uint64_t) t * kmerhashsize;
+          for(unsigned int kmer = 0; kmer < kmerhashsize; kmer++)
+            {
+              counts[kmer] += range_counts[kmer];
+            }
+        }
+    }
+  else
+    {
+      struct uhandle_s * uh = unique_init();
+      for(unsigned int seqno = 0; seqno < seqcount ; seqno++)
+        {
+          unsigned int uniquecount;
+          unsigned int * uniquelist;
+          dbindex_words(uh,
+                        db_getsequencelen(seqno), db_getsequence(seqno),
+                        & uniquecount, & uniquelist, seqmask);
+          for(unsigned int i=0; i<uniquecount; i++)
+            {
+              counts[uniquelist[i]]++;
+            }
+          progress_update(seqno);
+        }
+      unique_exit(uh);
+    }
+  progress_done();
+}
+
+void dbindex_count_kmers(unsigned int * counts, int seqmask)
+{
+  /*
+    Count the sequences in memory containing each k-mer, adding to the
+    given 4^k counts, without building the index.
+  */
+
+  kmerhashsize = 1 << (2 * opt_wordlength);
+  dbindex_count_pass(counts, seqmask);
+  dbindex_ranges_exit();
+}
+
 void dbindex_prepare(int use_bitmap, int seqmask)
 {
   dbindex_uh = unique_init();
@@ -134,25 +764,14 @@ void dbindex_prepare(int use_bitmap, int seqmask)
   kmerhashsize = 1 << (2 * opt_wordlength);
 
   /* allocate memory for kmer count array */
-  kmercount = (unsigned int *) xmalloc(kmerhashsize * sizeof(unsigned int));
+  kmercount = (unsigned int *)
+    xmalloc_large(kmerhashsize * sizeof(unsigned int), true);
   memset(kmercount, 0, kmerhashsize * sizeof(unsigned int));
 
   /* first scan, just count occurences */
-  progress_init("Counting k-mers", seqcount);
-  for(unsigned int seqno = 0; seqno < seqcount ; seqno++)
-    {
-      unsigned int uniquecount;
-      unsigned int * uniquelist;
-      unique_count(dbindex_uh, opt_wordlength,
-                   db_getsequencelen(seqno), db_getsequence(seqno),
-                   & uniquecount, & uniquelist, seqmask);
-      for(unsigned int i=0; i<uniquecount; i++)
-        {
-          kmercount[uniquelist[i]]++;
-        }
-      progress_update(seqno);
-    }
-  progress_done();
+  dbindex_count_pass(kmercount, seqmask);
+
+  dbindex_stoplist_mark(kmercount, seqcount);
 
 #if 0
   /* dump kmer counts */
@@ -181,11 +800,16 @@ void dbindex_prepare(int use_bitmap, int seqmask)
 
   /* hash / bitmap setup */
   /* convert hash counts to position in index */
-  kmerhash = (uint64_t *) xmalloc((kmerhashsize+1) * sizeof(uint64_t));
+  kmerhash = (uint64_t *)
+    xmalloc_large((kmerhashsize+1) * sizeof(uint64_t), true);
   uint64_t sum = 0;
   for(unsigned int i = 0; i < kmerhashsize; i++)
     {
       kmerhash[i] = sum;
+      if (dbindex_stopped(i))
+        {
+          continue;
+        }
       if (kmercount[i] >= bitmap_mincount)
         {
           kmerbitmap[i] = bitmap_init(seqcount+127); // pad for xmm
@@ -208,21 +832,86 @@ void dbindex_prepare(int use_bitmap, int seqmask)
   memset(kmercount, 0, kmerhashsize * sizeof(unsigned int));
 
   /* allocate space for actual data */
-  kmerindex = (unsigned int *) xmalloc(kmerindexsize * sizeof(unsigned int));
+  kmerindex = (unsigned int *)
+    xmalloc_large(kmerindexsize * sizeof(unsigned int), true);
 
   /* allocate space for mapping from indexno to seqno */
   dbindex_map = (unsigned int *) xmalloc(seqcount * sizeof(unsigned int));
 
   dbindex_count = 0;
 
+  dbindex_stoplist_report();
+
+  arch_large_report("K-mer index",
+                    kmerhashsize * (sizeof(unsigned int) + sizeof(uint64_t))
+                    + kmerindexsize * sizeof(unsigned int));
+
+  show_rusage();
+}
+
+void dbindex_prepare_growable(int use_bitmap)
+{
+  /*
+    Prepare an empty index that grows as sequences are added, for when
+    only a few of the sequences in memory will be added.
+  */
+
+  dbindex_uh = unique_init();
+
+  kmerhashsize = 1 << (2 * opt_wordlength);
+
+  kmercount = (unsigned int *)
+    xmalloc_large(kmerhashsize * sizeof(unsigned int), true);
+  memset(kmercount, 0, kmerhashsize * sizeof(unsigned int));
+
+  kmerbitmap = (bitmap_t **) xmalloc(kmerhashsize * sizeof(bitmap_t *));
+  memset(kmerbitmap, 0, kmerhashsize * sizeof(bitmap_t *));
+
+  kmerhash = (uint64_t *)
+    xmalloc_large((kmerhashsize+1) * sizeof(uint64_t), true);
+  memset(kmerhash, 0, (kmerhashsize+1) * sizeof(uint64_t));
+
+  dbindex_growable = true;
+  dbindex_grow_bitmaps = use_bitmap;
+  for(unsigned int c = 0; c < DBINDEX_BLOCK_CLASSES; c++)
+    {
+      dbindex_free_blocks[c] = DBINDEX_NO_BLOCK;
+    }
+
+  dbindex_index_alloc = 1024 * 1024;
+  dbindex_index_live = 0;
+  kmerindexsize = 0;
+  kmerindex = (unsigned int *)
+    xmalloc_large(dbindex_index_alloc * sizeof(unsigned int), true);
+
+  dbindex_map_alloc = 1024;
+  dbindex_map = (unsigned int *)
+    xmalloc(dbindex_map_alloc * sizeof(unsigned int));
+
+  dbindex_bitmap_kmers = nullptr;
+  dbindex_bitmap_count = 0;
+  dbindex_bitmap_alloc = 0;
+
+  dbindex_count = 0;
+
   show_rusage();
 }
 
 void dbindex_free()
 {
-  xfree(kmerhash);
-  xfree(kmerindex);
-  xfree(kmercount);
+  dbindex_ranges_exit();
+  if (dbindex_growable)
+    {
+      if (dbindex_bitmap_kmers)
+        {
+          xfree(dbindex_bitmap_kmers);
+          dbindex_bitmap_kmers = nullptr;
+        }
+      dbindex_growable = false;
+    }
+  xfree_large(kmerhash);
+  xfree_large(kmerindex);
+  xfree_large(kmercount);
   xfree(dbindex_map);
 
   for(unsigned int kmer=0; kmer<kmerhashsize; kmer++)
@@ -234,4 +923,12 @@ void dbindex_free()
     }
   xfree(kmerbitmap);
   unique_exit(dbindex_uh);
+
+  if (dbindex_stoplist)
+    {
+      bitmap_free(dbindex_stoplist);
+      dbindex_stoplist = nullptr;
+    }
+  dbindex_stopcount = 0;
+  dbindex_stop_ppm = 0;
 }
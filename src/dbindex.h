@@ -70,14 +70,34 @@ extern unsigned int dbindex_count;
 extern unsigned int kmerhashsize;
 extern uint64_t kmerindexsize;
 extern uhandle_s * dbindex_uh;
+extern bitmap_t * dbindex_stoplist; /* k-mers left out of the index */
+extern unsigned int dbindex_stopcount;
+extern unsigned int dbindex_stop_ppm; /* frequency cutoff of the stop list */
 
 void fprint_kmer(FILE * f, unsigned int k, uint64_t kmer);
 
 void dbindex_prepare(int use_bitmap, int seqmask);
+void dbindex_prepare_growable(int use_bitmap);
+void dbindex_count_kmers(unsigned int * counts, int seqmask);
 void dbindex_addallsequences(int seqmask);
+void dbindex_words(struct uhandle_s * uh,
+                   int seqlen,
+                   char * seq,
+                   unsigned int * listlen,
+                   unsigned int * * list,
+                   int seqmask);
 void dbindex_addsequence(unsigned int seqno, int seqmask);
+void dbindex_renumber();
 void dbindex_free();
 void dbindex_udb_write();
+void dbindex_stoplist_add(unsigned int kmer);
+void dbindex_stoplist_apply(unsigned int seqcount);
+void dbindex_stoplist_report();
+
+inline bool dbindex_stopped(unsigned int kmer)
+{
+  return dbindex_stoplist && bitmap_get(dbindex_stoplist, kmer);
+}
 
 inline unsigned char * dbindex_getbitmap(unsigned int kmer)
 {
@@ -707,6 +707,24 @@ void derep(char * input_filename, bool use_header)
     {
       progress_init("Writing output file", clusters);
 
+      /* register the output sequences for parallel digest computation */
+      digest_prefetch_init();
+      int64_t prefetch_count = 0;
+      for (uint64_t i=0; i<clusters; i++)
+        {
+          struct bucket * bp = hashtable + i;
+          int64_t size = bp->size;
+          if ((size >= opt_minuniquesize) && (size <= opt_maxuniquesize))
+            {
+              digest_prefetch_add(bp->seq, strlen(bp->seq));
+              prefetch_count++;
+              if (prefetch_count == opt_topn)
+                {
+                  break;
+                }
+            }
+        }
+
       int64_t relabel_count = 0;
       for (uint64_t i=0; i<clusters; i++)
         {
@@ -734,6 +752,7 @@ void derep(char * input_filename, bool use_header)
         }
 
       progress_done();
+      digest_prefetch_exit();
       fclose(fp_output);
     }
 
@@ -1140,6 +1159,24 @@ void derep_prefix()
     {
       progress_init("Writing output file", clusters);
 
+      /* register the output sequences for parallel digest computation */
+      digest_prefetch_init();
+      int64_t prefetch_count = 0;
+      for (int64_t i=0; i<clusters; i++)
+        {
+          struct bucket * bp = hashtable + i;
+          int64_t size = bp->size;
+          if ((size >= opt_minuniquesize) && (size <= opt_maxuniquesize))
+            {
+              digest_prefetch_add(db_getsequence(bp->seqno_first), db_getsequencelen(bp->seqno_first));
+              prefetch_count++;
+              if (prefetch_count == opt_topn)
+                {
+                  break;
+                }
+            }
+        }
+
       int64_t relabel_count = 0;
       for (int64_t i=0; i<clusters; i++)
         {
@@ -1167,6 +1204,7 @@ void derep_prefix()
         }
 
       progress_done();
+      digest_prefetch_exit();
       fclose(fp_output);
     }
 
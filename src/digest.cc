@@ -0,0 +1,261 @@
+/*
+
+  VSEARCH5D: a modified version of VSEARCH
+
+  Copyright (C) 2016-2021, Akifumi S. Tanabe
+
+  Contact: Akifumi S. Tanabe
+  https://github.com/astanabe/vsearch5d
+
+  Original version of VSEARCH
+  Copyright (C) 2014-2021, Torbjorn Rognes, Frederic Mahe and Tomas Flouri
+  All rights reserved.
+
+
+  This software is dual-licensed and available under a choice
+  of one of two licenses, either under the terms of the GNU
+  General Public License version 3 or the BSD 2-Clause License.
+
+
+  GNU General Public License version 3
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+  The BSD 2-Clause License
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "vsearch5d.h"
+
+/* number of sequences hashed in parallel when prefetching */
+#define DIGEST_PREFETCH_CHUNK 16384
+
+static void digest_lanes(bool md5,
+                         int count,
+                         char ** seqs,
+                         int * lens,
+                         char * hex,
+                         int hex_size)
+{
+#ifdef __x86_64__
+  if (avx2_present)
+    {
+      digest_lanes_hex_avx2(md5, count, seqs, lens, hex, hex_size);
+      return;
+    }
+#endif
+  digest_lanes_hex(md5, count, seqs, lens, hex, hex_size);
+}
+
+/*
+  Prefetching of digests for an output stage: the sequences are
+  registered in the order they will be printed, and their digests are
+  then computed in parallel, DIGEST_PREFETCH_CHUNK at a time, as the
+  printing reaches them. fprint_seq_digest_sha1/md5 ask for the next
+  prefetched digest and compute it directly if the sequence does not
+  match.
+*/
+
+static char ** prefetch_seqs = nullptr;
+static int * prefetch_lens = nullptr;
+static uint64_t prefetch_alloc = 0;
+static uint64_t prefetch_count = 0;
+static uint64_t prefetch_next = 0;
+static uint64_t prefetch_done = 0;
+static char * prefetch_hex = nullptr;
+static bool prefetch_md5 = false;
+static int prefetch_hex_size = 0;
+
+static pthread_t * pthread;
+static pthread_attr_t attr;
+static pthread_mutex_t mutex;
+static uint64_t next_group = 0;
+static uint64_t group_count = 0;
+
+void * digest_prefetch_worker(void * vp)
+{
+  (void) vp;
+
+  while (true)
+    {
+      xpthread_mutex_lock(&mutex);
+      uint64_t group = next_group;
+      if (group < group_count)
+        {
+          next_group++;
+        }
+      xpthread_mutex_unlock(&mutex);
+
+      if (group >= group_count)
+        {
+          break;
+        }
+
+      uint64_t first = prefetch_done + group * DIGEST_LANES;
+      uint64_t count = MIN(DIGEST_LANES, prefetch_count - first);
+      digest_lanes(prefetch_md5,
+                   count,
+                   prefetch_seqs + first,
+                   prefetch_lens + first,
+                   prefetch_hex + (first % DIGEST_PREFETCH_CHUNK)
+                   * prefetch_hex_size,
+                   prefetch_hex_size);
+    }
+
+  return nullptr;
+}
+
+static void digest_prefetch_chunk()
+{
+  /* compute the digests of the next chunk of registered sequences */
+
+  uint64_t count = MIN(DIGEST_PREFETCH_CHUNK, prefetch_count - prefetch_done);
+  group_count = (count + DIGEST_LANES - 1) / DIGEST_LANES;
+  next_group = 0;
+
+  int threads = MIN(opt_threads, (int64_t) group_count);
+
+  xpthread_mutex_init(&mutex, nullptr);
+  xpthread_attr_init(&attr);
+  xpthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+
+  pthread = (pthread_t *) xmalloc(threads * sizeof(pthread_t));
+
+  for(int t = 0; t < threads; t++)
+    {
+      xpthread_create(pthread + t, &attr,
+                      digest_prefetch_worker, (void *)(int64_t) t);
+    }
+
+  for(int t = 0; t < threads; t++)
+    {
+      xpthread_join(pthread[t], nullptr);
+    }
+
+  xfree(pthread);
+  xpthread_attr_destroy(&attr);
+  xpthread_mutex_destroy(&mutex);
+
+  prefetch_done += count;
+}
+
+void digest_prefetch_init()
+{
+  /* start registering sequences, if relabeling by digest */
+
+  prefetch_count = 0;
+  prefetch_next = 0;
+  prefetch_done = 0;
+
+  if (! (opt_relabel_sha1 || opt_relabel_md5))
+    {
+      return;
+    }
+
+  prefetch_md5 = opt_relabel_md5 && ! opt_relabel_sha1;
+  prefetch_hex_size = prefetch_md5 ? LEN_HEX_DIG_MD5 : LEN_HEX_DIG_SHA1;
+  prefetch_hex = (char *) xmalloc(DIGEST_PREFETCH_CHUNK * prefetch_hex_size);
+}
+
+void digest_prefetch_add(char * seq, int len)
+{
+  if (! prefetch_hex)
+    {
+      return;
+    }
+
+  if (prefetch_count == prefetch_alloc)
+    {
+      prefetch_alloc += DIGEST_PREFETCH_CHUNK;
+      prefetch_seqs = (char **) xrealloc(prefetch_seqs,
+                                         prefetch_alloc * sizeof(char *));
+      prefetch_lens = (int *) xrealloc(prefetch_lens,
+                                       prefetch_alloc * sizeof(int));
+    }
+
+  prefetch_seqs[prefetch_count] = seq;
+  prefetch_lens[prefetch_count] = len;
+  prefetch_count++;
+}
+
+bool digest_prefetch_get(char * seq, int len, char * hex)
+{
+  /* copy the digest of seq if it is the next prefetched sequence */
+
+  if ((! prefetch_hex) ||
+      (prefetch_next >= prefetch_count) ||
+      (prefetch_seqs[prefetch_next] != seq) ||
+      (prefetch_lens[prefetch_next] != len))
+    {
+      return false;
+    }
+
+  if (prefetch_next == prefetch_done)
+    {
+      digest_prefetch_chunk();
+    }
+
+  memcpy(hex,
+         prefetch_hex + (prefetch_next % DIGEST_PREFETCH_CHUNK)
+         * prefetch_hex_size,
+         prefetch_hex_size);
+  prefetch_next++;
+  return true;
+}
+
+void digest_prefetch_exit()
+{
+  if (prefetch_hex)
+    {
+      xfree(prefetch_hex);
+      prefetch_hex = nullptr;
+    }
+  if (prefetch_seqs)
+    {
+      xfree(prefetch_seqs);
+      prefetch_seqs = nullptr;
+    }
+  if (prefetch_lens)
+    {
+      xfree(prefetch_lens);
+      prefetch_lens = nullptr;
+    }
+  prefetch_alloc = 0;
+  prefetch_count = 0;
+}
@@ -0,0 +1,361 @@
+/*
+
+  VSEARCH5D: a modified version of VSEARCH
+
+  Copyright (C) 2016-2021, Akifumi S. Tanabe
+
+  Contact: Akifumi S. Tanabe
+  https://github.com/astanabe/vsearch5d
+
+  Original version of VSEARCH
+  Copyright (C) 2014-2021, Torbjorn Rognes, Frederic Mahe and Tomas Flouri
+  All rights reserved.
+
+
+  This software is dual-licensed and available under a choice
+  of one of two licenses, either under the terms of the GNU
+  General Public License version 3 or the BSD 2-Clause License.
+
+
+  GNU General Public License version 3
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+  The BSD 2-Clause License
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "vsearch5d.h"
+
+/* This file may be compiled several times with different cpu options. */
+
+typedef uint32_t digest_vec_t __attribute__ ((vector_size (4 * DIGEST_LANES)));
+
+static const uint32_t md5_k[64] =
+  {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee,
+    0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be,
+    0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa,
+    0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed,
+    0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c,
+    0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05,
+    0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039,
+    0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1,
+    0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+  };
+
+static const int md5_r[64] =
+  {
+    7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+    5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20,
+    4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+    6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21
+  };
+
+static const char digest_hexdigits[] = "0123456789abcdef";
+
+#define digest_rol(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+inline int64_t digest_blocks(int len)
+{
+  /* number of 64-byte blocks after padding with 0x80 and the length */
+  return (len + 8) / 64 + 1;
+}
+
+static void digest_fill_block(unsigned char * block,
+                              char * seq,
+                              int len,
+                              int64_t b,
+                              bool md5)
+{
+  /* block b of the normalized and padded message */
+
+  int64_t pos = 64 * b;
+  int64_t n = MAX(0, MIN(64, len - pos));
+  auto * p = (unsigned char *) seq + pos;
+
+  for(int64_t i = 0; i < n; i++)
+    {
+      block[i] = chrmap_normalize[p[i]];
+    }
+
+  if (n < 64)
+    {
+      memset(block + n, 0, 64 - n);
+      if (pos + n == len)
+        {
+          block[n] = 0x80;
+        }
+    }
+
+  if (b == digest_blocks(len) - 1)
+    {
+      uint64_t bits = 8 * (uint64_t) len;
+      for(int j = 0; j < 8; j++)
+        {
+          int shift = md5 ? 8 * j : 8 * (7 - j);
+          block[56 + j] = (unsigned char)(bits >> shift);
+        }
+    }
+}
+
+#define SHA1_ROUND(f, k)                                                \
+  {                                                                     \
+    digest_vec_t tmp = digest_rol(a, 5) + (f) + e + (k) + w[t & 15];   \
+    e = d;                                                              \
+    d = c;                                                              \
+    c = digest_rol(b, 30);                                              \
+    b = a;                                                              \
+    a = tmp;                                                            \
+  }
+
+#define SHA1_EXPAND(t)                                                  \
+  w[(t) & 15] = digest_rol(w[((t) + 13) & 15] ^ w[((t) + 8) & 15] ^     \
+                           w[((t) + 2) & 15] ^ w[(t) & 15], 1);
+
+static void digest_sha1_block(digest_vec_t * state, digest_vec_t * w)
+{
+  digest_vec_t a = state[0];
+  digest_vec_t b = state[1];
+  digest_vec_t c = state[2];
+  digest_vec_t d = state[3];
+  digest_vec_t e = state[4];
+
+  int t = 0;
+  for(; t < 16; t++)
+    {
+      SHA1_ROUND((b & (c ^ d)) ^ d, 0x5a827999);
+    }
+  for(; t < 20; t++)
+    {
+      SHA1_EXPAND(t);
+      SHA1_ROUND((b & (c ^ d)) ^ d, 0x5a827999);
+    }
+  for(; t < 40; t++)
+    {
+      SHA1_EXPAND(t);
+      SHA1_ROUND(b ^ c ^ d, 0x6ed9eba1);
+    }
+  for(; t < 60; t++)
+    {
+      SHA1_EXPAND(t);
+      SHA1_ROUND((b & c) | (d & (b | c)), 0x8f1bbcdc);
+    }
+  for(; t < 80; t++)
+    {
+      SHA1_EXPAND(t);
+      SHA1_ROUND(b ^ c ^ d, 0xca62c1d6);
+    }
+
+  state[0] += a;
+  state[1] += b;
+  state[2] += c;
+  state[3] += d;
+  state[4] += e;
+}
+
+#define MD5_ROUND(f, g)                                                 \
+  {                                                                     \
+    digest_vec_t tmp = b + digest_rol(a + (f) + md5_k[i] + w[g],        \
+                                      md5_r[i]);                        \
+    a = d;                                                              \
+    d = c;                                                              \
+    c = b;                                                              \
+    b = tmp;                                                            \
+  }
+
+static void digest_md5_block(digest_vec_t * state, digest_vec_t * w)
+{
+  digest_vec_t a = state[0];
+  digest_vec_t b = state[1];
+  digest_vec_t c = state[2];
+  digest_vec_t d = state[3];
+
+  int i = 0;
+  for(; i < 16; i++)
+    {
+      MD5_ROUND((b & c) | (~ b & d), i);
+    }
+  for(; i < 32; i++)
+    {
+      MD5_ROUND((d & b) | (~ d & c), (5 * i + 1) & 15);
+    }
+  for(; i < 48; i++)
+    {
+      MD5_ROUND(b ^ c ^ d, (3 * i + 5) & 15);
+    }
+  for(; i < 64; i++)
+    {
+      MD5_ROUND(c ^ (b | ~ d), (7 * i) & 15);
+    }
+
+  state[0] += a;
+  state[1] += b;
+  state[2] += c;
+  state[3] += d;
+}
+
+#ifdef AVX2
+void digest_lanes_hex_avx2(bool md5,
+                           int count,
+                           char ** seqs,
+                           int * lens,
+                           char * hex,
+                           int hex_size)
+#else
+void digest_lanes_hex(bool md5,
+                      int count,
+                      char ** seqs,
+                      int * lens,
+                      char * hex,
+                      int hex_size)
+#endif
+{
+  /*
+    Write the hexadecimal SHA1 (or MD5) digests of the normalized
+    sequences seqs[0..count-1] to hex, hex_size bytes apart.
+    At most DIGEST_LANES sequences are hashed in one call.
+  */
+
+  /* the first four initial words are the same for MD5 */
+  static const uint32_t sha1_init[5] =
+    { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0 };
+
+  int words = md5 ? 4 : 5;
+  digest_vec_t state[5];
+  digest_vec_t w[16];
+  int64_t blocks[DIGEST_LANES];
+  int64_t maxblocks = 0;
+
+  for(int j = 0; j < words; j++)
+    {
+      for(int l = 0; l < DIGEST_LANES; l++)
+        {
+          state[j][l] = sha1_init[j];
+        }
+    }
+
+  for(int l = 0; l < DIGEST_LANES; l++)
+    {
+      blocks[l] = (l < count) ? digest_blocks(lens[l]) : 0;
+      maxblocks = MAX(maxblocks, blocks[l]);
+    }
+
+  for(int64_t b = 0; b < maxblocks; b++)
+    {
+      /* gather the message words lane by lane, then load the vectors */
+      uint32_t words_lanes[16][DIGEST_LANES];
+      uint32_t active_lanes[DIGEST_LANES];
+
+      for(int l = 0; l < DIGEST_LANES; l++)
+        {
+          uint32_t block[16];
+
+          if (b < blocks[l])
+            {
+              active_lanes[l] = 0xffffffff;
+              digest_fill_block((unsigned char *) block,
+                                seqs[l], lens[l], b, md5);
+            }
+          else
+            {
+              active_lanes[l] = 0;
+              memset(block, 0, 64);
+            }
+
+          /* MD5 words are little-endian like the supported cpus */
+          for(int j = 0; j < 16; j++)
+            {
+              words_lanes[j][l] = md5 ? block[j] : __builtin_bswap32(block[j]);
+            }
+        }
+
+      digest_vec_t active;
+      memcpy(& active, active_lanes, sizeof(active));
+      for(int j = 0; j < 16; j++)
+        {
+          memcpy(w + j, words_lanes[j], sizeof(digest_vec_t));
+        }
+
+      digest_vec_t next[5];
+      for(int j = 0; j < words; j++)
+        {
+          next[j] = state[j];
+        }
+
+      if (md5)
+        {
+          digest_md5_block(next, w);
+        }
+      else
+        {
+          digest_sha1_block(next, w);
+        }
+
+      /* keep the state of lanes that have no more blocks */
+      for(int j = 0; j < words; j++)
+        {
+          state[j] = (next[j] & active) | (state[j] & ~ active);
+        }
+    }
+
+  for(int l = 0; l < count; l++)
+    {
+      char * h = hex + l * hex_size;
+      for(int j = 0; j < words; j++)
+        {
+          uint32_t x = state[j][l];
+          for(int k = 0; k < 4; k++)
+            {
+              unsigned int byte = md5 ? (x >> (8 * k)) : (x >> (8 * (3 - k)));
+              byte &= 0xff;
+              * h++ = digest_hexdigits[byte >> 4];
+              * h++ = digest_hexdigits[byte & 15];
+            }
+        }
+      * h = 0;
+    }
+}
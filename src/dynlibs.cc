@@ -79,6 +79,11 @@ void * gz_lib;
 gzFile ZEXPORT (*gzdopen_p) OF((int, const char *));
 int ZEXPORT (*gzclose_p) OF((gzFile));
 int ZEXPORT (*gzread_p) OF((gzFile, void *, unsigned));
+int ZEXPORT (*deflateInit2_p) OF((z_streamp, int, int, int, int, int,
+                                  const char *, int));
+int ZEXPORT (*deflate_p) OF((z_streamp, int));
+int ZEXPORT (*deflateEnd_p) OF((z_streamp));
+uLong ZEXPORT (*crc32_p) OF((uLong, const Bytef *, uInt));
 
 #endif
 
@@ -117,7 +122,17 @@ void dynlibs_open()
         arch_dlsym(gz_lib, "gzclose");
       gzread_p = (int (*)(gzFile, void*, unsigned))
         arch_dlsym(gz_lib, "gzread");
-      if (!(gzdopen_p && gzclose_p && gzread_p))
+      deflateInit2_p = (int (*)(z_streamp, int, int, int, int, int,
+                                const char *, int))
+        arch_dlsym(gz_lib, "deflateInit2_");
+      deflate_p = (int (*)(z_streamp, int))
+        arch_dlsym(gz_lib, "deflate");
+      deflateEnd_p = (int (*)(z_streamp))
+        arch_dlsym(gz_lib, "deflateEnd");
+      crc32_p = (uLong (*)(uLong, const Bytef *, uInt))
+        arch_dlsym(gz_lib, "crc32");
+      if (!(gzdopen_p && gzclose_p && gzread_p &&
+            deflateInit2_p && deflate_p && deflateEnd_p && crc32_p))
         {
           fatal("Invalid compression library (zlib)");
         }
@@ -74,6 +74,11 @@ extern int (*gzgetc_p)(gzFile);
 extern int (*gzrewind_p)(gzFile);
 extern int (*gzungetc_p)(int, gzFile);
 extern const char * (*gzerror_p)(gzFile, int*);
+extern int (*deflateInit2_p)(z_streamp, int, int, int, int, int,
+                             const char *, int);
+extern int (*deflate_p)(z_streamp, int);
+extern int (*deflateEnd_p)(z_streamp);
+extern uLong (*crc32_p)(uLong, const Bytef *, uInt);
 #endif
 
 #ifdef HAVE_BZLIB_H
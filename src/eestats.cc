@@ -113,6 +113,29 @@ double q2p(int q)
   return exp10(- q / 10.0);
 }
 
+void eestats_tables(int * qual_table, double * pe_table)
+{
+  /*
+    Quality value and error probability for each quality symbol.
+    Symbols outside the allowed range get the quality value -1.
+  */
+
+  for(int c = 0; c < 256; c++)
+    {
+      int qual = c - opt_fastq_ascii;
+      if ((qual < opt_fastq_qmin) || (qual > opt_fastq_qmax))
+        {
+          qual_table[c] = -1;
+          pe_table[c] = 0.0;
+        }
+      else
+        {
+          qual_table[c] = MAX(qual, 0);
+          pe_table[c] = q2p(qual_table[c]);
+        }
+    }
+}
+
 int64_t ee_start(int pos, int resolution)
 {
   return pos * (resolution * (pos + 1) + 2) / 2;
@@ -166,6 +189,10 @@ void fastq_eestats()
   int64_t len_min = LONG_MAX;
   int64_t len_max = 0;
 
+  int qual_table[256];
+  double pe_table[256];
+  eestats_tables(qual_table, pe_table);
+
   while(fastq_next(h, false, chrmap_upcase))
     {
       seq_count++;
@@ -231,17 +258,17 @@ void fastq_eestats()
 
           /* quality score */
 
-          int qual = fastq_get_qual_eestats(q[i]);
+          int qual = qual_table[(unsigned char) q[i]];
           if (qual < 0)
             {
-              qual = 0;
+              fastq_get_qual_eestats(q[i]);
             }
           qual_length_table[(max_quality+1)*i + qual]++;
 
 
           /* Pe */
 
-          double pe = q2p(qual);
+          double pe = pe_table[(unsigned char) q[i]];
           sum_pe_length_table[i] += pe;
 
 
@@ -464,6 +491,10 @@ void fastq_eestats2()
 
   uint64_t * count_table = nullptr;
 
+  int qual_table[256];
+  double pe_table[256];
+  eestats_tables(qual_table, pe_table);
+
   while(fastq_next(h, false, chrmap_upcase))
     {
       seq_count++;
@@ -496,20 +527,21 @@ void fastq_eestats2()
         {
           /* quality score */
 
-          int qual = fastq_get_qual_eestats(q[i]);
-          if (qual < 0)
+          if (qual_table[(unsigned char) q[i]] < 0)
             {
-              qual = 0;
+              fastq_get_qual_eestats(q[i]);
             }
 
-          double pe = q2p(qual);
+          double pe = pe_table[(unsigned char) q[i]];
 
           ee += pe;
 
-          for (int x = 0; x < len_steps; x++)
+          /* length step ending at this position, if any */
+          int64_t steplen = (int64_t)(i + 1) - opt_length_cutoffs_shortest;
+          if ((steplen >= 0) && (steplen % opt_length_cutoffs_increment == 0))
             {
-              uint64_t len_cutoff = opt_length_cutoffs_shortest + x * opt_length_cutoffs_increment;
-              if (i+1 == len_cutoff)
+              int64_t x = steplen / opt_length_cutoffs_increment;
+              if (x < len_steps)
                 {
                   for (int y = 0; y < opt_ee_cutoffs_count; y++)
                     {
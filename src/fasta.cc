@@ -363,7 +363,8 @@ void fasta_print_general(FILE * fp,
                          int clustersize,
                          int clusterid,
                          const char * score_name,
-                         double score)
+                         double score,
+                         struct header_attributes_s * attributes)
 {
   fprintf(fp, ">");
 
@@ -392,11 +393,23 @@ void fasta_print_general(FILE * fp,
     {
       bool xsize = opt_xsize || (opt_sizeout && (abundance > 0));
       bool xee = opt_xee || ((opt_eeout || opt_fastq_eeout) && (ee >= 0.0));
-      header_fprint_strip_size_ee(fp,
-                                  header,
-                                  header_len,
-                                  xsize,
-                                  xee);
+      if (attributes)
+        {
+          header_fprint_strip_attributes(fp,
+                                         header,
+                                         header_len,
+                                         attributes,
+                                         xsize,
+                                         xee);
+        }
+      else
+        {
+          header_fprint_strip_size_ee(fp,
+                                      header,
+                                      header_len,
+                                      xsize,
+                                      xee);
+        }
     }
 
   if (opt_label_suffix)
@@ -457,7 +470,8 @@ void fasta_print_db_relabel(FILE * fp,
                       ordinal,
                       -1.0,
                       -1, -1,
-                      nullptr, 0.0);
+                      nullptr, 0.0,
+                      db_getattributes(seqno));
 }
 
 void fasta_print_db(FILE * fp, uint64_t seqno)
@@ -472,5 +486,6 @@ void fasta_print_db(FILE * fp, uint64_t seqno)
                       0,
                       -1.0,
                       -1, -1,
-                      nullptr, 0.0);
+                      nullptr, 0.0,
+                      db_getattributes(seqno));
 }
@@ -100,7 +100,8 @@ void fasta_print_general(FILE * fp,
                          int clustersize,
                          int clusterid,
                          const char * score_name,
-                         double score);
+                         double score,
+                         struct header_attributes_s * attributes = nullptr);
 
 void fasta_print_db(FILE * fp,
                     uint64_t seqno);
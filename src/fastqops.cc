@@ -414,6 +414,13 @@ void fastq_stats()
       quality_char = 0;
     }
 
+  /* error probability for each quality symbol */
+  double pe_table[256];
+  for(int c = 0; c < 256; c++)
+    {
+      pe_table[c] = q2p(c - opt_fastq_ascii);
+    }
+
   while(fastq_next(h, false, chrmap_upcase))
     {
       seq_count++;
@@ -508,7 +515,7 @@ void fastq_stats()
 
           qual_length_table[256*i + qc]++;
 
-          ee += q2p(qual);
+          ee += pe_table[qc];
 
           sumee_length_table[i] += ee;
 
@@ -814,11 +821,7 @@ void fastx_revcomp()
       if (fastx_is_fastq(h))
         {
           /* reverse quality values */
-          for(uint64_t i=0; i<length; i++)
-            {
-              qual_buffer[i] = q[length-1-i];
-            }
-          qual_buffer[length] = 0;
+          reverse_string(qual_buffer, q, length);
         }
 
       if (opt_fastaout)
@@ -887,6 +890,37 @@ void fastq_convert()
       fatal("Unable to open FASTQ output file for writing");
     }
 
+  /* converted symbol for each input symbol, -1 if out of range */
+
+  int convert_table[256];
+  for(int c = 0; c < 256; c++)
+    {
+      int q = ((char) c) - opt_fastq_ascii;
+      if ((q < opt_fastq_qmin) || (q > opt_fastq_qmax))
+        {
+          convert_table[c] = -1;
+          continue;
+        }
+      if (q < opt_fastq_qminout)
+        {
+          q = opt_fastq_qminout;
+        }
+      if (q > opt_fastq_qmaxout)
+        {
+          q = opt_fastq_qmaxout;
+        }
+      q += opt_fastq_asciiout;
+      if (q < 33)
+        {
+          q = 33;
+        }
+      if (q > 126)
+        {
+          q = 126;
+        }
+      convert_table[c] = q;
+    }
+
   progress_init("Reading FASTQ file", filesize);
 
   int j = 1;
@@ -907,6 +941,13 @@ void fastq_convert()
       char * quality = fastq_get_quality(h);
       for(uint64_t i=0; i<length; i++)
         {
+          int c = convert_table[(unsigned char) quality[i]];
+          if (c >= 0)
+            {
+              quality[i] = c;
+              continue;
+            }
+
           int q = quality[i] - opt_fastq_ascii;
           if (q < opt_fastq_qmin)
             {
@@ -932,24 +973,6 @@ void fastq_convert()
                       fastq_get_lineno(h));
               fatal("FASTQ quality score too high");
             }
-          if (q < opt_fastq_qminout)
-            {
-              q = opt_fastq_qminout;
-            }
-          if (q > opt_fastq_qmaxout)
-            {
-              q = opt_fastq_qmaxout;
-            }
-          q += opt_fastq_asciiout;
-          if (q < 33)
-            {
-              q = 33;
-            }
-          if (q > 126)
-            {
-              q = 126;
-            }
-          quality[i] = q;
         }
       quality[length] = 0;
 
@@ -0,0 +1,940 @@
+/*
+
+  VSEARCH5D: a modified version of VSEARCH
+
+  Copyright (C) 2016-2021, Akifumi S. Tanabe
+
+  Contact: Akifumi S. Tanabe
+  https://github.com/astanabe/vsearch5d
+
+  Original version of VSEARCH
+  Copyright (C) 2014-2021, Torbjorn Rognes, Frederic Mahe and Tomas Flouri
+  All rights reserved.
+
+
+  This software is dual-licensed and available under a choice
+  of one of two licenses, either under the terms of the GNU
+  General Public License version 3 or the BSD 2-Clause License.
+
+
+  GNU General Public License version 3
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+  The BSD 2-Clause License
+
+  Redistribution and use in source and binary forms, with or without
+  modification, are permitted provided that the following conditions
+  are met:
+
+  1. Redistributions of source code must retain the above copyright
+  notice, this list of conditions and the following disclaimer.
+
+  2. Redistributions in binary form must reproduce the above copyright
+  notice, this list of conditions and the following disclaimer in the
+  documentation and/or other materials provided with the distribution.
+
+  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+  POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "vsearch5d.h"
+
+#define BLOCKSIZE (4096 * 4096)
+
+/*
+  Binary, column-oriented hit output (--hitsout) and its conversion to
+  the text formats (--hits2text).
+
+  The file starts with a header holding the magic string, the version,
+  and the name and type of each column. Blocks follow, each starting
+  with its kind, its number of rows and the size of its payload.
+
+  Each thread collects its hits in a chunk of its own and writes the
+  chunk as a hits block when it is full. Only the reservation of room
+  in the file is serialized; the output lock is not taken. The payload
+  of a hits block holds each column as an array of fixed-width values,
+  padded to a multiple of 8 bytes, followed by a string table with the
+  query labels and cigar strings. String columns hold offsets into the
+  string table of the block.
+
+  The query and target columns hold the query number and the database
+  sequence number; the target is 0xffffffff for a query without hits.
+  The labels of the targets are stored once, in the targets block
+  written after all hits blocks. An end block completes the file.
+
+  Numbers are stored in the byte order of the host.
+*/
+
+static const char hitsout_magic[8] = { 'V', 'S', '5', 'D', 'H', 'I', 'T', 'S' };
+static const uint32_t hitsout_version = 1;
+static const uint32_t hitsout_nohit = UINT_MAX;
+static const int hitsout_chunk_rows = 16384;
+
+enum
+  {
+    hitsout_block_hits = 1,
+    hitsout_block_targets = 2,
+    hitsout_block_end = 3
+  };
+
+enum
+  {
+    hitsout_type_uint8 = 1,
+    hitsout_type_int32 = 2,
+    hitsout_type_uint32 = 3,
+    hitsout_type_double = 4,
+    hitsout_type_string = 5
+  };
+
+enum
+  {
+    col_query,
+    col_target,
+    col_qlabel,
+    col_ql,
+    col_tl,
+    col_qstrand,
+    col_id,
+    col_id0,
+    col_id1,
+    col_id2,
+    col_id3,
+    col_id4,
+    col_ids,
+    col_mism,
+    col_alnlen,
+    col_opens,
+    col_gaps,
+    col_raw,
+    col_qilo,
+    col_qihi,
+    col_tilo,
+    col_tihi,
+    col_caln,
+    hitsout_columns_count
+  };
+
+struct hitsout_column_s
+{
+  char name[12];
+  uint32_t type;
+};
+
+/* the columns are named after the corresponding userfields */
+
+static const struct hitsout_column_s hitsout_columns[hitsout_columns_count] =
+  {
+    { "query",   hitsout_type_uint32 },
+    { "target",  hitsout_type_uint32 },
+    { "qlabel",  hitsout_type_string },
+    { "ql",      hitsout_type_uint32 },
+    { "tl",      hitsout_type_uint32 },
+    { "qstrand", hitsout_type_uint8 },
+    { "id",      hitsout_type_double },
+    { "id0",     hitsout_type_double },
+    { "id1",     hitsout_type_double },
+    { "id2",     hitsout_type_double },
+    { "id3",     hitsout_type_double },
+    { "id4",     hitsout_type_double },
+    { "ids",     hitsout_type_int32 },
+    { "mism",    hitsout_type_int32 },
+    { "alnlen",  hitsout_type_int32 },
+    { "opens",   hitsout_type_int32 },
+    { "gaps",    hitsout_type_int32 },
+    { "raw",     hitsout_type_int32 },
+    { "qilo",    hitsout_type_int32 },
+    { "qihi",    hitsout_type_int32 },
+    { "tilo",    hitsout_type_int32 },
+    { "tihi",    hitsout_type_int32 },
+    { "caln",    hitsout_type_string }
+  };
+
+struct hitsout_header_s
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t columns;
+};
+
+struct hitsout_block_s
+{
+  uint32_t kind;
+  uint32_t rows;
+  uint64_t size;
+};
+
+struct hitsout_chunk_s
+{
+  int rows;
+  char * columns[hitsout_columns_count];
+  char * strings;
+  uint64_t strings_len;
+  uint64_t strings_alloc;
+  int last_query;
+  uint32_t last_qlabel;
+  bitmap_t * targets_hit;
+  char * block;
+  uint64_t block_alloc;
+};
+
+static int hitsout_fd = -1;
+static uint64_t hitsout_offset = 0;
+static pthread_mutex_t mutex_hitsout;
+static struct hitsout_chunk_s * hitsout_chunks = nullptr;
+static int hitsout_threads = 0;
+
+static uint64_t hitsout_width(int col)
+{
+  switch (hitsout_columns[col].type)
+    {
+    case hitsout_type_uint8:
+      return 1;
+    case hitsout_type_double:
+      return 8;
+    default:
+      return 4;
+    }
+}
+
+static uint64_t hitsout_pad(uint64_t size)
+{
+  return (size + 7) & ~ (uint64_t) 7;
+}
+
+static void hitsout_write(const char * buffer, uint64_t size)
+{
+  /* reserve room in the file, then write without holding the lock */
+
+  xpthread_mutex_lock(&mutex_hitsout);
+  uint64_t offset = hitsout_offset;
+  hitsout_offset += size;
+  xpthread_mutex_unlock(&mutex_hitsout);
+
+  if (xpwrite(hitsout_fd, buffer, size, offset) != size)
+    {
+      fatal("Unable to write to hits output file");
+    }
+}
+
+static char * hitsout_block_alloc(struct hitsout_chunk_s * c,
+                                  uint32_t kind,
+                                  uint32_t rows,
+                                  uint64_t size)
+{
+  /* prepare a zeroed block in the buffer of the chunk */
+
+  uint64_t total = sizeof(struct hitsout_block_s) + size;
+  if (total > c->block_alloc)
+    {
+      c->block_alloc = MAX(total, 2 * c->block_alloc);
+      c->block = (char *) xrealloc(c->block, c->block_alloc);
+    }
+  memset(c->block, 0, total);
+
+  auto * b = (struct hitsout_block_s *) c->block;
+  b->kind = kind;
+  b->rows = rows;
+  b->size = size;
+  return c->block + sizeof(struct hitsout_block_s);
+}
+
+static void hitsout_flush(struct hitsout_chunk_s * c)
+{
+  if (c->rows == 0)
+    {
+      return;
+    }
+
+  uint64_t size = hitsout_pad(c->strings_len);
+  for(int col = 0; col < hitsout_columns_count; col++)
+    {
+      size += hitsout_pad(c->rows * hitsout_width(col));
+    }
+
+  char * p = hitsout_block_alloc(c, hitsout_block_hits, c->rows, size);
+  for(int col = 0; col < hitsout_columns_count; col++)
+    {
+      uint64_t len = c->rows * hitsout_width(col);
+      memcpy(p, c->columns[col], len);
+      p += hitsout_pad(len);
+    }
+  memcpy(p, c->strings, c->strings_len);
+
+  hitsout_write(c->block, sizeof(struct hitsout_block_s) + size);
+
+  c->rows = 0;
+  c->strings_len = 0;
+  c->last_query = -1;
+}
+
+static uint32_t hitsout_string(struct hitsout_chunk_s * c, const char * s)
+{
+  uint64_t len = strlen(s) + 1;
+  if (c->strings_len + len > c->strings_alloc)
+    {
+      c->strings_alloc = MAX(c->strings_len + len, 2 * c->strings_alloc);
+      c->strings = (char *) xrealloc(c->strings, c->strings_alloc);
+    }
+  uint32_t offset = c->strings_len;
+  memcpy(c->strings + c->strings_len, s, len);
+  c->strings_len += len;
+  return offset;
+}
+
+static void hitsout_set(struct hitsout_chunk_s * c, int col, const void * value)
+{
+  uint64_t width = hitsout_width(col);
+  memcpy(c->columns[col] + c->rows * width, value, width);
+}
+
+static void hitsout_row(struct hitsout_chunk_s * c,
+                        int query_no,
+                        char * query_head,
+                        int qseqlen,
+                        struct hit * hp,
+                        const unsigned int * targetmap)
+{
+  if (c->rows == hitsout_chunk_rows)
+    {
+      hitsout_flush(c);
+    }
+
+  /* the hits of a query are consecutive, store its label once */
+  if (query_no != c->last_query)
+    {
+      c->last_qlabel = hitsout_string(c, query_head);
+      c->last_query = query_no;
+    }
+
+  uint32_t query = query_no;
+  uint32_t target = hitsout_nohit;
+  uint32_t ql = qseqlen;
+  uint32_t tl = 0;
+  uint8_t qstrand = 0;
+  double id[6] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+  int32_t values[10] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+  uint32_t caln = hitsout_nohit;
+
+  if (hp)
+    {
+      if (! c->targets_hit)
+        {
+          c->targets_hit = bitmap_init(db_getsequencecount());
+          bitmap_reset_all(c->targets_hit);
+        }
+      bitmap_set(c->targets_hit, hp->target);
+
+      target = targetmap ? targetmap[hp->target] : hp->target;
+      tl = db_getsequencelen(hp->target);
+      qstrand = hp->strand;
+      id[0] = hp->id;
+      id[1] = hp->id0;
+      id[2] = hp->id1;
+      id[3] = hp->id2;
+      id[4] = hp->id3;
+      id[5] = hp->id4;
+      values[0] = hp->matches;
+      values[1] = hp->mismatches;
+      values[2] = hp->internal_alignmentlength;
+      values[3] = hp->internal_gaps;
+      values[4] = hp->internal_indels;
+      values[5] = hp->nwscore;
+      values[6] = hp->trim_q_left + 1;
+      values[7] = qseqlen - hp->trim_q_right;
+      values[8] = hp->trim_t_left + 1;
+      values[9] = tl - hp->trim_t_right;
+      caln = hitsout_string(c, hp->nwalignment);
+    }
+
+  hitsout_set(c, col_query, & query);
+  hitsout_set(c, col_target, & target);
+  hitsout_set(c, col_qlabel, & c->last_qlabel);
+  hitsout_set(c, col_ql, & ql);
+  hitsout_set(c, col_tl, & tl);
+  hitsout_set(c, col_qstrand, & qstrand);
+  for(int i = 0; i < 6; i++)
+    {
+      hitsout_set(c, col_id + i, id + i);
+    }
+  for(int i = 0; i < 10; i++)
+    {
+      hitsout_set(c, col_ids + i, values + i);
+    }
+  hitsout_set(c, col_caln, & caln);
+
+  c->rows++;
+}
+
+void hitsout_open(const char * filename, int threads)
+{
+  hitsout_fd = xopen_write(filename);
+  if (hitsout_fd < 0)
+    {
+      fatal("Unable to open hits output file for writing");
+    }
+
+  xpthread_mutex_init(&mutex_hitsout, nullptr);
+  hitsout_offset = 0;
+
+  hitsout_threads = threads;
+  hitsout_chunks = (struct hitsout_chunk_s *)
+    xmalloc(threads * sizeof(struct hitsout_chunk_s));
+  memset(hitsout_chunks, 0, threads * sizeof(struct hitsout_chunk_s));
+  for(int t = 0; t < threads; t++)
+    {
+      struct hitsout_chunk_s * c = hitsout_chunks + t;
+      for(int col = 0; col < hitsout_columns_count; col++)
+        {
+          c->columns[col] =
+            (char *) xmalloc(hitsout_chunk_rows * hitsout_width(col));
+        }
+      c->last_query = -1;
+    }
+
+  uint64_t size = sizeof(struct hitsout_header_s) + sizeof(hitsout_columns);
+  char * buffer = (char *) xmalloc(size);
+  auto * h = (struct hitsout_header_s *) buffer;
+  memcpy(h->magic, hitsout_magic, sizeof(hitsout_magic));
+  h->version = hitsout_version;
+  h->columns = hitsout_columns_count;
+  memcpy(buffer + sizeof(struct hitsout_header_s),
+         hitsout_columns,
+         sizeof(hitsout_columns));
+  hitsout_write(buffer, size);
+  xfree(buffer);
+}
+
+void hitsout_add(int64_t t,
+                 int query_no,
+                 char * query_head,
+                 int qseqlen,
+                 struct hit * hits,
+                 int hit_count,
+                 const unsigned int * targetmap)
+{
+  /* store the hits reported in the text formats, or the missing hit */
+
+  struct hitsout_chunk_s * c = hitsout_chunks + t;
+  int64_t toreport = MIN(opt_maxhits, hit_count);
+
+  if (toreport == 0)
+    {
+      hitsout_row(c, query_no, query_head, qseqlen, nullptr, targetmap);
+      return;
+    }
+
+  for(int i = 0; i < toreport; i++)
+    {
+      if (opt_top_hits_only && (hits[i].id < hits[0].id))
+        {
+          break;
+        }
+      hitsout_row(c, query_no, query_head, qseqlen, hits + i, targetmap);
+    }
+}
+
+void hitsout_close(const unsigned int * targetmap)
+{
+  /* write the remaining chunks, the targets hit and the end of file */
+
+  bitmap_t * targets_hit = nullptr;
+  for(int t = 0; t < hitsout_threads; t++)
+    {
+      struct hitsout_chunk_s * c = hitsout_chunks + t;
+      hitsout_flush(c);
+      if (c->targets_hit)
+        {
+          if (! targets_hit)
+            {
+              targets_hit = c->targets_hit;
+            }
+          else
+            {
+              for(unsigned int i = 0; i < (targets_hit->size + 7) / 8; i++)
+                {
+                  targets_hit->bitmap[i] |= c->targets_hit->bitmap[i];
+                }
+              bitmap_free(c->targets_hit);
+            }
+        }
+    }
+
+  struct hitsout_chunk_s * c = hitsout_chunks;
+
+  uint32_t rows = 0;
+  for(uint64_t i = 0; targets_hit && (i < targets_hit->size); i++)
+    {
+      if (bitmap_get(targets_hit, i))
+        {
+          hitsout_string(c, db_getheader(i));
+          rows++;
+        }
+    }
+
+  uint64_t len = hitsout_pad(rows * sizeof(uint32_t));
+  char * p = hitsout_block_alloc(c,
+                                 hitsout_block_targets,
+                                 rows,
+                                 3 * len + hitsout_pad(c->strings_len));
+  auto * target = (uint32_t *) p;
+  auto * tl = (uint32_t *) (p + len);
+  auto * label = (uint32_t *) (p + 2 * len);
+  memcpy(p + 3 * len, c->strings, c->strings_len);
+
+  uint32_t j = 0;
+  uint32_t offset = 0;
+  for(uint64_t i = 0; targets_hit && (i < targets_hit->size); i++)
+    {
+      if (bitmap_get(targets_hit, i))
+        {
+          target[j] = targetmap ? targetmap[i] : i;
+          tl[j] = db_getsequencelen(i);
+          label[j] = offset;
+          offset += db_getheaderlen(i) + 1;
+          j++;
+        }
+    }
+
+  hitsout_write(c->block,
+                sizeof(struct hitsout_block_s) + 3 * len
+                + hitsout_pad(c->strings_len));
+
+  hitsout_block_alloc(c, hitsout_block_end, 0, 0);
+  hitsout_write(c->block, sizeof(struct hitsout_block_s));
+
+  close(hitsout_fd);
+  hitsout_fd = -1;
+
+  if (targets_hit)
+    {
+      bitmap_free(targets_hit);
+    }
+
+  for(int t = 0; t < hitsout_threads; t++)
+    {
+      c = hitsout_chunks + t;
+      for(int col = 0; col < hitsout_columns_count; col++)
+        {
+          xfree(c->columns[col]);
+        }
+      if (c->strings)
+        {
+          xfree(c->strings);
+        }
+      if (c->block)
+        {
+          xfree(c->block);
+        }
+    }
+  xfree(hitsout_chunks);
+  hitsout_chunks = nullptr;
+
+  xpthread_mutex_destroy(&mutex_hitsout);
+}
+
+/* conversion to text */
+
+static void hitsout_read(int fd, void * buf, uint64_t nbyte, uint64_t offset)
+{
+  if (xlseek(fd, offset, SEEK_SET) != offset)
+    {
+      fatal("Unable to seek in hits file or invalid hits file");
+    }
+
+  uint64_t done = 0;
+  while (done < nbyte)
+    {
+      int64_t res = read(fd, ((char*)buf) + done, MIN(BLOCKSIZE, nbyte - done));
+      if (res <= 0)
+        {
+          fatal("Unable to read from hits file or invalid hits file");
+        }
+      done += res;
+    }
+}
+
+static unsigned int * hitsout_targets = nullptr;
+static uint32_t hitsout_targets_count = 0;
+
+static int hitsout_compare_targets(const void * a, const void * b)
+{
+  auto x = * (const unsigned int *) a;
+  auto y = * (const unsigned int *) b;
+
+  if (x < y)
+    {
+      return -1;
+    }
+  else if (x > y)
+    {
+      return +1;
+    }
+  else
+    {
+      return 0;
+    }
+}
+
+static void hitsout_load_targets(int fd, uint64_t offset, uint32_t rows, uint64_t size)
+{
+  /* the targets hit become the database, in the order of their numbers */
+
+  uint64_t len = hitsout_pad(rows * sizeof(uint32_t));
+  if (size < 3 * len)
+    {
+      fatal("Invalid hits file");
+    }
+
+  char * payload = (char *) xmalloc(size);
+  hitsout_read(fd, payload, size, offset);
+
+  auto * target = (uint32_t *) payload;
+  auto * tl = (uint32_t *) (payload + len);
+  auto * label = (uint32_t *) (payload + 2 * len);
+  uint64_t strings_len = size - 3 * len;
+
+  /* the labels are followed by an empty sequence shared by all */
+  datap = (char *) xmalloc(strings_len + 1);
+  memcpy(datap, payload + 3 * len, strings_len);
+  datap[strings_len] = 0;
+
+  seqindex = (seqinfo_t *) xmalloc(rows * sizeof(seqinfo_t));
+  memset(seqindex, 0, rows * sizeof(seqinfo_t));
+  hitsout_targets = (unsigned int *) xmalloc(rows * sizeof(unsigned int));
+
+  uint64_t nucleotides = 0;
+  uint64_t longest = 0;
+  uint64_t shortest = rows ? UINT_MAX : 0;
+  uint64_t longestheader = 0;
+
+  for(uint32_t i = 0; i < rows; i++)
+    {
+      if ((label[i] >= strings_len) ||
+          (memchr(datap + label[i], 0, strings_len - label[i]) == nullptr) ||
+          ((i > 0) && (target[i] <= target[i - 1])))
+        {
+          fatal("Invalid hits file");
+        }
+
+      seqinfo_t * p = seqindex + i;
+      p->header_p = label[i];
+      p->headerlen = strlen(datap + label[i]);
+      p->seq_p = strings_len;
+      p->seqlen = tl[i];
+      hitsout_targets[i] = target[i];
+
+      nucleotides += tl[i];
+      longest = MAX(longest, tl[i]);
+      shortest = MIN(shortest, tl[i]);
+      longestheader = MAX(longestheader, p->headerlen);
+    }
+
+  db_setinfo(false, rows, nucleotides, longest, shortest, longestheader);
+  hitsout_targets_count = rows;
+
+  xfree(payload);
+}
+
+static void hitsout_convert_block(char * payload,
+                                  uint32_t rows,
+                                  uint64_t size,
+                                  FILE * fp_userout,
+                                  FILE * fp_blast6out)
+{
+  char * columns[hitsout_columns_count];
+  uint64_t len = 0;
+  for(int col = 0; col < hitsout_columns_count; col++)
+    {
+      columns[col] = payload + len;
+      len += hitsout_pad(rows * hitsout_width(col));
+    }
+  if (len > size)
+    {
+      fatal("Invalid hits file");
+    }
+
+  char * strings = payload + len;
+  uint64_t strings_len = size - len;
+  if ((strings_len == 0) || strings[strings_len - 1])
+    {
+      fatal("Invalid hits file");
+    }
+
+  for(uint32_t r = 0; r < rows; r++)
+    {
+      uint32_t target;
+      uint32_t qlabel;
+      uint32_t ql;
+      uint32_t caln;
+      uint8_t qstrand;
+      int32_t values[10];
+      double id[6];
+
+      memcpy(& target, columns[col_target] + 4 * r, 4);
+      memcpy(& qlabel, columns[col_qlabel] + 4 * r, 4);
+      memcpy(& ql, columns[col_ql] + 4 * r, 4);
+      memcpy(& caln, columns[col_caln] + 4 * r, 4);
+      memcpy(& qstrand, columns[col_qstrand] + r, 1);
+      for(int i = 0; i < 6; i++)
+        {
+          memcpy(id + i, columns[col_id + i] + 8 * r, 8);
+        }
+      for(int i = 0; i < 10; i++)
+        {
+          memcpy(values + i, columns[col_ids + i] + 4 * r, 4);
+        }
+
+      if (qlabel >= strings_len)
+        {
+          fatal("Invalid hits file");
+        }
+      char * query_head = strings + qlabel;
+
+      if (target == hitsout_nohit)
+        {
+          if (opt_output_no_hits)
+            {
+              if (fp_userout)
+                {
+                  results_show_userout_one(fp_userout, nullptr,
+                                           query_head, nullptr, ql, nullptr);
+                }
+              if (fp_blast6out)
+                {
+                  results_show_blast6out_one(fp_blast6out, nullptr,
+                                             query_head, nullptr, ql, nullptr);
+                }
+            }
+          continue;
+        }
+
+      auto * t = (unsigned int *) bsearch(& target,
+                                          hitsout_targets,
+                                          hitsout_targets_count,
+                                          sizeof(unsigned int),
+                                          hitsout_compare_targets);
+      if ((! t) || (caln >= strings_len))
+        {
+          fatal("Invalid hits file");
+        }
+
+      struct hit h;
+      memset(& h, 0, sizeof(struct hit));
+      h.target = t - hitsout_targets;
+      h.strand = qstrand;
+      h.id = id[0];
+      h.id0 = id[1];
+      h.id1 = id[2];
+      h.id2 = id[3];
+      h.id3 = id[4];
+      h.id4 = id[5];
+      h.matches = values[0];
+      h.mismatches = values[1];
+      h.internal_alignmentlength = values[2];
+      h.internal_gaps = values[3];
+      h.internal_indels = values[4];
+      h.nwscore = values[5];
+      h.trim_q_left = values[6] - 1;
+      h.trim_q_right = ql - values[7];
+      h.trim_t_left = values[8] - 1;
+      h.trim_t_right = db_getsequencelen(h.target) - values[9];
+      h.nwalignment = strings + caln;
+
+      if (fp_userout)
+        {
+          results_show_userout_one(fp_userout, & h,
+                                   query_head, nullptr, ql, nullptr);
+        }
+      if (fp_blast6out)
+        {
+          results_show_blast6out_one(fp_blast6out, & h,
+                                     query_head, nullptr, ql, nullptr);
+        }
+    }
+}
+
+void hitsout_convert()
+{
+  for(int c = 0; c < userfields_requested_count; c++)
+    {
+      int field = userfields_requested[c];
+      if ((field == 26) || (field == 27))
+        {
+          fatal("The qrow and trow fields need the sequences, which are not stored in hits files");
+        }
+    }
+
+  int fd = xopen_read(opt_hits2text);
+  if (fd < 0)
+    {
+      fatal("Unable to open hits file for reading");
+    }
+
+  xstat_t fs;
+  if (xfstat(fd, & fs))
+    {
+      fatal("Unable to get status for hits file");
+    }
+  if (! S_ISREG(fs.st_mode))
+    {
+      fatal("Hits file must be a regular file");
+    }
+  uint64_t filesize = fs.st_size;
+
+  /* check the header */
+  struct hitsout_header_s h;
+  struct hitsout_column_s columns[hitsout_columns_count];
+  if (filesize < sizeof(h) + sizeof(columns))
+    {
+      fatal("Invalid hits file");
+    }
+  hitsout_read(fd, & h, sizeof(h), 0);
+  if (memcmp(h.magic, hitsout_magic, sizeof(hitsout_magic)))
+    {
+      fatal("Invalid hits file");
+    }
+  if ((h.version != hitsout_version) || (h.columns != hitsout_columns_count))
+    {
+      fatal("Unsupported version of hits file");
+    }
+  hitsout_read(fd, columns, sizeof(columns), sizeof(h));
+  if (memcmp(columns, hitsout_columns, sizeof(columns)))
+    {
+      fatal("Unsupported version of hits file");
+    }
+  uint64_t first = sizeof(h) + sizeof(columns);
+
+  /* find the targets, stored after the hits */
+  bool complete = false;
+  uint64_t offset = first;
+  while (offset + sizeof(struct hitsout_block_s) <= filesize)
+    {
+      struct hitsout_block_s b;
+      hitsout_read(fd, & b, sizeof(b), offset);
+      offset += sizeof(b);
+      if (b.size > filesize - offset)
+        {
+          break;
+        }
+      if (b.kind == hitsout_block_targets)
+        {
+          hitsout_load_targets(fd, offset, b.rows, b.size);
+        }
+      else if (b.kind == hitsout_block_end)
+        {
+          complete = true;
+          break;
+        }
+      offset += b.size;
+    }
+  if ((! complete) || (! hitsout_targets))
+    {
+      fatal("Incomplete hits file");
+    }
+
+  FILE * fp_userout = nullptr;
+  FILE * fp_blast6out = nullptr;
+
+  if (opt_userout)
+    {
+      fp_userout = fopen_output(opt_userout);
+      if (! fp_userout)
+        {
+          fatal("Unable to open user-defined output file for writing");
+        }
+    }
+
+  if (opt_blast6out)
+    {
+      fp_blast6out = fopen_output(opt_blast6out);
+      if (! fp_blast6out)
+        {
+          fatal("Unable to open blast6-like output file for writing");
+        }
+    }
+
+  progress_init("Converting hits", filesize);
+
+  char * payload = nullptr;
+  uint64_t payload_alloc = 0;
+  uint64_t hits = 0;
+
+  offset = first;
+  while (true)
+    {
+      struct hitsout_block_s b;
+      hitsout_read(fd, & b, sizeof(b), offset);
+      offset += sizeof(b);
+      if (b.kind == hitsout_block_end)
+        {
+          break;
+        }
+      if (b.kind == hitsout_block_hits)
+        {
+          if (b.size > payload_alloc)
+            {
+              payload_alloc = b.size;
+              payload = (char *) xrealloc(payload, payload_alloc);
+            }
+          hitsout_read(fd, payload, b.size, offset);
+          hitsout_convert_block(payload, b.rows, b.size,
+                                fp_userout, fp_blast6out);
+          hits += b.rows;
+        }
+      offset += b.size;
+      progress_update(offset);
+    }
+
+  progress_done();
+
+  if (! opt_quiet)
+    {
+      fprintf(stderr, "%" PRIu64 " rows converted\n", hits);
+    }
+  if (opt_log)
+    {
+      fprintf(fp_log, "%" PRIu64 " rows converted\n", hits);
+    }
+
+  if (payload)
+    {
+      xfree(payload);
+    }
+  if (fp_userout)
+    {
+      fclose(fp_userout);
+    }
+  if (fp_blast6out)
+    {
+      fclose(fp_blast6out);
+    }
+  close(fd);
+
+  xfree(hitsout_targets);
+  hitsout_targets = nullptr;
+  db_free();
+}
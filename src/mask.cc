@@ -72,17 +72,23 @@ static const int bitmask = word_count - 1;
 
 int wo(int len, const char *s, int *beg, int *end)
 {
+  /*
+    Find the region with the highest score in a window, where the score
+    of a region of j words is 10 times the number of pairs of identical
+    words divided by j. As only scores above dust_level are used, the
+    search starts at that level, and returns it if nothing scores higher.
+    The first region (by start, then length) with the best score wins.
+  */
+
   int l1 = len - dust_word + 1 - 5; /* smallest possible region is 8 */
   if (l1 < 0)
     {
       return 0;
     }
 
-  int bestv = 0;
-  int besti = 0;
-  int bestj = 0;
   int counts[word_count];
   int words[dust_window];
+  int pairs[dust_window];
   int word = 0;
 
   for (int j = 0; j < len; j++)
@@ -92,30 +98,69 @@ int wo(int len, const char *s, int *beg, int *end)
       words[j] = word & bitmask;
     }
 
+  /* pairs[i] = number of pairs of identical words from offset i on */
+  memset(counts, 0, sizeof(counts));
+  pairs[len - dust_word + 1] = 0;
+  for (int j = len - 1; j >= dust_word - 1; j--)
+    {
+      word = words[j];
+      pairs[j - dust_word + 1] = pairs[j - dust_word + 2] + counts[word];
+      counts[word]++;
+    }
+  memset(counts, 0, sizeof(counts));
+
+  /*
+    A region starting at i with j words can only score above bestv if
+    10 * sum >= (bestv + 1) * j, where the number of pairs (sum) is at
+    most pairs[i], and at most (j-1)(j-2)/2. This bounds j from both
+    sides; the bounds only tighten as i and bestv increase.
+  */
+
+  int bestv = dust_level;
+  int besti = 0;
+  int bestj = 0;
+  int first = dust_word - 1;
+
   for (int i=0; i < l1; i++)
     {
-      memset(counts, 0, sizeof(counts));
+      int limit = bestv + 1;
+
+      while (5 * (first - 1) * (first - 2) < limit * first)
+        {
+          first++;
+        }
+
+      int last = MIN(len - i - 1, 10 * pairs[i] / limit);
+      if (last < first)
+        {
+          break;
+        }
 
       int sum = 0;
 
-      for (int j = dust_word-1; j<len-i; j++)
+      for (int j = dust_word-1; j <= last; j++)
         {
           word = words[i+j];
           int c = counts[word];
           if (c)
             {
               sum += c;
-              int v = 10 * sum / j;
-
-              if (v > bestv)
+              if (10 * sum >= limit * j)
                 {
-                  bestv = v;
+                  bestv = 10 * sum / j;
                   besti = i;
                   bestj = j;
+                  limit = bestv + 1;
+                  last = MIN(last, 10 * pairs[i] / limit);
                 }
             }
           counts[word]++;
         }
+
+      for (int j = dust_word-1; j <= last; j++)
+        {
+          counts[words[i+j]] = 0;
+        }
     }
 
   *beg = besti;
@@ -202,9 +247,9 @@ void * dust_all_worker(void * vp)
   return nullptr;
 }
 
-void dust_all()
+void dust_all(uint64_t first)
 {
-  nextseq = 0;
+  nextseq = first;
   seqcount = db_getsequencecount();
   progress_init("Masking", seqcount);
 
@@ -247,9 +292,9 @@ void hardmask(char * seq, int len)
     }
 }
 
-void hardmask_all()
+void hardmask_all(uint64_t first)
 {
-  for(uint64_t i=0; i<db_getsequencecount(); i++)
+  for(uint64_t i=first; i<db_getsequencecount(); i++)
     {
       hardmask(db_getsequence(i), db_getsequencelen(i));
     }
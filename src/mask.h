@@ -71,5 +71,6 @@ void fastx_mask();
 
 void dust(char * m, int len);
 void hardmask(char * m, int len);
-void dust_all();
-void hardmask_all();
+/* sequences before first are left as they are */
+void dust_all(uint64_t first = 0);
+void hardmask_all(uint64_t first = 0);
@@ -86,6 +86,7 @@ inline void minheap_empty(minheap_t * m)
   m->count = 0;
 }
 
+int minheap_compare(const void * a, const void * b);
 elem_t minheap_poplast(minheap_t * m);
 void minheap_sort(minheap_t * m);
 minheap_t * minheap_init(int size);
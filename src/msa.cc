@@ -68,74 +68,268 @@
 typedef uint64_t prof_type;
 #define PROFSIZE 6
 
-static char * aln;
-static int alnpos;
-static prof_type * profile;
+/*
+  The clusters are processed in batches. The profiles and consensus
+  sequences of the clusters in a batch are computed in parallel by a
+  pool of worker threads, each cluster into its own slot, and then
+  written in cluster order. The aligned rows are not kept: each row is
+  built in turn into one buffer, both when it is added to the profile
+  and when it is written to the msaout file. The slot buffers are
+  reused for the following batches, except those grown beyond
+  MSA_SLOT_KEEP bytes by a large cluster, which are released.
+*/
 
-void msa_add(char c, prof_type abundance)
+#define MSA_BATCH_CLUSTERS_PER_THREAD 16
+#define MSA_SLOT_KEEP (1 << 20)
+
+struct msa_slot_s
+{
+  struct msa_cluster_s * cluster;
+  int alnlen;
+  int conslen;
+
+  int * maxi;
+  int64_t maxi_alloc;
+  prof_type * profile;
+  int64_t profile_alloc;
+  char * row; /* the row being built */
+  int64_t row_alloc;
+  char * aln; /* the consensus row */
+  int64_t aln_alloc;
+  char * cons;
+  int64_t cons_alloc;
+  char * rc_buffer;
+  int64_t rc_alloc;
+};
+
+typedef struct msa_thread_s
 {
-  prof_type * p = profile + PROFSIZE * alnpos;
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  int work;
+} msa_thread_t;
+
+static struct msa_slot_s * slots = nullptr;
+static int slot_count = 0;
+static int batch_count = 0;
+static int batch_next = 0;
+
+static msa_thread_t * msa_threads = nullptr;
+static pthread_attr_t attr;
+static pthread_mutex_t mutex;
+
+void msa_grow(void ** buffer, int64_t * alloc, int64_t needed)
+{
+  if (needed > * alloc)
+    {
+      * buffer = xrealloc(* buffer, needed);
+      * alloc = needed;
+    }
+}
 
-  switch(toupper(c))
+void msa_release(void ** buffer, int64_t * alloc, int64_t keep)
+{
+  /* free a buffer larger than keep bytes */
+  if (* alloc > keep)
     {
-    case 'A':
-      p[0] += abundance;
-      break;
-    case 'C':
-      p[1] += abundance;
-      break;
-    case 'G':
-      p[2] += abundance;
-      break;
-    case 'T':
-    case 'U':
-      p[3] += abundance;
-      break;
-    case 'R':
-    case 'Y':
-    case 'S':
-    case 'W':
-    case 'K':
-    case 'M':
-    case 'B':
-    case 'D':
-    case 'H':
-    case 'V':
-    case 'N':
-      p[4] += abundance;
-      break;
-    case '-':
-      p[5] += abundance;
-      break;
+      xfree(* buffer);
+      * buffer = nullptr;
+      * alloc = 0;
     }
+}
 
-  aln[alnpos++] = c;
+inline char * msa_cigar_next(char * p, int64_t * run, char * op)
+{
+  /* parse one run length and operation; a missing length means 1 */
+  int64_t n = 0;
+  bool digits = false;
+  while ((* p >= '0') && (* p <= '9'))
+    {
+      n = 10 * n + (* p++ - '0');
+      digits = true;
+    }
+  * run = digits ? n : 1;
+  * op = * p++;
+  return p;
 }
 
-void msa(FILE * fp_msaout, FILE * fp_consout, FILE * fp_profile,
-         int cluster,
-         int target_count, struct msa_target_s * target_list,
-         int64_t totalabundance)
+inline void msa_add(prof_type * profile, char * row, int & alnpos,
+                    char c, prof_type abundance)
 {
+  if (profile)
+    {
+      prof_type * p = profile + PROFSIZE * alnpos;
+
+      switch(toupper(c))
+        {
+        case 'A':
+          p[0] += abundance;
+          break;
+        case 'C':
+          p[1] += abundance;
+          break;
+        case 'G':
+          p[2] += abundance;
+          break;
+        case 'T':
+        case 'U':
+          p[3] += abundance;
+          break;
+        case 'R':
+        case 'Y':
+        case 'S':
+        case 'W':
+        case 'K':
+        case 'M':
+        case 'B':
+        case 'D':
+        case 'H':
+        case 'V':
+        case 'N':
+          p[4] += abundance;
+          break;
+        case '-':
+          p[5] += abundance;
+          break;
+        }
+    }
+
+  row[alnpos++] = c;
+}
+
+void msa_row(struct msa_slot_s * sp, int j, prof_type * profile)
+{
+  /* build the aligned row of target j in sp->row, and add it to the
+     profile if given */
+
+  struct msa_target_s * target_list = sp->cluster->target_list;
+  int * maxi = sp->maxi;
+  int centroid_len = db_getsequencelen(target_list[0].seqno);
+
+  int target_seqno = target_list[j].seqno;
+  char * target_seq = db_getsequence(target_seqno);
+  prof_type target_abundance = opt_sizein ?
+    db_getabundance(target_seqno) : 1;
+
+  if (target_list[j].strand)
+    {
+      reverse_complement(sp->rc_buffer, target_seq,
+                         db_getsequencelen(target_seqno));
+      target_seq = sp->rc_buffer;
+    }
+
+  char * row = sp->row;
+  int inserted = 0;
+  int qpos = 0;
+  int tpos = 0;
+  int alnpos = 0;
+
+  if (!j)
+    {
+      for(int x=0; x < centroid_len; x++)
+        {
+          for(int y=0; y < maxi[qpos]; y++)
+            {
+              msa_add(profile, row, alnpos, '-', target_abundance);
+            }
+          msa_add(profile, row, alnpos,
+                  target_seq[tpos++], target_abundance);
+          qpos++;
+        }
+    }
+  else
+    {
+      char * p = target_list[j].cigar;
+      while (* p)
+        {
+          int64_t run;
+          char op;
+          p = msa_cigar_next(p, & run, & op);
+
+          if (op == 'D')
+            {
+              for(int x=0; x < maxi[qpos]; x++)
+                {
+                  if (x < run)
+                    {
+                      msa_add(profile, row, alnpos,
+                              target_seq[tpos++], target_abundance);
+                    }
+                  else
+                    {
+                      msa_add(profile, row, alnpos,
+                              '-', target_abundance);
+                    }
+                }
+              inserted = 1;
+            }
+          else
+            {
+              for(int x=0; x < run; x++)
+                {
+                  if (!inserted)
+                    {
+                      for(int y=0; y < maxi[qpos]; y++)
+                        {
+                          msa_add(profile, row, alnpos,
+                                  '-', target_abundance);
+                        }
+                    }
+
+                  if (op == 'M')
+                    {
+                      msa_add(profile, row, alnpos,
+                              target_seq[tpos++], target_abundance);
+                    }
+                  else
+                    {
+                      msa_add(profile, row, alnpos,
+                              '-', target_abundance);
+                    }
+
+                  qpos++;
+                  inserted = 0;
+                }
+            }
+        }
+    }
+
+  if (!inserted)
+    {
+      for(int x=0; x < maxi[qpos]; x++)
+        {
+          msa_add(profile, row, alnpos, '-', target_abundance);
+        }
+    }
+
+  /* end of sequence string */
+  row[alnpos] = 0;
+}
+
+void msa_compute(struct msa_slot_s * sp)
+{
+  int target_count = sp->cluster->target_count;
+  struct msa_target_s * target_list = sp->cluster->target_list;
+
   int centroid_seqno = target_list[0].seqno;
   int centroid_len = db_getsequencelen(centroid_seqno);
 
   /* find max insertions in front of each position in the centroid sequence */
-  int * maxi = (int *) xmalloc((centroid_len + 1) * sizeof(int));
+  msa_grow((void **) & sp->maxi, & sp->maxi_alloc,
+           (centroid_len + 1) * sizeof(int));
+  int * maxi = sp->maxi;
   memset(maxi, 0, (centroid_len + 1) * sizeof(int));
 
   for(int j=1; j<target_count; j++)
     {
       char * p = target_list[j].cigar;
-      char * e = p + strlen(p);
       int pos = 0;
-      while (p < e)
+      while (* p)
         {
-          int64_t run = 1;
-          int scanlength = 0;
-          sscanf(p, "%" PRId64 "%n", &run, &scanlength);
-          p += scanlength;
-          char op = *p++;
+          int64_t run;
+          char op;
+          p = msa_cigar_next(p, & run, & op);
           switch (op)
             {
             case 'M':
@@ -159,12 +353,17 @@ void msa(FILE * fp_msaout, FILE * fp_consout, FILE * fp_profile,
       alnlen += maxi[i];
     }
   alnlen += centroid_len;
+  sp->alnlen = alnlen;
 
-  /* allocate memory for profile (for consensus) and aligned seq */
-  profile = (prof_type *) xmalloc(PROFSIZE * sizeof(prof_type) * alnlen);
+  /* profile (for consensus), aligned row and consensus */
+  msa_grow((void **) & sp->profile, & sp->profile_alloc,
+           PROFSIZE * sizeof(prof_type) * (alnlen + 1));
+  prof_type * profile = sp->profile;
   memset(profile, 0, PROFSIZE * sizeof(prof_type) * alnlen);
-  aln = (char *) xmalloc(alnlen+1);
-  char * cons = (char *) xmalloc(alnlen+1);
+
+  msa_grow((void **) & sp->row, & sp->row_alloc, alnlen + 1);
+  msa_grow((void **) & sp->aln, & sp->aln_alloc, alnlen + 1);
+  msa_grow((void **) & sp->cons, & sp->cons_alloc, alnlen + 1);
 
   /* Find longest target sequence on reverse strand and allocate buffer */
   int64_t longest_reversed = 0;
@@ -179,136 +378,21 @@ void msa(FILE * fp_msaout, FILE * fp_consout, FILE * fp_profile,
             }
         }
     }
-  char * rc_buffer = nullptr;
   if (longest_reversed > 0)
     {
-      rc_buffer = (char*) xmalloc(longest_reversed + 1);
-    }
-
-  /* blank line before each msa */
-  if (fp_msaout)
-    {
-      fprintf(fp_msaout, "\n");
+      msa_grow((void **) & sp->rc_buffer, & sp->rc_alloc,
+               longest_reversed + 1);
     }
 
   for(int j=0; j<target_count; j++)
     {
-      int target_seqno = target_list[j].seqno;
-      char * target_seq = db_getsequence(target_seqno);
-      prof_type target_abundance = opt_sizein ?
-        db_getabundance(target_seqno) : 1;
-
-      if (target_list[j].strand)
-        {
-          reverse_complement(rc_buffer, target_seq,
-                             db_getsequencelen(target_seqno));
-          target_seq = rc_buffer;
-        }
-
-      int inserted = 0;
-      int qpos = 0;
-      int tpos = 0;
-      alnpos = 0;
-
-      if (!j)
-        {
-          for(int x=0; x < centroid_len; x++)
-            {
-              for(int y=0; y < maxi[qpos]; y++)
-                {
-                  msa_add('-', target_abundance);
-                }
-              msa_add(target_seq[tpos++], target_abundance);
-              qpos++;
-            }
-        }
-      else
-        {
-          char * p = target_list[j].cigar;
-          char * e = p + strlen(p);
-          while (p < e)
-            {
-              int64_t run = 1;
-              int scanlength = 0;
-              sscanf(p, "%" PRId64 "%n", &run, &scanlength);
-              p += scanlength;
-              char op = *p++;
-
-              if (op == 'D')
-                {
-                  for(int x=0; x < maxi[qpos]; x++)
-                    {
-                      if (x < run)
-                        {
-                          msa_add(target_seq[tpos++], target_abundance);
-                        }
-                      else
-                        {
-                          msa_add('-', target_abundance);
-                        }
-                    }
-                  inserted = 1;
-                }
-              else
-                {
-                  for(int x=0; x < run; x++)
-                    {
-                      if (!inserted)
-                        {
-                          for(int y=0; y < maxi[qpos]; y++)
-                            {
-                              msa_add('-', target_abundance);
-                            }
-                        }
-
-                      if (op == 'M')
-                        {
-                          msa_add(target_seq[tpos++], target_abundance);
-                        }
-                      else
-                        {
-                          msa_add('-', target_abundance);
-                        }
-
-                      qpos++;
-                      inserted = 0;
-                    }
-                }
-            }
-        }
-
-      if (!inserted)
-        {
-          for(int x=0; x < maxi[qpos]; x++)
-            {
-              msa_add('-', target_abundance);
-            }
-        }
-
-      /* end of sequence string */
-      aln[alnpos] = 0;
-
-      /* print header & sequence */
-      if (fp_msaout)
-        {
-          fasta_print_general(fp_msaout,
-                              j ? "" : "*",
-                              aln,
-                              alnlen,
-                              db_getheader(target_seqno),
-                              db_getheaderlen(target_seqno),
-                              db_getabundance(target_seqno),
-                              0, -1.0, -1, -1, nullptr, 0.0);
-        }
-    }
-
-  if (rc_buffer)
-    {
-      xfree(rc_buffer);
+      msa_row(sp, j, profile);
     }
 
   /* consensus */
 
+  char * aln = sp->aln;
+  char * cons = sp->cons;
   int conslen = 0;
 
   /* Censor part of the consensus sequence outside the centroid sequence */
@@ -362,9 +446,41 @@ void msa(FILE * fp_msaout, FILE * fp_consout, FILE * fp_profile,
 
   aln[alnlen] = 0;
   cons[conslen] = 0;
+  sp->conslen = conslen;
+}
+
+void msa_print(FILE * fp_msaout, FILE * fp_consout, FILE * fp_profile,
+               struct msa_slot_s * sp)
+{
+  int cluster = sp->cluster->cluster;
+  int target_count = sp->cluster->target_count;
+  struct msa_target_s * target_list = sp->cluster->target_list;
+  int64_t totalabundance = sp->cluster->totalabundance;
+  int centroid_seqno = target_list[0].seqno;
+  int alnlen = sp->alnlen;
+  char * aln = sp->aln;
+  prof_type * profile = sp->profile;
 
   if (fp_msaout)
     {
+      /* blank line before each msa */
+      fprintf(fp_msaout, "\n");
+
+      /* build each row again and print header & sequence */
+      for(int j=0; j<target_count; j++)
+        {
+          int target_seqno = target_list[j].seqno;
+          msa_row(sp, j, nullptr);
+          fasta_print_general(fp_msaout,
+                              j ? "" : "*",
+                              sp->row,
+                              alnlen,
+                              db_getheader(target_seqno),
+                              db_getheaderlen(target_seqno),
+                              db_getabundance(target_seqno),
+                              0, -1.0, -1, -1, nullptr, 0.0);
+        }
+
       fasta_print(fp_msaout, "consensus", aln, alnlen);
     }
 
@@ -372,8 +488,8 @@ void msa(FILE * fp_msaout, FILE * fp_consout, FILE * fp_profile,
     {
       fasta_print_general(fp_consout,
                           "centroid=",
-                          cons,
-                          conslen,
+                          sp->cons,
+                          sp->conslen,
                           db_getheader(centroid_seqno),
                           db_getheaderlen(centroid_seqno),
                           totalabundance,
@@ -415,9 +531,197 @@ void msa(FILE * fp_msaout, FILE * fp_consout, FILE * fp_profile,
         }
       fprintf(fp_profile, "\n");
     }
+}
+
+void msa_slot_release(struct msa_slot_s * sp, int64_t keep)
+{
+  msa_release((void **) & sp->maxi, & sp->maxi_alloc, keep);
+  msa_release((void **) & sp->profile, & sp->profile_alloc, keep);
+  msa_release((void **) & sp->row, & sp->row_alloc, keep);
+  msa_release((void **) & sp->aln, & sp->aln_alloc, keep);
+  msa_release((void **) & sp->cons, & sp->cons_alloc, keep);
+  msa_release((void **) & sp->rc_buffer, & sp->rc_alloc, keep);
+}
 
-  xfree(maxi);
-  xfree(aln);
-  xfree(cons);
-  xfree(profile);
+void msa_work()
+{
+  /* compute the clusters of the batch, taking one at a time */
+  while (true)
+    {
+      xpthread_mutex_lock(&mutex);
+      int slot = batch_next;
+      if (slot < batch_count)
+        {
+          batch_next++;
+        }
+      xpthread_mutex_unlock(&mutex);
+
+      if (slot >= batch_count)
+        {
+          break;
+        }
+
+      msa_compute(slots + slot);
+    }
+}
+
+void * msa_worker(void * vp)
+{
+  auto t = (int64_t) vp;
+  msa_thread_t * tip = msa_threads + t;
+  xpthread_mutex_lock(&tip->mutex);
+  /* loop until signalled to quit */
+  while (tip->work >= 0)
+    {
+      /* wait for work available */
+      if (tip->work == 0)
+        {
+          xpthread_cond_wait(&tip->cond, &tip->mutex);
+        }
+      if (tip->work > 0)
+        {
+          msa_work();
+          tip->work = 0;
+          xpthread_cond_signal(&tip->cond);
+        }
+    }
+  xpthread_mutex_unlock(&tip->mutex);
+  return nullptr;
+}
+
+void msa_threads_wakeup(int threads)
+{
+  /* tell the threads that there is work to do */
+  for(int t=0; t < threads; t++)
+    {
+      msa_thread_t * tip = msa_threads + t;
+      xpthread_mutex_lock(&tip->mutex);
+      tip->work = 1;
+      xpthread_cond_signal(&tip->cond);
+      xpthread_mutex_unlock(&tip->mutex);
+    }
+
+  /* wait for theads to finish their work */
+  for(int t=0; t < threads; t++)
+    {
+      msa_thread_t * tip = msa_threads + t;
+      xpthread_mutex_lock(&tip->mutex);
+      while (tip->work > 0)
+        {
+          xpthread_cond_wait(&tip->cond, &tip->mutex);
+        }
+      xpthread_mutex_unlock(&tip->mutex);
+    }
+}
+
+void msa_threads_init()
+{
+  xpthread_attr_init(&attr);
+  xpthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+
+  msa_threads = (msa_thread_t *) xmalloc(opt_threads * sizeof(msa_thread_t));
+
+  for(int t=0; t < opt_threads; t++)
+    {
+      msa_thread_t * tip = msa_threads + t;
+      tip->work = 0;
+      xpthread_mutex_init(&tip->mutex, nullptr);
+      xpthread_cond_init(&tip->cond, nullptr);
+      xpthread_create(&tip->thread, &attr, msa_worker, (void*)(int64_t)t);
+    }
+}
+
+void msa_threads_exit()
+{
+  for(int t=0; t < opt_threads; t++)
+    {
+      msa_thread_t * tip = msa_threads + t;
+
+      /* tell worker to quit */
+      xpthread_mutex_lock(&tip->mutex);
+      tip->work = -1;
+      xpthread_cond_signal(&tip->cond);
+      xpthread_mutex_unlock(&tip->mutex);
+
+      /* wait for worker to quit */
+      xpthread_join(tip->thread, nullptr);
+
+      xpthread_cond_destroy(&tip->cond);
+      xpthread_mutex_destroy(&tip->mutex);
+    }
+  xfree(msa_threads);
+  msa_threads = nullptr;
+  xpthread_attr_destroy(&attr);
+}
+
+void msa_all(FILE * fp_msaout, FILE * fp_consout, FILE * fp_profile,
+             int cluster_count, struct msa_cluster_s * cluster_list)
+{
+  slot_count = opt_threads * MSA_BATCH_CLUSTERS_PER_THREAD;
+  slots = (struct msa_slot_s *) xmalloc(slot_count * sizeof(struct msa_slot_s));
+  memset(slots, 0, slot_count * sizeof(struct msa_slot_s));
+
+  xpthread_mutex_init(&mutex, nullptr);
+  if (opt_threads > 1)
+    {
+      msa_threads_init();
+    }
+
+  int64_t total_targets = 0;
+  for(int i=0; i < cluster_count; i++)
+    {
+      total_targets += cluster_list[i].target_count;
+    }
+
+  progress_init("Multiple alignments", total_targets);
+
+  int64_t done_targets = 0;
+  int next_cluster = 0;
+  while (next_cluster < cluster_count)
+    {
+      /* fill a batch */
+      batch_count = 0;
+      batch_next = 0;
+      while ((next_cluster < cluster_count) && (batch_count < slot_count))
+        {
+          slots[batch_count].cluster = cluster_list + next_cluster;
+          batch_count++;
+          next_cluster++;
+        }
+
+      /* compute in parallel */
+      int threads = MIN(opt_threads, batch_count);
+      if (threads > 1)
+        {
+          msa_threads_wakeup(threads);
+        }
+      else
+        {
+          msa_work();
+        }
+
+      /* write in cluster order */
+      for(int s=0; s < batch_count; s++)
+        {
+          msa_print(fp_msaout, fp_consout, fp_profile, slots + s);
+          msa_slot_release(slots + s, MSA_SLOT_KEEP);
+          done_targets += slots[s].cluster->target_count;
+          progress_update(done_targets);
+        }
+    }
+
+  progress_done();
+
+  for(int s=0; s < slot_count; s++)
+    {
+      msa_slot_release(slots + s, 0);
+    }
+  xfree(slots);
+  slots = nullptr;
+
+  if (opt_threads > 1)
+    {
+      msa_threads_exit();
+    }
+  xpthread_mutex_destroy(&mutex);
 }
@@ -68,7 +68,13 @@ struct msa_target_s
   int strand;
 };
 
-void msa(FILE * fp_msaout, FILE * fp_consout, FILE * fp_profile,
-         int cluster,
-         int target_count, struct msa_target_s * target_list,
-         int64_t totalabundance);
+struct msa_cluster_s
+{
+  int cluster;
+  int target_count;
+  struct msa_target_s * target_list;
+  int64_t totalabundance;
+};
+
+void msa_all(FILE * fp_msaout, FILE * fp_consout, FILE * fp_profile,
+             int cluster_count, struct msa_cluster_s * cluster_list);
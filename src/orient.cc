@@ -82,6 +82,327 @@ unsigned int rc_kmer(unsigned int kmer)
 }
 
 
+/*
+  Orientation model file: the number of database sequences containing
+  each k-mer, which is all that orient needs from the database.
+
+  The header is followed by the non-zero counts as pairs of unsigned
+  LEB128 varints: the distance from the previous non-zero k-mer and the
+  count.
+*/
+
+static const char orient_model_magic[8] = { 'V', 'S', '5', 'D',
+                                             'O', 'R', 'N', 'T' };
+static const unsigned int orient_model_version = 1;
+
+struct orient_model_header_s
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t wordlength;
+  uint32_t dbmask;
+  uint32_t reserved;
+  uint64_t sequences;
+  uint64_t kmers;
+  uint64_t size;
+};
+
+static bool orient_model_detect(const char * filename)
+{
+  xstat_t fs;
+
+  if (xstat(filename, & fs))
+    {
+      fatal("Unable to get status for input file (%s)", filename);
+    }
+
+  if (! S_ISREG(fs.st_mode))
+    {
+      return false;
+    }
+
+  FILE * fp = fopen_input(filename);
+  if (! fp)
+    {
+      fatal("Unable to open input file for reading (%s)", filename);
+    }
+
+  char magic[8];
+  size_t got = fread(magic, 1, 8, fp);
+  fclose(fp);
+
+  return (got == 8) && (memcmp(magic, orient_model_magic, 8) == 0);
+}
+
+static void orient_model_putvarint(FILE * fp, uint64_t x)
+{
+  while (x >= 0x80)
+    {
+      fputc((int) ((x & 0x7f) | 0x80), fp);
+      x >>= 7U;
+    }
+  fputc((int) x, fp);
+}
+
+static uint64_t orient_model_getvarint(unsigned char ** pp,
+                                       unsigned char * end)
+{
+  uint64_t x = 0;
+  unsigned int shift = 0;
+  unsigned char * p = * pp;
+
+  while (true)
+    {
+      if ((p >= end) || (shift > 63))
+        {
+          fatal("Invalid orientation model file");
+        }
+      unsigned char c = * p++;
+      x |= (uint64_t) (c & 0x7f) << shift;
+      if ((c & 0x80) == 0)
+        {
+          break;
+        }
+      shift += 7;
+    }
+
+  * pp = p;
+  return x;
+}
+
+static void orient_model_write(FILE * fp,
+                               unsigned int * counts,
+                               uint64_t sequences)
+{
+  uint64_t kmerhashsize = 1ULL << (2 * opt_wordlength);
+
+  struct orient_model_header_s header;
+  memset(& header, 0, sizeof(header));
+  memcpy(header.magic, orient_model_magic, 8);
+  header.version = orient_model_version;
+  header.wordlength = opt_wordlength;
+  header.dbmask = opt_dbmask;
+  header.sequences = sequences;
+
+  /* header is rewritten with the final kmer count and size */
+
+  if (fwrite(& header, sizeof(header), 1, fp) != 1)
+    {
+      fatal("Unable to write to orientation model file");
+    }
+
+  uint64_t previous = 0;
+  for (uint64_t kmer = 0; kmer < kmerhashsize; kmer++)
+    {
+      if (counts[kmer])
+        {
+          orient_model_putvarint(fp, kmer - previous);
+          orient_model_putvarint(fp, counts[kmer]);
+          previous = kmer;
+          header.kmers++;
+        }
+    }
+
+  header.size = ftell(fp) - sizeof(header);
+
+  if (fseek(fp, 0, SEEK_SET) ||
+      (fwrite(& header, sizeof(header), 1, fp) != 1) ||
+      fclose(fp))
+    {
+      fatal("Unable to write to orientation model file");
+    }
+
+  if (! opt_quiet)
+    {
+      fprintf(stderr,
+              "Orientation model: %" PRIu64 " sequences, %" PRIu64
+              " distinct %" PRId64 "-mers, %" PRIu64 " bytes\n",
+              sequences, header.kmers, opt_wordlength,
+              header.size + sizeof(header));
+    }
+
+  if (opt_log)
+    {
+      fprintf(fp_log,
+              "Orientation model: %" PRIu64 " sequences, %" PRIu64
+              " distinct %" PRId64 "-mers, %" PRIu64 " bytes\n",
+              sequences, header.kmers, opt_wordlength,
+              header.size + sizeof(header));
+    }
+}
+
+static unsigned int * orient_model_read(const char * filename,
+                                        uint64_t * sequences)
+{
+  FILE * fp = fopen_input(filename);
+  if (! fp)
+    {
+      fatal("Unable to open orientation model file for reading");
+    }
+
+  struct orient_model_header_s header;
+  if ((fread(& header, sizeof(header), 1, fp) != 1) ||
+      (memcmp(header.magic, orient_model_magic, 8) != 0))
+    {
+      fatal("Invalid orientation model file");
+    }
+
+  if (header.version != orient_model_version)
+    {
+      fatal("Unsupported orientation model file version");
+    }
+
+  if ((header.wordlength < 3) || (header.wordlength > 15))
+    {
+      fatal("Invalid orientation model file");
+    }
+
+  if ((int64_t) header.wordlength != opt_wordlength)
+    {
+      fprintf(stderr, "\nWARNING: Wordlength adjusted to %u as indicated in orientation model file\n", header.wordlength);
+      opt_wordlength = header.wordlength;
+    }
+
+  * sequences = header.sequences;
+
+  uint64_t kmerhashsize = 1ULL << (2 * opt_wordlength);
+  auto * counts =
+    (unsigned int *) xmalloc(kmerhashsize * sizeof(unsigned int));
+  memset(counts, 0, kmerhashsize * sizeof(unsigned int));
+
+  auto * data = (unsigned char *) xmalloc(header.size + 1);
+  if (fread(data, 1, header.size, fp) != header.size)
+    {
+      fatal("Invalid orientation model file");
+    }
+  fclose(fp);
+
+  unsigned char * p = data;
+  unsigned char * end = data + header.size;
+  uint64_t kmer = 0;
+  for (uint64_t i = 0; i < header.kmers; i++)
+    {
+      kmer += orient_model_getvarint(& p, end);
+      uint64_t count = orient_model_getvarint(& p, end);
+      if ((kmer >= kmerhashsize) || (count > UINT_MAX))
+        {
+          fatal("Invalid orientation model file");
+        }
+      counts[kmer] = (unsigned int) count;
+    }
+
+  xfree(data);
+
+  return counts;
+}
+
+static unsigned int * orient_count_kmers(const char * filename,
+                                         uint64_t * sequences)
+{
+  /*
+    Get the number of database sequences containing each k-mer from an
+    orientation model file, the header of an UDB file, or by counting
+    the k-mers of a FASTA/FASTQ file without building the full index.
+  */
+
+  if (orient_model_detect(filename))
+    {
+      return orient_model_read(filename, sequences);
+    }
+
+  if (udb_detect_isudb(filename))
+    {
+      return udb_read_kmercounts(filename, sequences);
+    }
+
+  /* an index of the database in the cache, or a model saved by orient */
+
+  char * cache_model = nullptr;
+
+  if (opt_index_cache && dbcache_usable(filename))
+    {
+      char * cache_udb = dbcache_entry(filename, true, "udb");
+      cache_model = dbcache_entry(filename, true, "orm");
+      unsigned int * counts = nullptr;
+
+      if (dbcache_exists(cache_udb) && udb_detect_isudb(cache_udb))
+        {
+          counts = udb_read_kmercounts(cache_udb, sequences);
+        }
+      else if (dbcache_exists(cache_model) && orient_model_detect(cache_model))
+        {
+          counts = orient_model_read(cache_model, sequences);
+        }
+
+      xfree(cache_udb);
+      if (counts)
+        {
+          xfree(cache_model);
+          return counts;
+        }
+    }
+
+  db_read(filename, 0);
+
+  if (opt_dbmask == MASK_DUST)
+    {
+      dust_all();
+    }
+  else if ((opt_dbmask == MASK_SOFT) && (opt_hardmask))
+    {
+      hardmask_all();
+    }
+
+  uint64_t kmerhashsize = 1ULL << (2 * opt_wordlength);
+  auto * counts =
+    (unsigned int *) xmalloc(kmerhashsize * sizeof(unsigned int));
+  memset(counts, 0, kmerhashsize * sizeof(unsigned int));
+
+  dbindex_count_kmers(counts, opt_dbmask);
+
+  * sequences = db_getsequencecount();
+
+  if (cache_model)
+    {
+      if (! db_is_fastq())
+        {
+          char * temp = dbcache_tempname(cache_model);
+          FILE * fp = fopen_output(temp);
+          if (fp)
+            {
+              orient_model_write(fp, counts, * sequences);
+              dbcache_commit(temp, cache_model);
+            }
+          else
+            {
+              dbcache_unwritable(temp);
+              xfree(temp);
+            }
+        }
+      xfree(cache_model);
+    }
+
+  db_free();
+
+  return counts;
+}
+
+void orient_makemodel()
+{
+  uint64_t sequences = 0;
+  unsigned int * counts = orient_count_kmers(opt_makeorientmodel, & sequences);
+
+  FILE * fp = fopen_output(opt_output);
+  if (! fp)
+    {
+      fatal("Unable to open orientation model file for writing");
+    }
+
+  orient_model_write(fp, counts, sequences);
+
+  xfree(counts);
+}
+
 void orient()
 {
   fastx_handle query_h;
@@ -156,36 +477,10 @@ void orient()
         }
     }
 
-  /* check if it may be an UDB file */
+  /* get the k-mer counts of the database */
 
-  bool is_udb = udb_detect_isudb(opt_db);
-
-  if (is_udb)
-    {
-      udb_read(opt_db, true, true);
-    }
-  else
-    {
-      db_read(opt_db, 0);
-    }
-
-  if (!is_udb)
-    {
-      if (opt_dbmask == MASK_DUST)
-        {
-          dust_all();
-        }
-      else if ((opt_dbmask == MASK_SOFT) && (opt_hardmask))
-        {
-          hardmask_all();
-        }
-    }
-
-  if (!is_udb)
-    {
-      dbindex_prepare(1, opt_dbmask);
-      dbindex_addallsequences(opt_dbmask);
-    }
+  uint64_t dbsequences = 0;
+  unsigned int * dbcounts = orient_count_kmers(opt_db, & dbsequences);
 
   uhandle_s * uh_fwd = unique_init();
 
@@ -225,8 +520,8 @@ void orient()
           unsigned int kmer_fwd = kmer_list_fwd[i];
           unsigned int kmer_rev = rc_kmer(kmer_fwd);
 
-          unsigned int hits_fwd = dbindex_getmatchcount(kmer_fwd);
-          unsigned int hits_rev = dbindex_getmatchcount(kmer_rev);
+          unsigned int hits_fwd = dbcounts[kmer_fwd];
+          unsigned int hits_rev = dbcounts[kmer_rev];
 
           /* require 8 times as many matches on one stand than the other */
 
@@ -337,11 +632,7 @@ void orient()
 
               if (fastx_is_fastq(query_h))
                 {
-                  for(int i = 0; i < qseqlen; i++)
-                    {
-                      query_qual_rev[i] = query_qual_fwd[qseqlen-1-i];
-                    }
-                  query_qual_rev[qseqlen] = 0;
+                  reverse_string(query_qual_rev, query_qual_fwd, qseqlen);
                 }
 
               fastq_print_general(fp_fastqout,
@@ -425,8 +716,7 @@ void orient()
 
   unique_exit(uh_fwd);
 
-  dbindex_free();
-  db_free();
+  xfree(dbcounts);
 
   if (opt_tabbedout)
     {
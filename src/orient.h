@@ -59,3 +59,4 @@
 */
 
 void orient();
+void orient_makemodel();
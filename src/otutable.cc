@@ -77,15 +77,6 @@
 
 */
 
-#ifndef HAVE_REGEX_H
-const std::regex regex_sample("(^|;)(sample|barcodelabel)=([^;]*)($|;)",
-                              std::regex::extended);
-const std::regex regex_otu("(^|;)otu=([^;]*)($|;)",
-                           std::regex::extended);
-const std::regex regex_tax("(^|;)tax=([^;]*)($|;)",
-                           std::regex::extended);
-#endif
-
 typedef std::set<std::string> string_set_t;
 typedef std::pair<std::string, std::string> string_pair_t;
 typedef std::map<string_pair_t, uint64_t> string_pair_map_t;
@@ -94,12 +85,6 @@ typedef std::map<std::string, uint64_t> string_no_map_t;
 
 struct otutable_s
 {
-#ifdef HAVE_REGEX_H
-  regex_t regex_sample;
-  regex_t regex_otu;
-  regex_t regex_tax;
-#endif
-
   string_set_t otu_set;
   string_set_t sample_set;
   string_pair_map_t sample_otu_count;
@@ -112,40 +97,10 @@ static otutable_s * otutable;
 void otutable_init()
 {
   otutable = new otutable_s;
-
-#ifdef HAVE_REGEX_H
-  /* compile regular expression matchers */
-  if (regcomp(&otutable->regex_sample,
-              "(^|;)(sample|barcodelabel)=([^;]*)($|;)",
-              REG_EXTENDED))
-    {
-      fatal("Compilation of regular expression for sample annotation failed");
-    }
-
-  if (regcomp(&otutable->regex_otu,
-              "(^|;)otu=([^;]*)($|;)",
-              REG_EXTENDED))
-    {
-      fatal("Compilation of regular expression for otu annotation failed");
-    }
-
-  if (regcomp(&otutable->regex_tax,
-              "(^|;)tax=([^;]*)($|;)",
-              REG_EXTENDED))
-    {
-      fatal("Compilation of regular expression for taxonomy annotation failed");
-    }
-#endif
 }
 
 void otutable_done()
 {
-#ifdef HAVE_REGEX_H
-  regfree(&otutable->regex_sample);
-  regfree(&otutable->regex_otu);
-  regfree(&otutable->regex_tax);
-#endif
-
   otutable->otu_set.clear();
   otutable->sample_set.clear();
   otutable->sample_otu_count.clear();
@@ -155,27 +110,41 @@ void otutable_done()
 
 void otutable_add(char * query_header, char * target_header, int64_t abundance)
 {
+  int query_length = strlen(query_header);
+  int target_length = strlen(target_header);
+  int start = 0;
+  int end = 0;
+
   /* read sample annotation in query */
 
   int len_sample;
   char * start_sample = query_header;
 
-#ifdef HAVE_REGEX_H
-  regmatch_t pmatch_sample[5];
-  if (!regexec(&otutable->regex_sample, query_header, 5, pmatch_sample, 0))
+  int barcode_start = 0;
+  int barcode_end = 0;
+  bool sample_found = header_find_field_value(query_header,
+                                              query_length,
+                                              "sample=",
+                                              & start,
+                                              & end);
+  bool barcode_found = header_find_field_value(query_header,
+                                               query_length,
+                                               "barcodelabel=",
+                                               & barcode_start,
+                                               & barcode_end);
+  if (barcode_found && ((! sample_found) || (barcode_start < start)))
     {
-      /* match: use the matching sample name */
-      len_sample = pmatch_sample[3].rm_eo - pmatch_sample[3].rm_so;
-      start_sample += pmatch_sample[3].rm_so;
+      sample_found = true;
+      start = barcode_start;
+      end = barcode_end;
     }
-#else
-  std::cmatch cmatch_sample;
-  if (regex_search(query_header, cmatch_sample, regex_sample))
+
+  if (sample_found)
     {
-      len_sample = cmatch_sample.length(3);
-      start_sample += cmatch_sample.position(3);
+      /* match: use the matching sample name */
+      len_sample = end - start;
+      start_sample += start;
     }
-#endif
   else
     {
       /* no match: use first name in header with A-Za-z0-9_ */
@@ -195,22 +164,13 @@ void otutable_add(char * query_header, char * target_header, int64_t abundance)
   int len_otu;
   char * start_otu = target_header;
 
-#ifdef HAVE_REGEX_H
-  regmatch_t pmatch_otu[4];
-  if (!regexec(&otutable->regex_otu, target_header, 4, pmatch_otu, 0))
+  if (header_find_field_value(target_header, target_length, "otu=",
+                              & start, & end))
     {
       /* match: use the matching otu name */
-      len_otu = pmatch_otu[2].rm_eo - pmatch_otu[2].rm_so;
-      start_otu += pmatch_otu[2].rm_so;
+      len_otu = end - start;
+      start_otu += start;
     }
-#else
-  std::cmatch cmatch_otu;
-  if (regex_search(target_header, cmatch_otu, regex_otu))
-    {
-      len_otu = cmatch_otu.length(2);
-      start_otu += cmatch_otu.position(2);
-    }
-#endif
   else
     {
       /* no match: use first name in header up to ; */
@@ -223,29 +183,13 @@ void otutable_add(char * query_header, char * target_header, int64_t abundance)
 
   /* read tax annotation in target */
 
-#ifdef HAVE_REGEX_H
-  char * start_tax = target_header;
-
-  regmatch_t pmatch_tax[4];
-  if (!regexec(&otutable->regex_tax, target_header, 4, pmatch_tax, 0))
+  if (header_find_field_value(target_header, target_length, "tax=",
+                              & start, & end))
     {
       /* match: use the matching tax name */
-      int len_tax = pmatch_tax[2].rm_eo - pmatch_tax[2].rm_so;
-      start_tax += pmatch_tax[2].rm_so;
-
-      char * tax_name = (char *) xmalloc(len_tax+1);
-      strncpy(tax_name, start_tax, len_tax);
-      tax_name[len_tax] = 0;
-      otutable->otu_tax_map[otu_name] = tax_name;
-      xfree(tax_name);
-    }
-#else
-  std::cmatch cmatch_tax;
-  if (regex_search(target_header, cmatch_tax, regex_tax))
-    {
-      otutable->otu_tax_map[otu_name] = cmatch_tax.str(2);
+      otutable->otu_tax_map[otu_name] =
+        std::string(target_header + start, end - start);
     }
-#endif
 
   /* store data */
 
@@ -102,6 +102,13 @@ void results_show_samheader(FILE * fp,
                             char * cmdline,
                             char * dbname);
 
+/* parts of the SAM header, for databases searched in shards */
+void results_show_samheader_hd(FILE * fp);
+void results_show_samheader_sq(FILE * fp,
+                               char * dbname);
+void results_show_samheader_pg(FILE * fp,
+                               char * cmdline);
+
 void results_show_samout(FILE * fp,
                          struct hit * hits,
                          int hitcount,
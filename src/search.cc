@@ -97,6 +97,11 @@ static FILE * fp_biomout = nullptr;
 
 static int count_matched = 0;
 static int count_notmatched = 0;
+static int count_dbmatched = 0;
+static int count_dbnotmatched = 0;
+
+/* database numbers of the targets in memory after a sharded search */
+static unsigned int * shard_targets = nullptr;
 
 void search_output_results(int hit_count,
                            struct hit * hits,
@@ -133,6 +138,17 @@ void search_output_results(int hit_count,
                           qsequence_rc);
     }
 
+  if (opt_bamout)
+    {
+      bam_write_hits(hits,
+                     toreport,
+                     query_head,
+                     qsequence,
+                     qseqlen,
+                     qsequence_rc,
+                     shard_targets);
+    }
+
   if (toreport)
     {
       double top_hit_id = hits[0].id;
@@ -173,6 +189,8 @@ void search_output_results(int hit_count,
                                       qsequence,
                                       qseqlen,
                                       qsequence_rc,
+                                      shard_targets ?
+                                      shard_targets[hp->target] :
                                       hp->target);
                 }
             }
@@ -282,33 +300,291 @@ void search_output_results(int hit_count,
   xpthread_mutex_unlock(&mutex_output);
 }
 
-int search_query(int64_t t)
+/*
+  Query cache (--query_cache). Identical query sequences, such as the
+  many copies of a read in un-dereplicated input, give the same hits.
+  The hits of each distinct query are kept for the whole run, in a
+  hash table shared by the threads, and copies found there are only
+  masked (for the output) and written with their own label and
+  abundance. The sequences are compared in upper case and with U as
+  T, unless the masking depends on their case (soft masking or hard
+  masking). The abundance is part of the key when the size options
+  depend on it, and --self disables the cache as it uses the labels.
+  Entries are never changed or removed after insertion, so the threads
+  may use them without locks once found; each lock only guards the
+  lists of a part of the table.
+*/
+
+#define QUERYCACHE_LOCKS 256
+
+struct querycache_s
 {
-  for (int s = 0; s < opt_strand; s++)
+  struct querycache_s * next;
+  uint64_t hash;
+  char * sequence;
+  int seqlen;
+  int qsize;
+  int hit_count;
+  struct hit * hits;
+};
+
+static struct querycache_s * * querycache_table = nullptr;
+static uint64_t querycache_size = 0;
+static bool querycache_normalize = false;
+static bool querycache_qsize = false;
+static pthread_mutex_t querycache_mutex[QUERYCACHE_LOCKS];
+
+static void search_cache_init(uint64_t query_file_size)
+{
+  if (opt_self)
     {
-      struct searchinfo_s * si = s ? si_minus+t : si_plus+t;
+      opt_query_cache = false;
+      return;
+    }
+
+  /* about one list per 256 bytes of input */
+  querycache_size = 1024;
+  while (querycache_size < query_file_size / 256)
+    {
+      querycache_size *= 2;
+    }
+
+  querycache_table = (struct querycache_s * *)
+    xmalloc(querycache_size * sizeof(struct querycache_s *));
+  memset(querycache_table, 0,
+         querycache_size * sizeof(struct querycache_s *));
+
+  for(auto & m : querycache_mutex)
+    {
+      xpthread_mutex_init(& m, nullptr);
+    }
 
-      /* mask query */
-      if (opt_qmask == MASK_DUST)
+  querycache_normalize = (opt_qmask == MASK_NONE) ||
+    ((opt_qmask == MASK_DUST) && ! opt_hardmask);
+
+  querycache_qsize = (opt_maxqsize != INT_MAX) ||
+    (opt_minsizeratio != 0.0) ||
+    (opt_maxsizeratio != DBL_MAX);
+}
+
+static void search_cache_exit()
+{
+  if (! querycache_table)
+    {
+      return;
+    }
+
+  for(uint64_t i = 0; i < querycache_size; i++)
+    {
+      struct querycache_s * e = querycache_table[i];
+      while (e)
         {
-          dust(si->qsequence, si->qseqlen);
+          struct querycache_s * next = e->next;
+          for(int j = 0; j < e->hit_count; j++)
+            {
+              if (e->hits[j].aligned)
+                {
+                  xfree(e->hits[j].nwalignment);
+                }
+            }
+          xfree(e->hits);
+          xfree(e->sequence);
+          xfree(e);
+          e = next;
         }
-      else if ((opt_qmask == MASK_SOFT) && (opt_hardmask))
+    }
+
+  for(auto & m : querycache_mutex)
+    {
+      xpthread_mutex_destroy(& m);
+    }
+
+  xfree(querycache_table);
+  querycache_table = nullptr;
+}
+
+static struct querycache_s * search_cache_find(struct querycache_s * e,
+                                               uint64_t hash,
+                                               char * sequence,
+                                               int seqlen,
+                                               int qsize)
+{
+  while (e)
+    {
+      if ((e->hash == hash) &&
+          (e->seqlen == seqlen) &&
+          ((! querycache_qsize) || (e->qsize == qsize)) &&
+          (memcmp(e->sequence, sequence, seqlen) == 0))
         {
-          hardmask(si->qsequence, si->qseqlen);
+          return e;
         }
+      e = e->next;
+    }
+  return nullptr;
+}
+
+static struct querycache_s * search_cache_get(struct querycache_s * query)
+{
+  /*
+    Return the entry for the query, or insert the query and return
+    nullptr if there is none.
+  */
+
+  uint64_t bucket = query->hash & (querycache_size - 1);
+  pthread_mutex_t * mutex = querycache_mutex + bucket % QUERYCACHE_LOCKS;
+
+  xpthread_mutex_lock(mutex);
+  struct querycache_s * e = search_cache_find(querycache_table[bucket],
+                                              query->hash,
+                                              query->sequence,
+                                              query->seqlen,
+                                              query->qsize);
+  xpthread_mutex_unlock(mutex);
+  return e;
+}
+
+static struct querycache_s * search_cache_add(struct querycache_s * query)
+{
+  /*
+    Insert the query with its hits, unless another thread inserted the
+    same query meanwhile. Return the entry in the table.
+  */
+
+  uint64_t bucket = query->hash & (querycache_size - 1);
+  pthread_mutex_t * mutex = querycache_mutex + bucket % QUERYCACHE_LOCKS;
+
+  xpthread_mutex_lock(mutex);
+  struct querycache_s * e = search_cache_find(querycache_table[bucket],
+                                              query->hash,
+                                              query->sequence,
+                                              query->seqlen,
+                                              query->qsize);
+  if (! e)
+    {
+      query->next = querycache_table[bucket];
+      querycache_table[bucket] = query;
+    }
+  xpthread_mutex_unlock(mutex);
+  return e ? e : query;
+}
+
+static struct querycache_s * search_cache_key(struct searchinfo_s * si)
+{
+  /* make a new entry with the key of the query, before masking */
+
+  auto * query = (struct querycache_s *) xmalloc(sizeof(struct querycache_s));
+  query->next = nullptr;
+  query->seqlen = si->qseqlen;
+  query->qsize = si->qsize;
+  query->sequence = (char *) xmalloc(si->qseqlen + 1);
+  if (querycache_normalize)
+    {
+      string_normalize(query->sequence, si->qsequence, si->qseqlen);
+    }
+  else
+    {
+      memcpy(query->sequence, si->qsequence, si->qseqlen + 1);
+    }
+  query->hash = CityHash64(query->sequence, si->qseqlen);
+  query->hit_count = 0;
+  query->hits = nullptr;
+  return query;
+}
 
-      /* perform search */
-      search_onequery(si, opt_qmask);
+static void search_cache_free(struct querycache_s * query)
+{
+  xfree(query->sequence);
+  xfree(query);
+}
+
+static void search_mask_query(struct searchinfo_s * si)
+{
+  if (opt_qmask == MASK_DUST)
+    {
+      dust(si->qsequence, si->qseqlen);
+    }
+  else if ((opt_qmask == MASK_SOFT) && (opt_hardmask))
+    {
+      hardmask(si->qsequence, si->qseqlen);
     }
+}
 
+int search_query(int64_t t)
+{
   struct hit * hits;
   int hit_count;
 
-  search_joinhits(si_plus + t,
-                  opt_strand > 1 ? si_minus + t : nullptr,
-                  & hits,
-                  & hit_count);
+  struct querycache_s * query = nullptr;
+  struct querycache_s * cached = nullptr;
+
+  if (opt_query_cache)
+    {
+      query = search_cache_key(si_plus + t);
+      cached = search_cache_get(query);
+    }
+
+  if (cached)
+    {
+      /* same hits as an earlier copy, mask for the output only */
+      search_cache_free(query);
+      for (int s = 0; s < opt_strand; s++)
+        {
+          search_mask_query(s ? si_minus+t : si_plus+t);
+        }
+      hits = cached->hits;
+      hit_count = cached->hit_count;
+    }
+  else
+    {
+      for (int s = 0; s < opt_strand; s++)
+        {
+          struct searchinfo_s * si = s ? si_minus+t : si_plus+t;
+
+          /* mask query */
+          search_mask_query(si);
+
+          /* perform search */
+          search_onequery(si, opt_qmask);
+        }
+
+      search_joinhits(si_plus + t,
+                      opt_strand > 1 ? si_minus + t : nullptr,
+                      & hits,
+                      & hit_count);
+
+      if (query)
+        {
+          query->hits = hits;
+          query->hit_count = hit_count;
+          cached = search_cache_add(query);
+          if (cached != query)
+            {
+              /* another thread searched the same query meanwhile */
+              for(int i=0; i<hit_count; i++)
+                {
+                  if (hits[i].aligned)
+                    {
+                      xfree(hits[i].nwalignment);
+                    }
+                }
+              xfree(hits);
+              search_cache_free(query);
+              hits = cached->hits;
+              hit_count = cached->hit_count;
+            }
+        }
+    }
+
+  if (opt_hitsout)
+    {
+      hitsout_add(t,
+                  si_plus[t].query_no,
+                  si_plus[t].query_head,
+                  si_plus[t].qseqlen,
+                  hits,
+                  hit_count,
+                  nullptr);
+    }
 
   search_output_results(hit_count,
                         hits,
@@ -318,108 +594,121 @@ int search_query(int64_t t)
                         opt_strand > 1 ? si_minus[t].qsequence : nullptr,
                         si_plus[t].qsize);
 
-  /* free memory for alignment strings */
-  for(int i=0; i<hit_count; i++)
+  if (! cached)
     {
-      if (hits[i].aligned)
+      /* free memory for alignment strings */
+      for(int i=0; i<hit_count; i++)
         {
-          xfree(hits[i].nwalignment);
+          if (hits[i].aligned)
+            {
+              xfree(hits[i].nwalignment);
+            }
         }
-    }
 
-  xfree(hits);
+      xfree(hits);
+    }
 
   return hit_count;
 }
 
-void search_thread_run(int64_t t)
+static bool search_next_query(int64_t t, uint64_t * progress)
 {
-  while (true)
+  /* read the next query into the search info of the thread */
+
+  xpthread_mutex_lock(&mutex_input);
+
+  if (! fasta_next(query_fasta_h,
+                   ! opt_notrunclabels,
+                   chrmap_no_change))
     {
-      xpthread_mutex_lock(&mutex_input);
+      xpthread_mutex_unlock(&mutex_input);
+      return false;
+    }
 
-      if (fasta_next(query_fasta_h,
-                     ! opt_notrunclabels,
-                     chrmap_no_change))
-        {
-          char * qhead = fasta_get_header(query_fasta_h);
-          int query_head_len = fasta_get_header_length(query_fasta_h);
-          char * qseq = fasta_get_sequence(query_fasta_h);
-          int qseqlen = fasta_get_sequence_length(query_fasta_h);
-          int query_no = fasta_get_seqno(query_fasta_h);
-          int qsize = fasta_get_abundance(query_fasta_h);
+  char * qhead = fasta_get_header(query_fasta_h);
+  int query_head_len = fasta_get_header_length(query_fasta_h);
+  char * qseq = fasta_get_sequence(query_fasta_h);
+  int qseqlen = fasta_get_sequence_length(query_fasta_h);
+  int query_no = fasta_get_seqno(query_fasta_h);
+  int qsize = fasta_get_abundance(query_fasta_h);
 
-          for (int s = 0; s < opt_strand; s++)
-            {
-              struct searchinfo_s * si = s ? si_minus+t : si_plus+t;
+  for (int s = 0; s < opt_strand; s++)
+    {
+      struct searchinfo_s * si = s ? si_minus+t : si_plus+t;
 
-              si->query_head_len = query_head_len;
-              si->qseqlen = qseqlen;
-              si->query_no = query_no;
-              si->qsize = qsize;
-              si->strand = s;
+      si->query_head_len = query_head_len;
+      si->qseqlen = qseqlen;
+      si->query_no = query_no;
+      si->qsize = qsize;
+      si->strand = s;
 
-              /* allocate more memory for header and sequence, if necessary */
+      /* allocate more memory for header and sequence, if necessary */
 
-              if (si->query_head_len + 1 > si->query_head_alloc)
-                {
-                  si->query_head_alloc = si->query_head_len + 2001;
-                  si->query_head = (char*)
-                    xrealloc(si->query_head, (size_t)(si->query_head_alloc));
-                }
+      if (si->query_head_len + 1 > si->query_head_alloc)
+        {
+          si->query_head_alloc = si->query_head_len + 2001;
+          si->query_head = (char*)
+            xrealloc(si->query_head, (size_t)(si->query_head_alloc));
+        }
 
-              if (si->qseqlen + 1 > si->seq_alloc)
-                {
-                  si->seq_alloc = si->qseqlen + 2001;
-                  si->qsequence = (char*)
-                    xrealloc(si->qsequence, (size_t)(si->seq_alloc));
-                }
-            }
+      if (si->qseqlen + 1 > si->seq_alloc)
+        {
+          si->seq_alloc = si->qseqlen + 2001;
+          si->qsequence = (char*)
+            xrealloc(si->qsequence, (size_t)(si->seq_alloc));
+        }
+    }
 
-          /* plus strand: copy header and sequence */
-          strcpy(si_plus[t].query_head, qhead);
-          strcpy(si_plus[t].qsequence, qseq);
+  /* plus strand: copy header and sequence */
+  strcpy(si_plus[t].query_head, qhead);
+  strcpy(si_plus[t].qsequence, qseq);
 
-          /* get progress as amount of input file read */
-          uint64_t progress = fasta_get_position(query_fasta_h);
+  /* get progress as amount of input file read */
+  * progress = fasta_get_position(query_fasta_h);
 
-          /* let other threads read input */
-          xpthread_mutex_unlock(&mutex_input);
+  /* let other threads read input */
+  xpthread_mutex_unlock(&mutex_input);
 
-          /* minus strand: copy header and reverse complementary sequence */
-          if (opt_strand > 1)
-            {
-              strcpy(si_minus[t].query_head, si_plus[t].query_head);
-              reverse_complement(si_minus[t].qsequence,
-                                 si_plus[t].qsequence,
-                                 si_plus[t].qseqlen);
-            }
+  /* minus strand: copy header and reverse complementary sequence */
+  if (opt_strand > 1)
+    {
+      strcpy(si_minus[t].query_head, si_plus[t].query_head);
+      reverse_complement(si_minus[t].qsequence,
+                         si_plus[t].qsequence,
+                         si_plus[t].qseqlen);
+    }
 
-          int match = search_query(t);
+  return true;
+}
 
-          /* lock mutex for update of global data and output */
-          xpthread_mutex_lock(&mutex_output);
+static void search_query_done(int qsize, int match, uint64_t progress)
+{
+  /* lock mutex for update of global data and output */
+  xpthread_mutex_lock(&mutex_output);
 
-          /* update stats */
-          queries++;
-          queries_abundance += qsize;
+  /* update stats */
+  queries++;
+  queries_abundance += qsize;
 
-          if (match)
-            {
-              qmatches++;
-              qmatches_abundance += qsize;
-            }
+  if (match)
+    {
+      qmatches++;
+      qmatches_abundance += qsize;
+    }
 
-          /* show progress */
-          progress_update(progress);
+  /* show progress */
+  progress_update(progress);
 
-          xpthread_mutex_unlock(&mutex_output);
-        }
-      else
-        {
-          xpthread_mutex_unlock(&mutex_input);
-          break;
-        }
+  xpthread_mutex_unlock(&mutex_output);
+}
+
+void search_thread_run(int64_t t)
+{
+  uint64_t progress = 0;
+  while (search_next_query(t, & progress))
+    {
+      int match = search_query(t);
+      search_query_done(si_plus[t].qsize, match, progress);
     }
 }
 
@@ -427,7 +716,7 @@ void search_thread_init(struct searchinfo_s * si)
 {
   /* thread specific initialiation */
   si->uh = unique_init();
-  si->kmers = (count_t *) xmalloc(seqcount * sizeof(count_t) + 32);
+  si->kmers = search_kmers_alloc(seqcount);
   si->m = minheap_init(tophits);
   si->hits = (struct hit *) xmalloc
     (sizeof(struct hit) * (tophits) * opt_strand);
@@ -467,7 +756,7 @@ void search_thread_exit(struct searchinfo_s * si)
   unique_exit(si->uh);
   xfree(si->hits);
   minheap_exit(si->m);
-  xfree(si->kmers);
+  xfree_large(si->kmers);
   if (si->query_head)
     {
       xfree(si->query_head);
@@ -483,11 +772,12 @@ void search_thread_exit(struct searchinfo_s * si)
 void * search_thread_worker(void * vp)
 {
   auto t = (int64_t) vp;
+  arch_pin_thread(t);
   search_thread_run(t);
   return nullptr;
 }
 
-void search_thread_worker_run()
+void search_thread_worker_run(void * (*worker)(void *))
 {
   /* initialize threads, start them, join them and return */
 
@@ -503,7 +793,7 @@ void search_thread_worker_run()
           search_thread_init(si_minus+t);
         }
       xpthread_create(pthread+t, &attr,
-                      search_thread_worker, (void*)(int64_t)t);
+                      worker, (void*)(int64_t)t);
     }
 
   /* finish and clean up worker threads */
@@ -522,7 +812,7 @@ void search_thread_worker_run()
 
 
 
-void search_prep(char * cmdline, char * progheader)
+static void search_open_outputs(char * cmdline, char * progheader)
 {
   /* open output files */
 
@@ -628,14 +918,58 @@ void search_prep(char * cmdline, char * progheader)
         }
     }
 
+  if (opt_hitsout)
+    {
+      hitsout_open(opt_hitsout, opt_threads);
+    }
+
+  if (opt_bamout)
+    {
+      bam_open(opt_bamout);
+    }
+
+}
+
+static void search_set_limits(int64_t dbsequences)
+{
+  /* tophits = the maximum number of hits we need to store */
+
+  if ((opt_maxrejects == 0) || (opt_maxrejects > dbsequences))
+    {
+      opt_maxrejects = dbsequences;
+    }
+
+  if ((opt_maxaccepts == 0) || (opt_maxaccepts > dbsequences))
+    {
+      opt_maxaccepts = dbsequences;
+    }
+
+  tophits = opt_maxrejects + opt_maxaccepts + MAXDELAYED;
+
+  if (tophits > dbsequences)
+    {
+      tophits = dbsequences;
+    }
+}
+
+void search_prep(char * cmdline, char * progheader)
+{
+  search_open_outputs(cmdline, progheader);
+
   /* check if it may be an UDB file */
 
   bool is_udb = udb_detect_isudb(opt_db);
+  bool is_cached = false;
 
   if (is_udb)
     {
       udb_read(opt_db, true, true);
     }
+  else if (opt_index_cache && dbcache_read(opt_db, true))
+    {
+      is_udb = true;
+      is_cached = true;
+    }
   else
     {
       db_read(opt_db, 0);
@@ -643,6 +977,13 @@ void search_prep(char * cmdline, char * progheader)
 
   results_show_samheader(fp_samout, cmdline, opt_db);
 
+  if (opt_bamout)
+    {
+      bam_header_begin(cmdline, db_getsequencecount());
+      bam_header_refs(opt_db);
+      bam_header_end();
+    }
+
   if (!is_udb)
     {
       if (opt_dbmask == MASK_DUST)
@@ -663,33 +1004,23 @@ void search_prep(char * cmdline, char * progheader)
     {
       dbindex_prepare(1, opt_dbmask);
       dbindex_addallsequences(opt_dbmask);
+      if (opt_index_cache && ! is_cached)
+        {
+          dbcache_write(opt_db, true);
+        }
     }
 
-  /* tophits = the maximum number of hits we need to store */
-
-  if ((opt_maxrejects == 0) || (opt_maxrejects > seqcount))
-    {
-      opt_maxrejects = seqcount;
-    }
-
-  if ((opt_maxaccepts == 0) || (opt_maxaccepts > seqcount))
-    {
-      opt_maxaccepts = seqcount;
-    }
-
-  tophits = opt_maxrejects + opt_maxaccepts + MAXDELAYED;
-
-  if (tophits > seqcount)
-    {
-      tophits = seqcount;
-    }
+  search_set_limits(seqcount);
 }
 
 void search_done()
 {
-  /* clean up, global */
+  /* clean up, global; the sharded search frees the index of each shard */
 
-  dbindex_free();
+  if (opt_dbshard_size == 0)
+    {
+      dbindex_free();
+    }
   db_free();
 
   if (opt_matched)
@@ -720,6 +1051,10 @@ void search_done()
     {
       fclose(fp_alnout);
     }
+  if (opt_bamout)
+    {
+      bam_close();
+    }
   if (fp_samout)
     {
       fclose(fp_samout);
@@ -727,74 +1062,907 @@ void search_done()
   show_rusage();
 }
 
-void usearch_global(char * cmdline, char * progheader)
+static void search_show_dbmatched(uint64_t seqno, int matched)
 {
-  search_prep(cmdline, progheader);
+  /* write a database sequence to the dbmatched or dbnotmatched file */
 
-  if (opt_dbmatched)
+  if (matched)
     {
-      fp_dbmatched = fopen_output(opt_dbmatched);
-      if (! fp_dbmatched)
+      count_dbmatched++;
+      if (opt_dbmatched)
         {
-          fatal("Unable to open dbmatched output file for writing");
+          fasta_print_general(fp_dbmatched,
+                              nullptr,
+                              db_getsequence(seqno),
+                              db_getsequencelen(seqno),
+                              db_getheader(seqno),
+                              db_getheaderlen(seqno),
+                              matched,
+                              count_dbmatched,
+                              -1.0,
+                              -1, -1, nullptr, 0.0);
         }
     }
-
-  if (opt_dbnotmatched)
+  else
     {
-      fp_dbnotmatched = fopen_output(opt_dbnotmatched);
-      if (! fp_dbnotmatched)
+      count_dbnotmatched++;
+      if (opt_dbnotmatched)
         {
-          fatal("Unable to open dbnotmatched output file for writing");
+          fasta_print_general(fp_dbnotmatched,
+                              nullptr,
+                              db_getsequence(seqno),
+                              db_getsequencelen(seqno),
+                              db_getheader(seqno),
+                              db_getheaderlen(seqno),
+                              db_getabundance(seqno),
+                              count_dbnotmatched,
+                              -1.0,
+                              -1, -1, nullptr, 0.0);
         }
     }
+}
 
-  dbmatched = (int*) xmalloc(seqcount * sizeof(int*));
-  memset(dbmatched, 0, seqcount * sizeof(int*));
+/*
+  Sharded search (--dbshard_size) of a database too large for memory.
+
+  The database is read in shards (see db_shards_open) and all queries
+  are searched against one shard at a time, keeping a compact state
+  for each query between the shards. The first pass over the shards
+  keeps the tophits candidates with most k-mers in common with the
+  query, merged in the order of the min heap, so they are exactly the
+  candidates of a search of the whole database. The second pass aligns
+  the candidates in each shard, skipping those that cannot be reached
+  because enough earlier candidates are known to be accepted or
+  rejected. The accept and reject limits of search_onequery are then
+  replayed on the outcomes, which gives the same hits as a search of
+  the whole database. A last pass keeps the target sequences of the
+  hits in memory, before the results are written in query order.
+*/
 
-  otutable_init();
+#define SHARD_UNKNOWN 0
+#define SHARD_REJECTED 1
+#define SHARD_ACCEPTED 2
 
-  /* prepare reading of queries */
-  qmatches = 0;
-  qmatches_abundance = 0;
-  queries = 0;
-  queries_abundance = 0;
-  query_fasta_h = fasta_open(opt_usearch_global);
+struct shardstrand_s
+{
+  int candidate_count;          /* number of candidates */
+  elem_t * candidates;          /* candidates, best first */
+  unsigned char * outcomes;     /* outcome of each candidate */
+  int hit_count;                /* number of accepted candidates */
+  struct hit * hits;            /* accepted candidates */
+  int * hit_positions;          /* their positions among the candidates */
+};
+
+struct shardquery_s
+{
+  struct shardstrand_s strands[2];
+  int hit_count;                /* number of hits after the replay */
+  struct hit * hits;            /* hits after the replay */
+};
+
+static struct shardquery_s * * shard_queries = nullptr;
+static int shard_queries_count = 0;
+static int shard_queries_alloc = 0;
+static bool shard_is_udb = false;
+static uint64_t shard_first = 0; /* first sequence of the current shard */
+static uint64_t shard_last = 0;  /* first sequence after the current shard */
+
+static struct shardquery_s * search_shard_query(int query_no)
+{
+  /* get the state of a query, it is created when first seen */
 
-  /* allocate memory for thread info */
-  si_plus = (struct searchinfo_s *) xmalloc(opt_threads *
-                                            sizeof(struct searchinfo_s));
-  if (opt_strand > 1)
+  xpthread_mutex_lock(&mutex_input);
+
+  if (query_no >= shard_queries_alloc)
     {
-      si_minus = (struct searchinfo_s *) xmalloc(opt_threads *
-                                                 sizeof(struct searchinfo_s));
+      int old_alloc = shard_queries_alloc;
+      while (query_no >= shard_queries_alloc)
+        {
+          shard_queries_alloc = MAX(1024, 2 * shard_queries_alloc);
+        }
+      shard_queries = (struct shardquery_s * *)
+        xrealloc(shard_queries,
+                 shard_queries_alloc * sizeof(struct shardquery_s *));
+      memset(shard_queries + old_alloc, 0,
+             (shard_queries_alloc - old_alloc) * sizeof(struct shardquery_s *));
     }
-  else
+
+  if (! shard_queries[query_no])
     {
-      si_minus = nullptr;
+      shard_queries[query_no] = (struct shardquery_s *)
+        xmalloc(sizeof(struct shardquery_s));
+      memset(shard_queries[query_no], 0, sizeof(struct shardquery_s));
     }
 
-  pthread = (pthread_t *) xmalloc(opt_threads * sizeof(pthread_t));
+  shard_queries_count = MAX(shard_queries_count, query_no + 1);
 
-  /* init mutexes for input and output */
-  xpthread_mutex_init(&mutex_input, nullptr);
-  xpthread_mutex_init(&mutex_output, nullptr);
+  struct shardquery_s * sq = shard_queries[query_no];
 
-  progress_init("Searching", fasta_get_size(query_fasta_h));
-  search_thread_worker_run();
-  progress_done();
+  xpthread_mutex_unlock(&mutex_input);
 
-  xpthread_mutex_destroy(&mutex_output);
-  xpthread_mutex_destroy(&mutex_input);
+  return sq;
+}
 
-  xfree(pthread);
-  xfree(si_plus);
-  if (si_minus)
-    {
-      xfree(si_minus);
-    }
+static void search_shard_progress(uint64_t progress)
+{
+  xpthread_mutex_lock(&mutex_output);
+  progress_update(progress);
+  xpthread_mutex_unlock(&mutex_output);
+}
 
-  fasta_close(query_fasta_h);
+static void search_shard_candidates(int64_t t)
+{
+  /* merge the best candidates in the shard with those of each query */
+
+  auto * merged = (elem_t *) xmalloc(tophits * sizeof(elem_t));
+  uint64_t progress = 0;
+
+  while (search_next_query(t, & progress))
+    {
+      struct shardquery_s * sq = search_shard_query(si_plus[t].query_no);
+
+      for (int s = 0; s < opt_strand; s++)
+        {
+          struct searchinfo_s * si = s ? si_minus+t : si_plus+t;
+          struct shardstrand_s * ss = sq->strands + s;
+
+          search_mask_query(si);
+
+          dbindex_words(si->uh,
+                        si->qseqlen, si->qsequence,
+                        & si->kmersamplecount, & si->kmersample, opt_qmask);
+
+          search_topscores(si);
+
+          if (! ss->candidates)
+            {
+              ss->candidates = (elem_t *) xmalloc(tophits * sizeof(elem_t));
+            }
+
+          /* merge best first; the best element of the heap is last */
+          int old = 0;
+          int novel = si->m->count - 1;
+          int n = 0;
+          while ((n < tophits) &&
+                 ((old < ss->candidate_count) || (novel >= 0)))
+            {
+              if (novel >= 0)
+                {
+                  elem_t e = si->m->array[novel];
+                  e.seqno += shard_first;
+                  if ((old == ss->candidate_count) ||
+                      (minheap_compare(& e, ss->candidates + old) > 0))
+                    {
+                      merged[n++] = e;
+                      novel--;
+                      continue;
+                    }
+                }
+              merged[n++] = ss->candidates[old++];
+            }
+
+          memcpy(ss->candidates, merged, n * sizeof(elem_t));
+          ss->candidate_count = n;
+        }
+
+      search_shard_progress(progress);
+    }
+
+  xfree(merged);
+}
+
+static void search_shard_keep_hits(struct searchinfo_s * si,
+                                   struct shardstrand_s * ss,
+                                   struct hit * hits,
+                                   int * positions,
+                                   int hit_count,
+                                   int64_t * accepts,
+                                   int64_t * rejects)
+{
+  /* align a batch of candidates and keep the accepted ones */
+
+  search_align_hits(si, hits, hit_count);
+
+  for(int i = 0; i < hit_count; i++)
+    {
+      struct hit * hit = hits + i;
+      if (hit->accepted)
+        {
+          ss->outcomes[positions[i]] = SHARD_ACCEPTED;
+          (* accepts)++;
+
+          hit->target += shard_first;
+          ss->hits = (struct hit *)
+            xrealloc(ss->hits, (ss->hit_count + 1) * sizeof(struct hit));
+          ss->hit_positions = (int *)
+            xrealloc(ss->hit_positions, (ss->hit_count + 1) * sizeof(int));
+          ss->hits[ss->hit_count] = * hit;
+          ss->hit_positions[ss->hit_count] = positions[i];
+          ss->hit_count++;
+        }
+      else
+        {
+          ss->outcomes[positions[i]] = SHARD_REJECTED;
+          (* rejects)++;
+
+          if (hit->nwalignment)
+            {
+              xfree(hit->nwalignment);
+            }
+        }
+    }
+}
+
+static void search_shard_align_strand(struct searchinfo_s * si,
+                                      struct shardstrand_s * ss)
+{
+  /*
+    Find the outcome of the candidates in the shard, in order. The
+    search of a query stops after maxaccepts accepted or maxrejects
+    rejected candidates, and after at most maxaccepts + maxrejects - 1
+    candidates; candidates after that are skipped.
+  */
+
+  struct hit batch[MAXDELAYED];
+  int positions[MAXDELAYED];
+  int batch_count = 0;
+
+  if (! ss->outcomes)
+    {
+      ss->outcomes = (unsigned char *) xmalloc(ss->candidate_count);
+      memset(ss->outcomes, SHARD_UNKNOWN, ss->candidate_count);
+    }
+
+  int64_t accepts = 0;
+  int64_t rejects = 0;
+  int64_t limit = MIN(ss->candidate_count,
+                      opt_maxaccepts + opt_maxrejects - 1);
+
+  for(int p = 0;
+      (p < limit) &&
+        (accepts < opt_maxaccepts) &&
+        (rejects < opt_maxrejects);
+      p++)
+    {
+      if (ss->outcomes[p] == SHARD_ACCEPTED)
+        {
+          accepts++;
+          continue;
+        }
+
+      if (ss->outcomes[p] == SHARD_REJECTED)
+        {
+          rejects++;
+          continue;
+        }
+
+      elem_t * e = ss->candidates + p;
+      if ((e->seqno < shard_first) || (e->seqno >= shard_last))
+        {
+          continue;
+        }
+
+      int target = e->seqno - shard_first;
+
+      /* Test some accept/reject criteria before alignment */
+      if (! search_acceptable_unaligned(si, target))
+        {
+          ss->outcomes[p] = SHARD_REJECTED;
+          rejects++;
+          continue;
+        }
+
+      struct hit * hit = batch + batch_count;
+      hit->target = target;
+      hit->count = e->count;
+      hit->strand = si->strand;
+      hit->rejected = false;
+      hit->accepted = false;
+      hit->aligned = false;
+      hit->weak = false;
+      hit->nwalignment = nullptr;
+      positions[batch_count] = p;
+      batch_count++;
+
+      if (batch_count == MAXDELAYED)
+        {
+          search_shard_keep_hits(si, ss, batch, positions, batch_count,
+                                 & accepts, & rejects);
+          batch_count = 0;
+        }
+    }
+
+  if (batch_count > 0)
+    {
+      search_shard_keep_hits(si, ss, batch, positions, batch_count,
+                             & accepts, & rejects);
+    }
+}
+
+static void search_shard_align(int64_t t)
+{
+  uint64_t progress = 0;
+
+  while (search_next_query(t, & progress))
+    {
+      struct shardquery_s * sq = search_shard_query(si_plus[t].query_no);
+
+      for (int s = 0; s < opt_strand; s++)
+        {
+          struct searchinfo_s * si = s ? si_minus+t : si_plus+t;
+          search_mask_query(si);
+          search_shard_align_strand(si, sq->strands + s);
+        }
+
+      search_shard_progress(progress);
+    }
+}
+
+static void search_shard_replay(struct shardquery_s * sq)
+{
+  /* apply the accept and reject limits as search_onequery does */
+
+  int hit_alloc = 0;
+  for (int s = 0; s < opt_strand; s++)
+    {
+      hit_alloc += sq->strands[s].hit_count;
+    }
+
+  auto * hits = (struct hit *) xmalloc(hit_alloc * sizeof(struct hit));
+  int a = 0;
+
+  for (int s = 0; s < opt_strand; s++)
+    {
+      struct shardstrand_s * ss = sq->strands + s;
+
+      int64_t accepts = 0;
+      int64_t rejects = 0;
+      int64_t limit = MIN(ss->candidate_count,
+                          opt_maxaccepts + opt_maxrejects - 1);
+
+      for(int p = 0;
+          (p < limit) &&
+            (accepts < opt_maxaccepts) &&
+            (rejects < opt_maxrejects);
+          p++)
+        {
+          if (ss->outcomes[p] == SHARD_REJECTED)
+            {
+              rejects++;
+            }
+          else if (ss->outcomes[p] == SHARD_ACCEPTED)
+            {
+              accepts++;
+              int i = 0;
+              while (ss->hit_positions[i] != p)
+                {
+                  i++;
+                }
+              hits[a++] = ss->hits[i];
+              ss->hit_positions[i] = -1;
+            }
+          else
+            {
+              fatal("Internal error in sharded search");
+            }
+        }
+
+      /* free memory for alignment strings of the hits not reached */
+      for(int i = 0; i < ss->hit_count; i++)
+        {
+          if (ss->hit_positions[i] >= 0)
+            {
+              xfree(ss->hits[i].nwalignment);
+            }
+        }
+
+      if (ss->hit_count)
+        {
+          xfree(ss->hits);
+          xfree(ss->hit_positions);
+        }
+      if (ss->candidates)
+        {
+          xfree(ss->candidates);
+        }
+      if (ss->outcomes)
+        {
+          xfree(ss->outcomes);
+        }
+    }
+
+  qsort(hits, a, sizeof(struct hit), hit_compare_byid);
+
+  sq->hits = hits;
+  sq->hit_count = a;
+}
+
+static void * search_shard_candidates_worker(void * vp)
+{
+  auto t = (int64_t) vp;
+  search_shard_candidates(t);
+  return nullptr;
+}
+
+static void * search_shard_align_worker(void * vp)
+{
+  auto t = (int64_t) vp;
+  search_shard_align(t);
+  return nullptr;
+}
+
+static void search_shard_read(uint64_t shard)
+{
+  db_shards_read(shard);
+  shard_first = db_shards_getfirst(shard);
+  shard_last = db_shards_getfirst(shard + 1);
+}
+
+static void search_shard_mask()
+{
+  if (!shard_is_udb)
+    {
+      if (opt_dbmask == MASK_DUST)
+        {
+          dust_all();
+        }
+      else if ((opt_dbmask == MASK_SOFT) && (opt_hardmask))
+        {
+          hardmask_all();
+        }
+    }
+}
+
+static void search_shard_pass(const char * action,
+                              void * (*worker)(void *),
+                              bool index)
+{
+  /* search all queries against each shard in turn */
+
+  uint64_t shards = db_shards_getcount();
+
+  for(uint64_t k = 0; k < shards; k++)
+    {
+      search_shard_read(k);
+      search_shard_mask();
+
+      if (index)
+        {
+          dbindex_prepare(1, opt_dbmask);
+          dbindex_addallsequences(opt_dbmask);
+        }
+
+      char * prompt = nullptr;
+      if (xsprintf(& prompt, "%s shard %" PRIu64 " of %" PRIu64,
+                   action, k + 1, shards) == -1)
+        {
+          fatal("Out of memory");
+        }
+
+      query_fasta_h = fasta_open(opt_usearch_global);
+      progress_init(prompt, fasta_get_size(query_fasta_h));
+      search_thread_worker_run(worker);
+      progress_done();
+      fasta_close(query_fasta_h);
+      xfree(prompt);
+
+      if (index)
+        {
+          dbindex_free();
+        }
+    }
+}
+
+static int search_shard_compare_targets(const void * a, const void * b)
+{
+  unsigned int x = * (unsigned int *) a;
+  unsigned int y = * (unsigned int *) b;
+  if (x < y)
+    {
+      return -1;
+    }
+  else if (x > y)
+    {
+      return +1;
+    }
+  else
+    {
+      return 0;
+    }
+}
+
+static void search_shard_targets(char * cmdline)
+{
+  /*
+    Keep the targets of all hits in memory, as a database of their
+    own, renumbering the hits. Write the SAM header and the dbmatched
+    and dbnotmatched files on the way.
+  */
+
+  int64_t target_count = 0;
+  for(int q = 0; q < shard_queries_count; q++)
+    {
+      if (shard_queries[q])
+        {
+          target_count += shard_queries[q]->hit_count;
+        }
+    }
+
+  auto * targets =
+    (unsigned int *) xmalloc(target_count * sizeof(unsigned int));
+  target_count = 0;
+  for(int q = 0; q < shard_queries_count; q++)
+    {
+      struct shardquery_s * sq = shard_queries[q];
+      for(int i = 0; sq && (i < sq->hit_count); i++)
+        {
+          targets[target_count++] = sq->hits[i].target;
+        }
+    }
+
+  qsort(targets, target_count, sizeof(unsigned int),
+        search_shard_compare_targets);
+
+  int64_t n = 0;
+  for(int64_t i = 0; i < target_count; i++)
+    {
+      if ((i == 0) || (targets[i] != targets[n - 1]))
+        {
+          targets[n++] = targets[i];
+        }
+    }
+
+  /* renumber the hits and count them for each target */
+  dbmatched = (int*) xmalloc(n * sizeof(int));
+  memset(dbmatched, 0, n * sizeof(int));
+
+  for(int q = 0; q < shard_queries_count; q++)
+    {
+      struct shardquery_s * sq = shard_queries[q];
+      for(int i = 0; sq && (i < sq->hit_count); i++)
+        {
+          auto * t = (unsigned int *) bsearch(& sq->hits[i].target,
+                                              targets,
+                                              n,
+                                              sizeof(unsigned int),
+                                              search_shard_compare_targets);
+          sq->hits[i].target = t - targets;
+          dbmatched[sq->hits[i].target]++;
+        }
+    }
+
+  /* copy the targets from the shards */
+  bool samheader = opt_samout && opt_samheader;
+  if (samheader)
+    {
+      results_show_samheader_hd(fp_samout);
+    }
+
+  if (opt_bamout)
+    {
+      bam_header_begin(cmdline, db_shards_getfirst(db_shards_getcount()));
+    }
+
+  auto * kept_index = (seqinfo_t *) xmalloc(n * sizeof(seqinfo_t));
+  char * kept_data = nullptr;
+  uint64_t kept_alloc = 0;
+  uint64_t kept_len = 0;
+  uint64_t nucleotides = 0;
+  uint64_t longest = 0;
+  uint64_t shortest = n ? UINT_MAX : 0;
+  uint64_t longestheader = 0;
+
+  int64_t j = 0;
+  uint64_t shards = db_shards_getcount();
+  for(uint64_t k = 0; k < shards; k++)
+    {
+      search_shard_read(k);
+
+      if (samheader)
+        {
+          results_show_samheader_sq(fp_samout, opt_db);
+        }
+
+      if (opt_bamout)
+        {
+          bam_header_refs(opt_db);
+        }
+
+      search_shard_mask();
+
+      for(uint64_t i = 0; i < db_getsequencecount(); i++)
+        {
+          bool is_target = (j < n) && (targets[j] == shard_first + i);
+
+          if (opt_dbmatched || opt_dbnotmatched)
+            {
+              search_show_dbmatched(i, is_target ? dbmatched[j] : 0);
+            }
+
+          if (is_target)
+            {
+              uint64_t headerlen = db_getheaderlen(i);
+              uint64_t seqlen = db_getsequencelen(i);
+              uint64_t needed = kept_len + headerlen + 1 + seqlen + 1;
+              if (needed > kept_alloc)
+                {
+                  kept_alloc = MAX(needed, 2 * kept_alloc);
+                  kept_data = (char *) xrealloc(kept_data, kept_alloc);
+                }
+
+              seqinfo_t * p = kept_index + j;
+              * p = seqindex[i];
+              p->header_p = kept_len;
+              memcpy(kept_data + kept_len, db_getheader(i), headerlen + 1);
+              kept_len += headerlen + 1;
+              p->seq_p = kept_len;
+              memcpy(kept_data + kept_len, db_getsequence(i), seqlen + 1);
+              kept_len += seqlen + 1;
+              p->qual_p = 0;
+
+              nucleotides += seqlen;
+              longest = MAX(longest, seqlen);
+              shortest = MIN(shortest, seqlen);
+              longestheader = MAX(longestheader, headerlen);
+              j++;
+            }
+        }
+    }
+
+  db_shards_close();
+
+  if (samheader)
+    {
+      results_show_samheader_pg(fp_samout, cmdline);
+    }
+
+  if (opt_bamout)
+    {
+      bam_header_end();
+    }
+
+  /* the targets are now the database */
+  datap = kept_data ? kept_data : (char *) xmalloc(1);
+  seqindex = kept_index;
+  db_setinfo(false, n, nucleotides, longest, shortest, longestheader);
+  seqcount = n;
+
+  /* counted again by search_output_results */
+  memset(dbmatched, 0, n * sizeof(int));
+
+  shard_targets = targets;
+}
+
+static void search_shard_output()
+{
+  /* write the results in the order of the queries */
+
+  search_thread_init(si_plus);
+  if (si_minus)
+    {
+      search_thread_init(si_minus);
+    }
+
+  query_fasta_h = fasta_open(opt_usearch_global);
+  progress_init("Writing results", fasta_get_size(query_fasta_h));
+
+  uint64_t progress = 0;
+  while (search_next_query(0, & progress))
+    {
+      int query_no = si_plus[0].query_no;
+      struct shardquery_s * sq =
+        (query_no < shard_queries_count) ? shard_queries[query_no] : nullptr;
+      int hit_count = sq ? sq->hit_count : 0;
+      struct hit * hits = sq ? sq->hits : nullptr;
+
+      for (int s = 0; s < opt_strand; s++)
+        {
+          search_mask_query(s ? si_minus : si_plus);
+        }
+
+      if (opt_hitsout)
+        {
+          hitsout_add(0,
+                      query_no,
+                      si_plus[0].query_head,
+                      si_plus[0].qseqlen,
+                      hits,
+                      hit_count,
+                      shard_targets);
+        }
+
+      search_output_results(hit_count,
+                            hits,
+                            si_plus[0].query_head,
+                            si_plus[0].qseqlen,
+                            si_plus[0].qsequence,
+                            opt_strand > 1 ? si_minus[0].qsequence : nullptr,
+                            si_plus[0].qsize);
+
+      /* free memory for alignment strings */
+      for(int i = 0; i < hit_count; i++)
+        {
+          if (hits[i].aligned)
+            {
+              xfree(hits[i].nwalignment);
+            }
+        }
+
+      if (sq)
+        {
+          xfree(sq->hits);
+          xfree(sq);
+          shard_queries[query_no] = nullptr;
+        }
+
+      search_query_done(si_plus[0].qsize, hit_count, progress);
+    }
+
+  progress_done();
+  fasta_close(query_fasta_h);
+
+  search_thread_exit(si_plus);
+  if (si_minus)
+    {
+      search_thread_exit(si_minus);
+    }
+
+  if (opt_hitsout)
+    {
+      hitsout_close(shard_targets);
+    }
+
+  if (shard_queries)
+    {
+      xfree(shard_queries);
+    }
+  xfree(shard_targets);
+  shard_targets = nullptr;
+}
+
+static void search_sharded(char * cmdline)
+{
+  /* the queries are read once for each shard in each pass */
+  xstat_t fs;
+  if (xstat(opt_usearch_global, & fs))
+    {
+      fatal("Unable to get status for input file (%s)", opt_usearch_global);
+    }
+  if (S_ISFIFO(fs.st_mode))
+    {
+      fatal("Cannot read queries from a pipe with --dbshard_size");
+    }
+
+  shard_is_udb = udb_detect_isudb(opt_db);
+  db_shards_open(opt_db, opt_dbshard_size << 20);
+
+  uint64_t shards = db_shards_getcount();
+  search_set_limits(db_shards_getfirst(shards));
+
+  /* the k-mer counters of the threads must hold the largest shard */
+  seqcount = 0;
+  for(uint64_t k = 0; k < shards; k++)
+    {
+      seqcount = MAX(seqcount,
+                     (int) (db_shards_getfirst(k + 1) - db_shards_getfirst(k)));
+    }
+
+  search_shard_pass("Searching", search_shard_candidates_worker, true);
+  search_shard_pass("Aligning to", search_shard_align_worker, false);
+
+  for(int q = 0; q < shard_queries_count; q++)
+    {
+      if (shard_queries[q])
+        {
+          search_shard_replay(shard_queries[q]);
+        }
+    }
+
+  search_shard_targets(cmdline);
+  search_shard_output();
+}
+
+void usearch_global(char * cmdline, char * progheader)
+{
+  if (opt_query_cache && (opt_dbshard_size > 0))
+    {
+      fatal("Options --query_cache and --dbshard_size cannot be combined");
+    }
+
+  if ((opt_maxwordfreq < 1.0) && (opt_dbshard_size > 0))
+    {
+      fatal("Options --maxwordfreq and --dbshard_size cannot be combined");
+    }
+
+  if (opt_dbshard_size > 0)
+    {
+      search_open_outputs(cmdline, progheader);
+    }
+  else
+    {
+      search_prep(cmdline, progheader);
+    }
+
+  if (opt_dbmatched)
+    {
+      fp_dbmatched = fopen_output(opt_dbmatched);
+      if (! fp_dbmatched)
+        {
+          fatal("Unable to open dbmatched output file for writing");
+        }
+    }
+
+  if (opt_dbnotmatched)
+    {
+      fp_dbnotmatched = fopen_output(opt_dbnotmatched);
+      if (! fp_dbnotmatched)
+        {
+          fatal("Unable to open dbnotmatched output file for writing");
+        }
+    }
+
+  otutable_init();
+
+  /* prepare reading of queries */
+  qmatches = 0;
+  qmatches_abundance = 0;
+  queries = 0;
+  queries_abundance = 0;
+
+  /* allocate memory for thread info */
+  si_plus = (struct searchinfo_s *) xmalloc(opt_threads *
+                                            sizeof(struct searchinfo_s));
+  if (opt_strand > 1)
+    {
+      si_minus = (struct searchinfo_s *) xmalloc(opt_threads *
+                                                 sizeof(struct searchinfo_s));
+    }
+  else
+    {
+      si_minus = nullptr;
+    }
+
+  pthread = (pthread_t *) xmalloc(opt_threads * sizeof(pthread_t));
+
+  /* init mutexes for input and output */
+  xpthread_mutex_init(&mutex_input, nullptr);
+  xpthread_mutex_init(&mutex_output, nullptr);
+
+  if (opt_dbshard_size > 0)
+    {
+      search_sharded(cmdline);
+    }
+  else
+    {
+      dbmatched = (int*) xmalloc(seqcount * sizeof(int*));
+      memset(dbmatched, 0, seqcount * sizeof(int*));
+
+      query_fasta_h = fasta_open(opt_usearch_global);
+      if (opt_query_cache)
+        {
+          search_cache_init(fasta_get_size(query_fasta_h));
+        }
+      progress_init("Searching", fasta_get_size(query_fasta_h));
+      search_thread_worker_run(search_thread_worker);
+      progress_done();
+      fasta_close(query_fasta_h);
+      search_cache_exit();
+
+      if (opt_hitsout)
+        {
+          hitsout_close(nullptr);
+        }
+    }
+
+  xpthread_mutex_destroy(&mutex_output);
+  xpthread_mutex_destroy(&mutex_input);
+
+  xfree(pthread);
+  xfree(si_plus);
+  if (si_minus)
+    {
+      xfree(si_minus);
+    }
 
   if (!opt_quiet)
     {
@@ -862,47 +2030,11 @@ void usearch_global(char * cmdline, char * progheader)
 
   otutable_done();
 
-  int count_dbmatched = 0;
-  int count_dbnotmatched = 0;
-
-  if (opt_dbmatched || opt_dbnotmatched)
+  if ((opt_dbshard_size == 0) && (opt_dbmatched || opt_dbnotmatched))
     {
       for(int64_t i=0; i<seqcount; i++)
         {
-          if (dbmatched[i])
-            {
-              count_dbmatched++;
-              if (opt_dbmatched)
-                {
-                  fasta_print_general(fp_dbmatched,
-                                      nullptr,
-                                      db_getsequence(i),
-                                      db_getsequencelen(i),
-                                      db_getheader(i),
-                                      db_getheaderlen(i),
-                                      dbmatched[i],
-                                      count_dbmatched,
-                                      -1.0,
-                                      -1, -1, nullptr, 0.0);
-                }
-            }
-          else
-            {
-              count_dbnotmatched++;
-              if (opt_dbnotmatched)
-                {
-                  fasta_print_general(fp_dbnotmatched,
-                                      nullptr,
-                                      db_getsequence(i),
-                                      db_getsequencelen(i),
-                                      db_getheader(i),
-                                      db_getheaderlen(i),
-                                      db_getabundance(i),
-                                      count_dbnotmatched,
-                                      -1.0,
-                                      -1, -1, nullptr, 0.0);
-                }
-            }
+          search_show_dbmatched(i, dbmatched[i]);
         }
     }
 
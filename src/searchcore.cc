@@ -206,28 +206,139 @@ int hit_compare_bysize(const void * a, const void * b)
   return hit_compare_bysize_typed((struct hit *) a, (struct hit *) b);
 }
 
+inline int64_t search_minwordmatches()
+{
+  /*
+    With --minimizer_window w, about 2/(w+1) of the words are sampled,
+    and the number of word matches required is reduced accordingly.
+  */
+
+  if (opt_minimizer_window > 1)
+    {
+      return MAX(1, (2 * opt_minwordmatches + opt_minimizer_window) /
+                 (opt_minimizer_window + 1));
+    }
+  return opt_minwordmatches;
+}
+
 bool search_enough_kmers(struct searchinfo_s * si,
                          unsigned int count)
 {
-  return (count >= opt_minwordmatches) || (count >= si->kmersamplecount);
+  return (count >= search_minwordmatches()) || (count >= si->kmersamplecount);
 }
 
-void search_topscores(struct searchinfo_s * si)
+/*
+  The k-mer hit counts of the targets are kept in counters of 8, 16 or
+  32 bits, the narrowest that can hold the number of unique k-mers of
+  the query, as no target can have more of them in common with it.
+  Most amplicon queries have at most 255 k-mers, and 8 bit counters
+  halve the memory traffic of the counting and double the counters
+  updated per vector by the bitmap kernels, while long queries get 32
+  bit counters that cannot saturate. The array has room for 32 bit
+  counters for all targets, plus the 16 counters the kernels may
+  update beyond the last one.
+*/
+
+void * search_kmers_alloc(unsigned int seqcount)
+{
+  return xmalloc_large((seqcount + 16) * sizeof(unsigned int), false);
+}
+
+inline void search_increment_from_bitmap(unsigned char * counters,
+                                         unsigned char * bitmap,
+                                         unsigned int bits)
+{
+#ifdef __x86_64__
+  if (ssse3_present)
+    {
+      increment_counters8_from_bitmap_ssse3(counters, bitmap, bits);
+    }
+  else
+    {
+      increment_counters8_from_bitmap_sse2(counters, bitmap, bits);
+    }
+#else
+  increment_counters8_from_bitmap(counters, bitmap, bits);
+#endif
+}
+
+inline void search_increment_from_bitmap(count_t * counters,
+                                         unsigned char * bitmap,
+                                         unsigned int bits)
+{
+#ifdef __x86_64__
+  if (ssse3_present)
+    {
+      increment_counters_from_bitmap_ssse3(counters, bitmap, bits);
+    }
+  else
+    {
+      increment_counters_from_bitmap_sse2(counters, bitmap, bits);
+    }
+#else
+  increment_counters_from_bitmap(counters, bitmap, bits);
+#endif
+}
+
+inline void search_increment_from_bitmap(unsigned int * counters,
+                                         unsigned char * bitmap,
+                                         unsigned int bits)
+{
+#ifdef __x86_64__
+  if (ssse3_present)
+    {
+      increment_counters32_from_bitmap_ssse3(counters, bitmap, bits);
+    }
+  else
+    {
+      increment_counters32_from_bitmap_sse2(counters, bitmap, bits);
+    }
+#else
+  increment_counters32_from_bitmap(counters, bitmap, bits);
+#endif
+}
+
+static unsigned int search_parents_count(struct searchinfo_s * si)
 {
   /*
-    Count the kmer hits in each database sequence and
-    make a sorted list of a given number (th)
-    of the database sequences with the highest number of matching kmers.
-    These are stored in the min heap array.
+    With --abskew_prune, count the parents of uchime_denovo that are
+    abundant enough for the query (maxsizeratio, set from abskew). The
+    non-chimeras are indexed in order of decreasing abundance, so these
+    are the first ones in the index.
   */
 
+  unsigned int lo = 0;
+  unsigned int hi = dbindex_getcount();
+  while (lo < hi)
+    {
+      unsigned int mid = lo + (hi - lo) / 2;
+      int64_t tsize = db_getabundance(dbindex_getmapping(mid));
+      if (si->qsize <= opt_maxsizeratio * tsize)
+        {
+          lo = mid + 1;
+        }
+      else
+        {
+          hi = mid;
+        }
+    }
+  return lo;
+}
+
+template <typename counter_t>
+static void search_topscores_count(struct searchinfo_s * si)
+{
+  auto * kmers = (counter_t *) si->kmers;
+
   /* count kmer hits in the database sequences */
-  int indexed_count = dbindex_getcount();
+  unsigned int indexed_count = dbindex_getcount();
+  if (opt_abskew_prune)
+    {
+      indexed_count = search_parents_count(si);
+    }
 
   /* zero counts */
-  memset(si->kmers, 0, indexed_count * sizeof(count_t));
-
-  minheap_empty(si->m);
+  memset(kmers, 0, indexed_count * sizeof(counter_t));
 
   for(unsigned int i=0; i<si->kmersamplecount; i++)
     {
@@ -236,37 +347,41 @@ void search_topscores(struct searchinfo_s * si)
 
       if (bitmap)
         {
-#ifdef __x86_64__
-          if (ssse3_present)
-            {
-              increment_counters_from_bitmap_ssse3(si->kmers,
-                                                   bitmap, indexed_count);
-            }
-          else
-            {
-              increment_counters_from_bitmap_sse2(si->kmers,
-                                                  bitmap, indexed_count);
-            }
-#else
-          increment_counters_from_bitmap(si->kmers, bitmap, indexed_count);
-#endif
+          search_increment_from_bitmap(kmers, bitmap, indexed_count);
         }
       else
         {
           unsigned int * list = dbindex_getmatchlist(kmer);
           unsigned int count = dbindex_getmatchcount(kmer);
+          if (indexed_count < dbindex_getcount())
+            {
+              /* the lists are in increasing index order */
+              unsigned int lo = 0;
+              while (lo < count)
+                {
+                  unsigned int mid = lo + (count - lo) / 2;
+                  if (list[mid] < indexed_count)
+                    {
+                      lo = mid + 1;
+                    }
+                  else
+                    {
+                      count = mid;
+                    }
+                }
+            }
           for(unsigned int j=0; j < count; j++)
             {
-              si->kmers[list[j]]++;
+              kmers[list[j]]++;
             }
         }
     }
 
-  int minmatches = MIN(opt_minwordmatches, si->kmersamplecount);
+  unsigned int minmatches = MIN(search_minwordmatches(), si->kmersamplecount);
 
-  for(int i=0; i < indexed_count; i++)
+  for(unsigned int i=0; i < indexed_count; i++)
     {
-      count_t count = si->kmers[i];
+      unsigned int count = kmers[i];
       if (count >= minmatches)
         {
           unsigned int seqno = dbindex_getmapping(i);
@@ -280,6 +395,32 @@ void search_topscores(struct searchinfo_s * si)
           minheap_add(si->m, & novel);
         }
     }
+}
+
+void search_topscores(struct searchinfo_s * si)
+{
+  /*
+    Count the kmer hits in each database sequence and
+    make a sorted list of a given number (th)
+    of the database sequences with the highest number of matching kmers.
+    These are stored in the min heap array.
+  */
+
+  minheap_empty(si->m);
+
+  if (si->kmersamplecount <= UINT8_MAX)
+    {
+      search_topscores_count<unsigned char>(si);
+    }
+  else if (si->kmersamplecount <= INT16_MAX)
+    {
+      /* the 16 bit kernels saturate at the signed maximum */
+      search_topscores_count<count_t>(si);
+    }
+  else
+    {
+      search_topscores_count<unsigned int>(si);
+    }
 
   minheap_sort(si->m);
 }
@@ -575,6 +716,160 @@ int search_acceptable_aligned(struct searchinfo_s * si,
     }
 }
 
+int64_t search_padpos(char * seq, int64_t seqlen)
+{
+  /*
+    With --idoffset_split, find the padding of a pair of reads joined
+    with at least idoffset N symbols. Return the start of the first such
+    run, or -1 if there is none, or if it is not flanked by sequence.
+  */
+
+  if ((! opt_idoffset_split) || (opt_idoffset == 0))
+    {
+      return -1;
+    }
+
+  int64_t run = 0;
+  for(int64_t i = 0; i < seqlen; i++)
+    {
+      if ((seq[i] == 'N') || (seq[i] == 'n'))
+        {
+          run++;
+          if (run == opt_idoffset)
+            {
+              int64_t start = i + 1 - run;
+              if ((start > 0) && (start + opt_idoffset < seqlen))
+                {
+                  return start;
+                }
+            }
+        }
+      else
+        {
+          run = 0;
+        }
+    }
+  return -1;
+}
+
+void search_align16(struct searchinfo_s * si,
+                    unsigned int sequences,
+                    unsigned int * seqnos,
+                    CELL * pscores,
+                    unsigned short * paligned,
+                    unsigned short * pmatches,
+                    unsigned short * pmismatches,
+                    unsigned short * pgaps,
+                    char * * pcigar)
+{
+  /*
+    Align the query to the given targets with the SIMD aligner, like
+    search16. With --idoffset_split and a padded query, the aligner is
+    told where the paddings of the query and the targets are, and
+    skips the parts of the matrix where one padding has passed the
+    other, without changing the alignments. Once most targets of a
+    batch had to be aligned again over the whole matrix, as for
+    unrelated sequences, the remaining ones are aligned that way at
+    once.
+  */
+
+  if (si->qpadpos < 0)
+    {
+      search16(si->s, sequences, seqnos,
+               pscores, paligned, pmatches, pmismatches, pgaps, pcigar);
+      return;
+    }
+
+  int64_t tpadpos[MAXDELAYED];
+  int64_t qpadpos = si->qpadpos;
+
+  for(unsigned int first = 0; first < sequences; first += MAXDELAYED)
+    {
+      unsigned int count = MIN(sequences - first, MAXDELAYED);
+      unsigned int * list = seqnos + first;
+
+      for(unsigned int i = 0; i < count; i++)
+        {
+          tpadpos[i] = search_padpos(db_getsequence(list[i]),
+                                     db_getsequencelen(list[i]));
+        }
+
+      /* at most one target per channel, so that the channels reach
+         the paddings together */
+      search16_padprep(si->s, qpadpos, opt_idoffset, tpadpos);
+      search16(si->s, count, list,
+               pscores + first, paligned + first, pmatches + first,
+               pmismatches + first, pgaps + first, pcigar + first);
+
+      if (2 * search16_padredone(si->s) > count)
+        {
+          qpadpos = -1;
+        }
+    }
+
+  search16_padprep(si->s, -1, 0, nullptr);
+}
+
+static void search_fill_hit(struct searchinfo_s * si,
+                            struct hit * hit,
+                            int64_t nwscore,
+                            int64_t nwalignmentlength,
+                            int64_t nwmatches,
+                            int64_t nwmismatches,
+                            int64_t nwgaps,
+                            char * nwcigar)
+{
+  /* store the alignment of the query to the target of a hit */
+
+  int64_t target = hit->target;
+  int64_t dseqlen = db_getsequencelen(target);
+
+  if (nwscore == SHRT_MAX)
+    {
+      /* In case the SIMD aligner cannot align,
+         perform a new alignment with the
+         linear memory aligner */
+
+      char * dseq = db_getsequence(target);
+
+      if (nwcigar)
+        {
+          xfree(nwcigar);
+        }
+
+      nwcigar = xstrdup(si->lma->align(si->qsequence,
+                                       dseq,
+                                       si->qseqlen,
+                                       dseqlen));
+
+      si->lma->alignstats(nwcigar,
+                          si->qsequence,
+                          dseq,
+                          & nwscore,
+                          & nwalignmentlength,
+                          & nwmatches,
+                          & nwmismatches,
+                          & nwgaps);
+    }
+
+  hit->aligned = true;
+  hit->shortest = MIN(si->qseqlen, dseqlen);
+  hit->longest = MAX(si->qseqlen, dseqlen);
+  hit->nwalignment = nwcigar;
+  hit->nwscore = nwscore;
+  hit->nwdiff = nwalignmentlength - nwmatches;
+  hit->nwgaps = nwgaps;
+  hit->nwindels = nwalignmentlength - nwmatches - nwmismatches;
+  hit->nwalignmentlength = nwalignmentlength;
+  hit->nwid = 100.0 * (nwalignmentlength - hit->nwdiff) /
+    nwalignmentlength;
+  hit->matches = nwalignmentlength - hit->nwdiff;
+  hit->mismatches = hit->nwdiff - hit->nwindels;
+
+  /* trim alignment and compute numbers excluding terminal gaps */
+  align_trim(hit);
+}
+
 void align_delayed(struct searchinfo_s * si)
 {
   /* compute global alignment */
@@ -600,15 +895,15 @@ void align_delayed(struct searchinfo_s * si)
 
   if (target_count)
     {
-      search16(si->s,
-               target_count,
-               target_list,
-               nwscore_list,
-               nwalignmentlength_list,
-               nwmatches_list,
-               nwmismatches_list,
-               nwgaps_list,
-               nwcigar_list);
+      search_align16(si,
+                     target_count,
+                     target_list,
+                     nwscore_list,
+                     nwalignmentlength_list,
+                     nwmatches_list,
+                     nwmismatches_list,
+                     nwgaps_list,
+                     nwcigar_list);
     }
 
   int i = 0;
@@ -626,69 +921,14 @@ void align_delayed(struct searchinfo_s * si)
             }
           else
             {
-              int64_t target = hit->target;
-              int64_t nwscore = nwscore_list[i];
-
-              char * nwcigar;
-              int64_t nwalignmentlength;
-              int64_t nwmatches;
-              int64_t nwmismatches;
-              int64_t nwgaps;
-
-              int64_t dseqlen = db_getsequencelen(target);
-
-              if (nwscore == SHRT_MAX)
-                {
-                  /* In case the SIMD aligner cannot align,
-                     perform a new alignment with the
-                     linear memory aligner */
-
-                  char * dseq = db_getsequence(target);
-
-                  if (nwcigar_list[i])
-                    {
-                      xfree(nwcigar_list[i]);
-                    }
-
-                  nwcigar = xstrdup(si->lma->align(si->qsequence,
-                                                   dseq,
-                                                   si->qseqlen,
-                                                   dseqlen));
-
-                  si->lma->alignstats(nwcigar,
-                                      si->qsequence,
-                                      dseq,
-                                      & nwscore,
-                                      & nwalignmentlength,
-                                      & nwmatches,
-                                      & nwmismatches,
-                                      & nwgaps);
-                }
-              else
-                {
-                  nwalignmentlength = nwalignmentlength_list[i];
-                  nwmatches = nwmatches_list[i];
-                  nwmismatches = nwmismatches_list[i];
-                  nwgaps = nwgaps_list[i];
-                  nwcigar = nwcigar_list[i];
-                }
-
-              hit->aligned = true;
-              hit->shortest = MIN(si->qseqlen, dseqlen);
-              hit->longest = MAX(si->qseqlen, dseqlen);
-              hit->nwalignment = nwcigar;
-              hit->nwscore = nwscore;
-              hit->nwdiff = nwalignmentlength - nwmatches;
-              hit->nwgaps = nwgaps;
-              hit->nwindels = nwalignmentlength - nwmatches - nwmismatches;
-              hit->nwalignmentlength = nwalignmentlength;
-              hit->nwid = 100.0 * (nwalignmentlength - hit->nwdiff) /
-                nwalignmentlength;
-              hit->matches = nwalignmentlength - hit->nwdiff;
-              hit->mismatches = hit->nwdiff - hit->nwindels;
-
-              /* trim alignment and compute numbers excluding terminal gaps */
-              align_trim(hit);
+              search_fill_hit(si,
+                              hit,
+                              nwscore_list[i],
+                              nwalignmentlength_list[i],
+                              nwmatches_list[i],
+                              nwmismatches_list[i],
+                              nwgaps_list[i],
+                              nwcigar_list[i]);
 
               /* test accept/reject criteria after alignment */
               if (search_acceptable_aligned(si, hit))
@@ -714,10 +954,11 @@ void align_delayed(struct searchinfo_s * si)
   si->finalized = si->hit_count;
 }
 
-void search_onequery(struct searchinfo_s * si, int seqmask)
+static int64_t * search_aligner_init(struct searchinfo_s * si)
 {
-  si->hit_count = 0;
+  /* prepare the aligners for the query, return the LMA score matrix */
 
+  si->qpadpos = search_padpos(si->qsequence, si->qseqlen);
   search16_qprep(si->s, si->qsequence, si->qseqlen);
 
   si->lma = new LinearMemoryAligner;
@@ -738,10 +979,90 @@ void search_onequery(struct searchinfo_s * si, int seqmask)
                           opt_gap_extension_query_right,
                           opt_gap_extension_target_right);
 
+  return scorematrix;
+}
+
+void search_align_hits(struct searchinfo_s * si,
+                       struct hit * hits,
+                       int hit_count)
+{
+  /*
+    Align the query to the targets of up to MAXDELAYED hits and test
+    the accept criteria after alignment on each of them, exactly as
+    align_delayed does, but without the accept and reject limits.
+  */
+
+  unsigned int target_list[MAXDELAYED];
+  CELL  nwscore_list[MAXDELAYED];
+  unsigned short nwalignmentlength_list[MAXDELAYED];
+  unsigned short nwmatches_list[MAXDELAYED];
+  unsigned short nwmismatches_list[MAXDELAYED];
+  unsigned short nwgaps_list[MAXDELAYED];
+  char * nwcigar_list[MAXDELAYED];
+
+  if (hit_count == 0)
+    {
+      return;
+    }
+
+  int64_t * scorematrix = search_aligner_init(si);
+
+  for(int i = 0; i < hit_count; i++)
+    {
+      target_list[i] = hits[i].target;
+    }
+
+  search_align16(si,
+                 hit_count,
+                 target_list,
+                 nwscore_list,
+                 nwalignmentlength_list,
+                 nwmatches_list,
+                 nwmismatches_list,
+                 nwgaps_list,
+                 nwcigar_list);
+
+  for(int i = 0; i < hit_count; i++)
+    {
+      search_fill_hit(si,
+                      hits + i,
+                      nwscore_list[i],
+                      nwalignmentlength_list[i],
+                      nwmatches_list[i],
+                      nwmismatches_list[i],
+                      nwgaps_list[i],
+                      nwcigar_list[i]);
+      search_acceptable_aligned(si, hits + i);
+    }
+
+  delete si->lma;
+  xfree(scorematrix);
+}
+
+void search_onequery(struct searchinfo_s * si, int seqmask)
+{
+  si->hit_count = 0;
+
+  int64_t * scorematrix = search_aligner_init(si);
+
   /* extract unique kmer samples from query*/
-  unique_count(si->uh, opt_wordlength,
-               si->qseqlen, si->qsequence,
-               & si->kmersamplecount, & si->kmersample, seqmask);
+  dbindex_words(si->uh,
+                si->qseqlen, si->qsequence,
+                & si->kmersamplecount, & si->kmersample, seqmask);
+
+  /* ignore the words on the stop list of the index */
+  if (dbindex_stoplist)
+    {
+      unsigned int n = 0;
+      for(unsigned int i = 0; i < si->kmersamplecount; i++)
+        {
+          if (! bitmap_get(dbindex_stoplist, si->kmersample[i]))
+            {
+              si->kmersample[n++] = si->kmersample[i];
+            }
+        }
+      si->kmersamplecount = n;
+    }
 
   /* find database sequences with the most kmer hits */
   search_topscores(si);
@@ -116,7 +116,10 @@ struct hit
   int longest;           /* length of longest of query and target */
 };
 
-/* type of kmer hit counter element remember possibility of overflow */
+/*
+  type of the 16 bit kmer hit counters; 8 and 32 bit counters are used
+  too, depending on the number of kmers in the query
+*/
 typedef unsigned short count_t;
 
 struct searchinfo_s
@@ -132,7 +135,7 @@ struct searchinfo_s
   char * qsequence;             /* query sequence */
   unsigned int kmersamplecount; /* number of kmer samples from query */
   unsigned int * kmersample;    /* list of kmers sampled from query */
-  count_t * kmers;              /* list of kmer counts for each db seq */
+  void * kmers;                 /* list of kmer counts for each db seq */
   struct hit * hits;            /* list of hits */
   int hit_count;                /* number of hits in the above list */
   struct uhandle_s * uh;        /* unique kmer finder instance */
@@ -143,8 +146,12 @@ struct searchinfo_s
   int rejects;                  /* number of rejects */
   minheap_t * m;                /* min heap with the top kmer db seqs */
   int finalized;
+  int qpadpos;                  /* start of query padding, or -1 */
 };
 
+int hit_compare_byid(const void * a, const void * b);
+
+void * search_kmers_alloc(unsigned int seqcount);
 void search_topscores(struct searchinfo_s * si);
 
 void search_onequery(struct searchinfo_s * si, int seqmask);
@@ -155,6 +162,22 @@ struct hit * search_findbest2_byid(struct searchinfo_s * si_p,
 struct hit * search_findbest2_bysize(struct searchinfo_s * si_p,
                                      struct searchinfo_s * si_m);
 
+int64_t search_padpos(char * seq, int64_t seqlen);
+
+void search_align16(struct searchinfo_s * si,
+                    unsigned int sequences,
+                    unsigned int * seqnos,
+                    CELL * pscores,
+                    unsigned short * paligned,
+                    unsigned short * pmatches,
+                    unsigned short * pmismatches,
+                    unsigned short * pgaps,
+                    char * * pcigar);
+
+void search_align_hits(struct searchinfo_s * si,
+                       struct hit * hits,
+                       int hit_count);
+
 int search_acceptable_unaligned(struct searchinfo_s * si, int target);
 
 int search_acceptable_aligned(struct searchinfo_s * si,
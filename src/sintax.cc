@@ -353,6 +353,10 @@ void sintax_query(int64_t t)
 
   bitmap_t * b = bitmap_init(qseqlen);
 
+  /* the bootstraps of each query use their own random stream */
+  struct random_s rs;
+  random_stream(& rs, (uint64_t) si_plus[t].query_no + 1);
+
   for (int s = 0; s < opt_strand; s++)
     {
       struct searchinfo_s * si = s ? si_minus+t : si_plus+t;
@@ -363,9 +367,9 @@ void sintax_query(int64_t t)
       unsigned int * kmersample;
 
       /* find unique kmers */
-      unique_count(si->uh, opt_wordlength,
-                   si->qseqlen, si->qsequence,
-                   & kmersamplecount, & kmersample, MASK_NONE);
+      dbindex_words(si->uh,
+                    si->qseqlen, si->qsequence,
+                    & kmersamplecount, & kmersample, MASK_NONE);
 
       /* perform 100 bootstraps */
 
@@ -379,7 +383,7 @@ void sintax_query(int64_t t)
               bitmap_reset_all(b);
               for(int j = 0; j < subset_size ; j++)
                 {
-                  int64_t x = random_int(kmersamplecount);
+                  uint64_t x = random_ulong_r(& rs, kmersamplecount);
                   if (! bitmap_get(b, x))
                     {
                       kmersample_subset[subsamples++] = kmersample[x];
@@ -532,7 +536,7 @@ void sintax_thread_init(struct searchinfo_s * si)
 {
   /* thread specific initialiation */
   si->uh = unique_init();
-  si->kmers = (count_t *) xmalloc(seqcount * sizeof(count_t) + 32);
+  si->kmers = search_kmers_alloc(seqcount);
   si->m = minheap_init(tophits);
   si->hits = nullptr;
   si->qsize = 1;
@@ -549,7 +553,7 @@ void sintax_thread_exit(struct searchinfo_s * si)
   /* thread specific clean up */
   unique_exit(si->uh);
   minheap_exit(si->m);
-  xfree(si->kmers);
+  xfree_large(si->kmers);
   if (si->query_head)
     {
       xfree(si->query_head);
@@ -563,6 +567,7 @@ void sintax_thread_exit(struct searchinfo_s * si)
 void * sintax_thread_worker(void * vp)
 {
   auto t = (int64_t) vp;
+  arch_pin_thread(t);
   sintax_thread_run(t);
   return nullptr;
 }
@@ -634,6 +639,10 @@ void sintax()
     {
       udb_read(opt_db, true, true);
     }
+  else if (opt_index_cache && dbcache_read(opt_db, false))
+    {
+      is_udb = true;
+    }
   else
     {
       db_read(opt_db, 0);
@@ -645,6 +654,10 @@ void sintax()
     {
       dbindex_prepare(1, opt_dbmask);
       dbindex_addallsequences(opt_dbmask);
+      if (opt_index_cache)
+        {
+          dbcache_write(opt_db, false);
+        }
     }
 
   /* prepare reading of queries */
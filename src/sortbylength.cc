@@ -180,6 +180,13 @@ void sortbylength()
 
   passed = MIN(passed, opt_topn);
 
+  digest_prefetch_init();
+  for(int i=0; i<passed; i++)
+    {
+      digest_prefetch_add(db_getsequence(sortinfo[i].seqno),
+                          db_getsequencelen(sortinfo[i].seqno));
+    }
+
   progress_init("Writing output", passed);
   for(int i=0; i<passed; i++)
     {
@@ -187,6 +194,7 @@ void sortbylength()
       progress_update(i);
     }
   progress_done();
+  digest_prefetch_exit();
   show_rusage();
 
   xfree(sortinfo);
@@ -179,6 +179,13 @@ void sortbysize()
 
   passed = MIN(passed, opt_topn);
 
+  digest_prefetch_init();
+  for(int i=0; i<passed; i++)
+    {
+      digest_prefetch_add(db_getsequence(sortinfo[i].seqno),
+                          db_getsequencelen(sortinfo[i].seqno));
+    }
+
   progress_init("Writing output", passed);
   for(int i=0; i<passed; i++)
     {
@@ -186,6 +193,7 @@ void sortbysize()
       progress_update(i);
     }
   progress_done();
+  digest_prefetch_exit();
   show_rusage();
 
   xfree(sortinfo);
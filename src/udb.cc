@@ -154,6 +154,56 @@ uint64_t largewrite(int fd, void * buf, uint64_t nbyte, uint64_t offset)
   return nbyte;
 }
 
+static bool udb_valid_header(unsigned int * buffer)
+{
+  /* check the magic numbers and limits of the 50 word UDB header */
+
+  return ((buffer[0] == 0x55444246) &&
+          (buffer[2] == 32) &&
+          (buffer[4] >= 3) &&
+          (buffer[4] <= 15) &&
+          (buffer[13] != 0) &&
+          (buffer[17] == 0x0000746e) &&
+          (buffer[49] == 0x55444266));
+}
+
+/*
+  UDB files written with a stop list (--maxwordfreq) have the frequency
+  cutoff in parts per million in word 20 of the header and the number
+  of k-mers on the list in word 21. The lists of these k-mers are left
+  out, and the k-mers follow the sequences as a last section, after
+  the signature 0x55444235 (5BDU).
+
+  Word 22 is the window of the minimizers (--minimizer_window) in
+  files that only index these, and 0 otherwise.
+*/
+
+static void udb_minimizer_window(unsigned int * header)
+{
+  /*
+    The queries must be sampled as the indexed sequences. The window is
+    -1 when --minimizer_window was not given, then the one of the file
+    is used without a warning.
+  */
+
+  if ((opt_minimizer_window >= 0) && (header[22] != opt_minimizer_window))
+    {
+      fprintf(stderr, "\nWARNING: Minimizer window adjusted to %u as indicated in UDB file\n", header[22]);
+    }
+  opt_minimizer_window = header[22];
+}
+
+static uint64_t udb_stoplist_size(unsigned int * header)
+{
+  /* size in bytes of the stop list section */
+
+  if (header[20] == 0)
+    {
+      return 0;
+    }
+  return 4 * (1 + (uint64_t) header[21]);
+}
+
 bool udb_detect_isudb(const char * filename)
 {
   /*
@@ -213,13 +263,7 @@ void udb_info()
       fatal("Unable to read from UDB file or invalid UDB file");
     }
 
-  if ((buffer[0]  != 0x55444246) ||
-      (buffer[2] != 32) ||
-      (buffer[4] < 3) ||
-      (buffer[4] > 15) ||
-      (buffer[13] == 0) ||
-      (buffer[17] != 0x0000746e) ||
-      (buffer[49] != 0x55444266))
+  if (! udb_valid_header(buffer))
     {
       fatal("Invalid UDB file");
     }
@@ -236,6 +280,15 @@ void udb_info()
               (1 << (2 * buffer[4])) * 1.0 / 1000.0);
       fprintf(stderr, "         DBstep  %u\n", buffer[5]);
       fprintf(stderr, "        DBAccel  %u%%\n", buffer[6]);
+      if (buffer[20])
+        {
+          fprintf(stderr, "      Stop list  %u (%.4g%%)\n",
+                  buffer[21], buffer[20] / 10000.0);
+        }
+      if (buffer[22])
+        {
+          fprintf(stderr, "     Minimizers  window %u\n", buffer[22]);
+        }
     }
 
   if (opt_log)
@@ -250,6 +303,15 @@ void udb_info()
               (1 << (2 * buffer[4])) * 1.0 / 1000.0);
       fprintf(fp_log, "         DBstep  %u\n", buffer[5]);
       fprintf(fp_log, "        DBAccel  %u%%\n", buffer[6]);
+      if (buffer[20])
+        {
+          fprintf(fp_log, "      Stop list  %u (%.4g%%)\n",
+                  buffer[21], buffer[20] / 10000.0);
+        }
+      if (buffer[22])
+        {
+          fprintf(fp_log, "     Minimizers  window %u\n", buffer[22]);
+        }
     }
 
   close(fd_udbinfo);
@@ -306,13 +368,7 @@ void udb_read(const char * filename,
 
   pos += largeread(fd_udb, buffer, 4 * 50, pos);
 
-  if ((buffer[0]  != 0x55444246) ||
-      (buffer[2] != 32) ||
-      (buffer[4] < 3) ||
-      (buffer[4] > 15) ||
-      (buffer[13] == 0) ||
-      (buffer[17] != 0x0000746e) ||
-      (buffer[49] != 0x55444266))
+  if (! udb_valid_header(buffer))
     {
       fatal("Invalid UDB file");
     }
@@ -320,6 +376,9 @@ void udb_read(const char * filename,
   udb_wordlength = buffer[4];
   seqcount = buffer[13];
   udb_dbaccel = buffer[6];
+  unsigned int stop_ppm = buffer[20];
+  unsigned int stop_count = buffer[21];
+  uint64_t stoplist_size = udb_stoplist_size(buffer);
 
   if (udb_wordlength != opt_wordlength)
     {
@@ -327,11 +386,14 @@ void udb_read(const char * filename,
       opt_wordlength = udb_wordlength;
     }
 
+  udb_minimizer_window(buffer);
+
   /* word match counts */
 
   kmerhashsize = 1 << (2 * udb_wordlength);
-  kmercount = (unsigned int*) xmalloc(kmerhashsize * sizeof(unsigned int));
-  kmerhash = (uint64_t *) xmalloc(kmerhashsize * sizeof(uint64_t));
+  kmercount = (unsigned int*)
+    xmalloc_large(kmerhashsize * sizeof(unsigned int), true);
+  kmerhash = (uint64_t *) xmalloc_large(kmerhashsize * sizeof(uint64_t), true);
   kmerbitmap = (bitmap_t * *) xmalloc(kmerhashsize * sizeof(bitmap_t**));
 
   memset(kmerbitmap, 0, kmerhashsize * sizeof(bitmap_t**));
@@ -356,7 +418,7 @@ void udb_read(const char * filename,
 
   /* sequence numbers for word matches */
 
-  kmerindex = (unsigned int *) xmalloc(kmerindexsize * 4);
+  kmerindex = (unsigned int *) xmalloc_large(kmerindexsize * 4, true);
 
   pos += largeread(fd_udb, kmerindex, 4 * kmerindexsize, pos);
 
@@ -414,6 +476,9 @@ void udb_read(const char * filename,
         {
           longestheader = seqindex[i].headerlen;
         }
+      header_scan_attributes(datap + seqindex[i].header_p,
+                             seqindex[i].headerlen,
+                             & seqindex[i].attributes);
     }
 
   /* sequence lengths */
@@ -463,6 +528,33 @@ void udb_read(const char * filename,
 
   pos += largeread(fd_udb, datap + udb_headerchars, nucleotides, pos);
 
+  /* stop list */
+
+  if (stop_ppm)
+    {
+      if (pos + stoplist_size != filesize)
+        {
+          fatal("Incorrect UDB file size");
+        }
+
+      auto * stopwords = (unsigned int *) xmalloc(stoplist_size);
+      pos += largeread(fd_udb, stopwords, stoplist_size, pos);
+      if (stopwords[0] != 0x55444235)
+        {
+          fatal("Invalid UDB file");
+        }
+      for(unsigned int i = 1; i <= stop_count; i++)
+        {
+          if (stopwords[i] >= kmerhashsize)
+            {
+              fatal("Invalid UDB file");
+            }
+          dbindex_stoplist_add(stopwords[i]);
+        }
+      dbindex_stop_ppm = stop_ppm;
+      xfree(stopwords);
+    }
+
   if (pos != filesize)
     {
       fatal("Incorrect UDB file size");
@@ -491,6 +583,10 @@ void udb_read(const char * filename,
   *(datap + seqindex[0].seq_p + seqindex[0].seqlen) = 0;
   progress_done();
 
+  /* remove the words on the stop list from the index */
+
+  dbindex_stoplist_apply(seqcount);
+
   /* Create bitmaps for the most frequent words */
 
   if (create_bitmaps)
@@ -520,8 +616,9 @@ void udb_read(const char * filename,
       progress_init("Parsing abundances", seqcount);
       for(unsigned int i = 0; i < seqcount; i++)
         {
-          int64_t size = header_get_size(datap + seqindex[i].header_p,
-                                         seqindex[i].headerlen);
+          int64_t size =
+            header_get_size_attributes(datap + seqindex[i].header_p,
+                                       & seqindex[i].attributes);
           if (size > 0)
             {
               seqindex[i].size = size;
@@ -601,6 +698,12 @@ void udb_read(const char * filename,
                   db_getsequencecount());
         }
     }
+
+  dbindex_stoplist_report();
+
+  arch_large_report("K-mer index",
+                    kmerhashsize * (sizeof(unsigned int) + sizeof(uint64_t))
+                    + kmerindexsize * sizeof(unsigned int));
 }
 
 void udb_fasta()
@@ -865,37 +968,89 @@ void udb_stats()
   db_free();
 }
 
-void udb_make()
+static char * udb_header_resize(char * header,
+                               int header_length,
+                               int64_t abundance,
+                               unsigned int * length)
 {
-  int fd_output = 0;
-
-  fd_output = xopen_write(opt_output);
-  if (!fd_output)
-    {
-      fatal("Unable to open output file for writing");
-    }
+  /*
+    Return a copy of the header with the size annotation replaced. The
+    attribute is removed together with one of the semicolons around it,
+    so that a header starting with size= does not get a leading
+    semicolon.
+  */
 
-  db_read(opt_makeudb_usearch, 1);
+  char * copy = (char *) xmalloc(header_length + 32);
+  int start = 0;
+  int end = 0;
+  int len = 0;
 
-  if (opt_dbmask == MASK_DUST)
+  if (header_find_attribute(header, header_length, "size=",
+                            & start, & end, false))
     {
-      dust_all();
+      if (start > 1)
+        {
+          /* the part in front, without the semicolon before size= */
+          memcpy(copy, header, start - 1);
+          len = start - 1;
+        }
+      if (header_length > end + 1)
+        {
+          /* the part after, with the semicolon after size= if needed */
+          int skip = (len > 0) ? 0 : 1;
+          memcpy(copy + len, header + end + skip, header_length - end - skip);
+          len += header_length - end - skip;
+        }
     }
-  else if ((opt_dbmask == MASK_SOFT) && (opt_hardmask))
+  else
     {
-      hardmask_all();
+      memcpy(copy, header, header_length);
+      len = header_length;
     }
 
-  dbindex_prepare(1, opt_dbmask);
-  dbindex_addallsequences(opt_dbmask);
+  len += sprintf(copy + len, "%ssize=%" PRId64,
+                 len > 0 ? ";" : "", abundance);
+  * length = len;
+  return copy;
+}
 
-  unsigned int seqcount = db_getsequencecount();
-  uint64_t ntcount = db_getnucleotidecount();
+void udb_write(int fd_output, int64_t * abundances)
+{
+  /*
+    Write the sequences in the k-mer index (in index order) to an UDB
+    file. If abundances is given (one per index element), the size
+    annotation in the headers is updated accordingly.
+  */
+
+  unsigned int seqcount = dbindex_getcount();
+
+  char * * headers = nullptr;
+  unsigned int * headerlens = (unsigned int *) xmalloc
+    ((seqcount + 1) * sizeof(unsigned int));
 
+  if (abundances)
+    {
+      headers = (char * *) xmalloc((seqcount + 1) * sizeof(char *));
+    }
+
+  uint64_t ntcount = 0;
   uint64_t header_characters = 0;
   for (unsigned int i=0; i<seqcount; i++)
     {
-      header_characters += db_getheaderlen(i) + 1;
+      unsigned int seqno = dbindex_getmapping(i);
+      if (abundances)
+        {
+          headers[i] = udb_header_resize(db_getheader(seqno),
+                                         db_getheaderlen(seqno),
+                                         abundances[i],
+                                         headerlens + i);
+        }
+      else
+        {
+          headerlens[i] = db_getheaderlen(seqno);
+        }
+      header_characters += headerlens[i] + 1;
+      ntcount += db_getsequencelen(seqno);
     }
 
   uint64_t kmerhashsize = 1 << (2 * opt_wordlength);
@@ -919,6 +1074,11 @@ void udb_make()
     4 * seqcount +
     ntcount;
 
+  if (dbindex_stoplist)
+    {
+      progress_all += 4 * (1 + (uint64_t) dbindex_stopcount);
+    }
+
   progress_init("Writing UDB file", progress_all);
 
   uint64_t buffersize = 4 * MAX(50, seqcount);
@@ -934,6 +1094,15 @@ void udb_make()
   buffer[11] = 0; /* slots */
   buffer[13] = (unsigned int) seqcount; /* number of sequences */
   buffer[17] = 0x0000746e; /* alphabet: "nt" */
+  if (dbindex_stoplist)
+    {
+      buffer[20] = dbindex_stop_ppm; /* stop list cutoff, ppm */
+      buffer[21] = dbindex_stopcount; /* stop list size */
+    }
+  if (opt_minimizer_window > 1)
+    {
+      buffer[22] = opt_minimizer_window; /* minimizer window */
+    }
   buffer[49] = 0x55444266; /* fBDU UDBf */
   pos += largewrite(fd_output, buffer, 50 * 4, 0);
 
@@ -993,29 +1162,381 @@ void udb_make()
   for (unsigned int i = 0; i < seqcount; i++)
     {
       buffer[i] = sum;
-      sum += db_getheaderlen(i) + 1;
+      sum += headerlens[i] + 1;
     }
   pos += largewrite(fd_output, buffer, 4 * seqcount, pos);
 
   /* headers (ascii, zero terminated, not padded) */
   for (unsigned int i = 0; i < seqcount; i++)
     {
-      unsigned int len = db_getheaderlen(i);
-      pos += largewrite(fd_output, db_getheader(i), len + 1, pos);
+      unsigned int len = headerlens[i];
+      if (abundances)
+        {
+          pos += largewrite(fd_output, headers[i], len + 1, pos);
+          xfree(headers[i]);
+        }
+      else
+        {
+          pos += largewrite(fd_output,
+                            db_getheader(dbindex_getmapping(i)),
+                            len + 1,
+                            pos);
+        }
     }
 
   /* sequence lengths (uint32) */
   for (unsigned int i = 0; i < seqcount; i++)
     {
-      buffer[i] = db_getsequencelen(i);
+      buffer[i] = db_getsequencelen(dbindex_getmapping(i));
     }
   pos += largewrite(fd_output, buffer, 4 * seqcount, pos);
 
   /* sequences (ascii, no term, no pad) */
   for (unsigned int i = 0; i < seqcount; i++)
     {
-      unsigned int len = db_getsequencelen(i);
-      pos += largewrite(fd_output, db_getsequence(i), len, pos);
+      unsigned int seqno = dbindex_getmapping(i);
+      unsigned int len = db_getsequencelen(seqno);
+      pos += largewrite(fd_output, db_getsequence(seqno), len, pos);
+    }
+
+  /* stop list (uint32) */
+  if (dbindex_stoplist)
+    {
+      auto * stopwords = (unsigned int *)
+        xmalloc(4 * (1 + (uint64_t) dbindex_stopcount));
+      unsigned int n = 0;
+      stopwords[n++] = 0x55444235; /* 5BDU UDB5 */
+      for(unsigned int i = 0; i < kmerhashsize; i++)
+        {
+          if (dbindex_stopped(i))
+            {
+              stopwords[n++] = i;
+            }
+        }
+      pos += largewrite(fd_output, stopwords, 4 * (uint64_t) n, pos);
+      xfree(stopwords);
+    }
+
+  if (close(fd_output) != 0)
+    {
+      fatal("Unable to close UDB file");
+    }
+
+  progress_done();
+  xfree(buffer);
+  xfree(headerlens);
+  if (headers)
+    {
+      xfree(headers);
+    }
+}
+
+static void udb_read_exact(int fd, void * buf, uint64_t nbyte, uint64_t offset)
+{
+  /* read a section of an UDB file without updating the progress */
+
+  if (xlseek(fd, offset, SEEK_SET) != offset)
+    {
+      fatal("Unable to seek in UDB file or invalid UDB file");
+    }
+
+  uint64_t done = 0;
+  while (done < nbyte)
+    {
+      int64_t res = read(fd, ((char*)buf) + done, MIN(BLOCKSIZE, nbyte - done));
+      if (res <= 0)
+        {
+          fatal("Unable to read from UDB file or invalid UDB file");
+        }
+      done += res;
+    }
+}
+
+static uint64_t udb_copy(int fd_input,
+                         uint64_t input_offset,
+                         int fd_output,
+                         uint64_t output_offset,
+                         uint64_t nbyte,
+                         char * buffer)
+{
+  /* copy a section of the old UDB file unchanged to the new one */
+
+  for(uint64_t i = 0; i < nbyte; i += BLOCKSIZE)
+    {
+      uint64_t rem = MIN(BLOCKSIZE, nbyte - i);
+      udb_read_exact(fd_input, buffer, rem, input_offset + i);
+      largewrite(fd_output, buffer, rem, output_offset + i);
+    }
+  return nbyte;
+}
+
+static int udb_append_open(unsigned int * header)
+{
+  /* open the UDB file to append to and read its header */
+
+  int fd_udb = xopen_read(opt_udb_append);
+  if (fd_udb < 0)
+    {
+      fatal("Unable to open UDB file for reading (%s)", opt_udb_append);
+    }
+
+  udb_read_exact(fd_udb, header, 4 * 50, 0);
+
+  if (! udb_valid_header(header))
+    {
+      fatal("Invalid UDB file");
+    }
+
+  if (header[20] || (opt_maxwordfreq < 1.0))
+    {
+      fatal("Cannot append to UDB files with a stop list (--maxwordfreq)");
+    }
+
+  if (header[4] != opt_wordlength)
+    {
+      fprintf(stderr, "\nWARNING: Wordlength adjusted to %u as indicated in UDB file\n", header[4]);
+      opt_wordlength = header[4];
+    }
+
+  udb_minimizer_window(header);
+
+  return fd_udb;
+}
+
+static void udb_append(int fd_udb, unsigned int * header, int fd_output)
+{
+  /*
+    Write a new UDB file with the sequences of the old one (fd_udb)
+    followed by the sequences in the k-mer index. The sections of the
+    old file are copied as they are, only the new sequences have been
+    indexed. The word lists are merged by appending the new sequence
+    numbers, offset by the old sequence count, to the old lists.
+  */
+
+  xstat_t fs;
+  if (xfstat(fd_udb, & fs))
+    {
+      fatal("Unable to get status for input file (%s)", opt_udb_append);
+    }
+  uint64_t filesize = fs.st_size;
+
+  uint64_t kmerhashsize = 1 << (2 * opt_wordlength);
+
+  /* word match counts and total word matches of the old file */
+
+  auto * old_kmercount = (unsigned int *) xmalloc(4 * kmerhashsize);
+  udb_read_exact(fd_udb, old_kmercount, 4 * kmerhashsize, 4 * 50);
+
+  uint64_t old_wordmatches = 0;
+  uint64_t new_wordmatches = 0;
+  for(uint64_t i = 0; i < kmerhashsize; i++)
+    {
+      old_wordmatches += old_kmercount[i];
+      new_wordmatches += kmercount[i];
+    }
+
+  unsigned int buffer[8];
+  uint64_t old_words_p = 4 * 50 + 4 * kmerhashsize;
+  udb_read_exact(fd_udb, buffer, 4, old_words_p);
+  if (buffer[0] != 0x55444233)
+    {
+      fatal("Invalid UDB file");
+    }
+  old_words_p += 4;
+
+  /* second header of the old file */
+
+  uint64_t old_header2_p = old_words_p + 4 * old_wordmatches;
+  if (old_header2_p + 4 * 8 > filesize)
+    {
+      fatal("Invalid UDB file");
+    }
+  udb_read_exact(fd_udb, buffer, 4 * 8, old_header2_p);
+
+  unsigned int old_seqcount = header[13];
+  if ((buffer[0] != 0x55444234) ||
+      (buffer[1] != 0x005e0db3) ||
+      (buffer[2] != old_seqcount) ||
+      (buffer[7] != 0x005e0db4))
+    {
+      fatal("Invalid UDB file");
+    }
+
+  uint64_t old_ntcount = (((uint64_t) buffer[4]) << 32) | buffer[3];
+  uint64_t old_header_characters = (((uint64_t) buffer[6]) << 32) | buffer[5];
+
+  uint64_t old_headerindex_p = old_header2_p + 4 * 8;
+  uint64_t old_headers_p = old_headerindex_p + 4 * old_seqcount;
+  uint64_t old_lengths_p = old_headers_p + old_header_characters;
+  uint64_t old_sequences_p = old_lengths_p + 4 * old_seqcount;
+
+  if (old_sequences_p + old_ntcount != filesize)
+    {
+      fatal("Incorrect UDB file size");
+    }
+
+  /* the new sequences */
+
+  unsigned int new_seqcount = dbindex_getcount();
+
+  if ((uint64_t) old_seqcount + new_seqcount > UINT_MAX)
+    {
+      fatal("Too many sequences for UDB file");
+    }
+
+  uint64_t new_ntcount = 0;
+  uint64_t new_header_characters = 0;
+  for (unsigned int i = 0; i < new_seqcount; i++)
+    {
+      unsigned int seqno = dbindex_getmapping(i);
+      new_header_characters += db_getheaderlen(seqno) + 1;
+      new_ntcount += db_getsequencelen(seqno);
+    }
+
+  unsigned int seqcount = old_seqcount + new_seqcount;
+  uint64_t ntcount = old_ntcount + new_ntcount;
+  uint64_t header_characters = old_header_characters + new_header_characters;
+
+  uint64_t pos = 0;
+  uint64_t progress_all =
+    4 * 50 +
+    4 * kmerhashsize +
+    4 * 1 +
+    4 * (old_wordmatches + new_wordmatches) +
+    4 * 8 +
+    4 * seqcount +
+    header_characters +
+    4 * seqcount +
+    ntcount;
+
+  char * prompt = nullptr;
+  if (xsprintf(& prompt, "Appending to UDB file %s", opt_udb_append) == -1)
+    {
+      fatal("Out of memory");
+    }
+
+  progress_init(prompt, progress_all);
+
+  const uint64_t words = BLOCKSIZE / 4;
+  auto * inbuf = (unsigned int *) xmalloc(BLOCKSIZE);
+  auto * outbuf = (unsigned int *) xmalloc(BLOCKSIZE);
+
+  /* header, with the sequence count updated */
+  header[13] = seqcount;
+  pos += largewrite(fd_output, header, 4 * 50, pos);
+
+  /* word match counts */
+  for(uint64_t i = 0; i < kmerhashsize; i++)
+    {
+      old_kmercount[i] += kmercount[i];
+    }
+  pos += largewrite(fd_output, old_kmercount, 4 * kmerhashsize, pos);
+
+  /* 3BDU */
+  outbuf[0] = 0x55444233;
+  pos += largewrite(fd_output, outbuf, 1 * 4, pos);
+
+  /* merged lists of sequence no's, old lists read in blocks */
+  uint64_t in_p = old_words_p;
+  uint64_t in_left = old_wordmatches;
+  uint64_t in_fill = 0;
+  uint64_t in_used = 0;
+  uint64_t out_fill = 0;
+
+  for(uint64_t i = 0; i < kmerhashsize; i++)
+    {
+      unsigned int old_count = old_kmercount[i] - kmercount[i];
+      while (old_count > 0)
+        {
+          if (in_used == in_fill)
+            {
+              in_fill = MIN(words, in_left);
+              udb_read_exact(fd_udb, inbuf, 4 * in_fill, in_p);
+              in_p += 4 * in_fill;
+              in_left -= in_fill;
+              in_used = 0;
+            }
+          if (out_fill == words)
+            {
+              pos += largewrite(fd_output, outbuf, 4 * out_fill, pos);
+              out_fill = 0;
+            }
+          uint64_t n = MIN(old_count, MIN(in_fill - in_used, words - out_fill));
+          memcpy(outbuf + out_fill, inbuf + in_used, 4 * n);
+          out_fill += n;
+          in_used += n;
+          old_count -= n;
+        }
+
+      unsigned int * list = dbindex_getmatchlist(i);
+      for(unsigned int j = 0; j < kmercount[i]; j++)
+        {
+          if (out_fill == words)
+            {
+              pos += largewrite(fd_output, outbuf, 4 * out_fill, pos);
+              out_fill = 0;
+            }
+          outbuf[out_fill++] = old_seqcount + list[j];
+        }
+    }
+  pos += largewrite(fd_output, outbuf, 4 * out_fill, pos);
+
+  /* New header */
+  buffer[2] = seqcount;
+  buffer[3] = (unsigned int)(ntcount & 0xffffffff);
+  buffer[4] = (unsigned int)(ntcount >> 32);
+  buffer[5] = (unsigned int)(header_characters & 0xffffffff);
+  buffer[6] = (unsigned int)(header_characters >> 32);
+  pos += largewrite(fd_output, buffer, 4 * 8, pos);
+
+  /* indices to headers, old ones unchanged */
+  pos += udb_copy(fd_udb, old_headerindex_p, fd_output, pos,
+                  4 * old_seqcount, (char *) inbuf);
+  uint64_t sum = old_header_characters;
+  for (unsigned int i = 0; i < new_seqcount; i++)
+    {
+      outbuf[i % words] = sum;
+      sum += db_getheaderlen(dbindex_getmapping(i)) + 1;
+      if (((i + 1) % words == 0) || (i + 1 == new_seqcount))
+        {
+          pos += largewrite(fd_output, outbuf, 4 * (i % words + 1), pos);
+        }
+    }
+
+  /* headers */
+  pos += udb_copy(fd_udb, old_headers_p, fd_output, pos,
+                  old_header_characters, (char *) inbuf);
+  for (unsigned int i = 0; i < new_seqcount; i++)
+    {
+      unsigned int seqno = dbindex_getmapping(i);
+      pos += largewrite(fd_output,
+                        db_getheader(seqno),
+                        db_getheaderlen(seqno) + 1,
+                        pos);
+    }
+
+  /* sequence lengths */
+  pos += udb_copy(fd_udb, old_lengths_p, fd_output, pos,
+                  4 * old_seqcount, (char *) inbuf);
+  for (unsigned int i = 0; i < new_seqcount; i++)
+    {
+      outbuf[i % words] = db_getsequencelen(dbindex_getmapping(i));
+      if (((i + 1) % words == 0) || (i + 1 == new_seqcount))
+        {
+          pos += largewrite(fd_output, outbuf, 4 * (i % words + 1), pos);
+        }
+    }
+
+  /* sequences */
+  pos += udb_copy(fd_udb, old_sequences_p, fd_output, pos,
+                  old_ntcount, (char *) inbuf);
+  for (unsigned int i = 0; i < new_seqcount; i++)
+    {
+      unsigned int seqno = dbindex_getmapping(i);
+      pos += largewrite(fd_output,
+                        db_getsequence(seqno),
+                        db_getsequencelen(seqno),
+                        pos);
     }
 
   if (close(fd_output) != 0)
@@ -1023,8 +1544,397 @@ void udb_make()
       fatal("Unable to close UDB file");
     }
 
+  close(fd_udb);
+
+  progress_done();
+  xfree(prompt);
+  xfree(inbuf);
+  xfree(outbuf);
+  xfree(old_kmercount);
+}
+
+/* state of the sharded reading of an UDB file, see db_shards_open */
+static int udb_shards_fd = 0;
+static uint64_t udb_shards_seqcount = 0;
+static unsigned int * udb_shards_header_index = nullptr;
+static unsigned int * udb_shards_lengths = nullptr;
+static uint64_t udb_shards_headers_pos = 0;
+static uint64_t udb_shards_sequences_pos = 0;
+static uint64_t udb_shards_next = 0;
+static uint64_t udb_shards_next_p = 0;
+
+void udb_shards_scan(const char * filename)
+{
+  /*
+    Read the header index and the sequence lengths of an UDB file,
+    without the k-mer index, the headers or the sequences. Each
+    sequence is added to the shards.
+  */
+
+  xstat_t fs;
+  if (xstat(filename, & fs))
+    {
+      fatal("Unable to get status for input file (%s)", filename);
+    }
+
+  if (S_ISFIFO(fs.st_mode))
+    {
+      fatal("Cannot read UDB file from a pipe");
+    }
+
+  uint64_t filesize = fs.st_size;
+
+  udb_shards_fd = xopen_read(filename);
+  if (udb_shards_fd < 0)
+    {
+      fatal("Unable to open UDB file for reading");
+    }
+
+  /* header */
+
+  unsigned int buffer[50];
+  uint64_t pos = 0;
+
+  udb_read_exact(udb_shards_fd, buffer, 4 * 50, pos);
+  pos += 4 * 50;
+
+  if (! udb_valid_header(buffer))
+    {
+      fatal("Invalid UDB file");
+    }
+
+  unsigned int udb_wordlength = buffer[4];
+  unsigned int seqcount = buffer[13];
+  uint64_t stoplist_size = udb_stoplist_size(buffer);
+
+  if (udb_wordlength != opt_wordlength)
+    {
+      fprintf(stderr, "\nWARNING: Wordlength adjusted to %u as indicated in UDB file\n", udb_wordlength);
+      opt_wordlength = udb_wordlength;
+    }
+
+  /* word match counts, only needed to skip the word matches */
+
+  uint64_t udb_kmerhashsize = 1 << (2 * udb_wordlength);
+  auto * counts =
+    (unsigned int *) xmalloc(udb_kmerhashsize * sizeof(unsigned int));
+  udb_read_exact(udb_shards_fd, counts, 4 * udb_kmerhashsize, pos);
+  pos += 4 * udb_kmerhashsize;
+
+  uint64_t wordmatches = 0;
+  for(uint64_t i = 0; i < udb_kmerhashsize; i++)
+    {
+      wordmatches += counts[i];
+    }
+  xfree(counts);
+
+  /* signature */
+
+  udb_read_exact(udb_shards_fd, buffer, 4, pos);
+  pos += 4;
+
+  if (buffer[0] != 0x55444233)
+    {
+      fatal("Invalid UDB file");
+    }
+
+  pos += 4 * wordmatches;
+
+  /* new header */
+
+  udb_read_exact(udb_shards_fd, buffer, 4 * 8, pos);
+  pos += 4 * 8;
+
+  if ((buffer[0] != 0x55444234) ||
+      (buffer[1] != 0x005e0db3) ||
+      (buffer[2] != seqcount) ||
+      (buffer[7] != 0x005e0db4))
+    {
+      fatal("Invalid UDB file");
+    }
+
+  uint64_t nucleotides = (((uint64_t) buffer[4]) << 32) | buffer[3];
+  uint64_t udb_headerchars = (((uint64_t) buffer[6]) << 32) | buffer[5];
+
+  /* header index */
+
+  udb_shards_seqcount = seqcount;
+  udb_shards_header_index =
+    (unsigned int *) xmalloc(4 * (seqcount + 1));
+  udb_read_exact(udb_shards_fd, udb_shards_header_index, 4 * seqcount, pos);
+  pos += 4 * seqcount;
+  udb_shards_header_index[seqcount] = udb_headerchars;
+
+  unsigned int last = 0;
+  for(unsigned int i = 0; i < seqcount; i++)
+    {
+      unsigned int x = udb_shards_header_index[i];
+      if ((x < last) || (x >= udb_headerchars))
+        {
+          fatal("Invalid UDB file");
+        }
+      last = x;
+    }
+
+  udb_shards_headers_pos = pos;
+  pos += udb_headerchars;
+
+  /* sequence lengths */
+
+  udb_shards_lengths = (unsigned int *) xmalloc(4 * seqcount);
+  udb_read_exact(udb_shards_fd, udb_shards_lengths, 4 * seqcount, pos);
+  pos += 4 * seqcount;
+
+  uint64_t sum = 0;
+  for(unsigned int i = 0; i < seqcount; i++)
+    {
+      sum += udb_shards_lengths[i];
+    }
+
+  if (sum != nucleotides)
+    {
+      fatal("Invalid UDB file");
+    }
+
+  udb_shards_sequences_pos = pos;
+  pos += nucleotides;
+  pos += stoplist_size;
+
+  if (pos != filesize)
+    {
+      fatal("Incorrect UDB file size");
+    }
+
+  /* add the sequences to the shards */
+
+  char * prompt = nullptr;
+  if (xsprintf(& prompt, "Scanning UDB file %s", filename) == -1)
+    {
+      fatal("Out of memory");
+    }
+
+  progress_init(prompt, seqcount);
+
+  for(unsigned int i = 0; i < seqcount; i++)
+    {
+      db_shards_add(udb_shards_header_index[i + 1]
+                    - udb_shards_header_index[i] - 1,
+                    udb_shards_lengths[i]);
+      progress_update(i);
+    }
+
   progress_done();
+  xfree(prompt);
+
+  udb_shards_next = 0;
+  udb_shards_next_p = 0;
+}
+
+void udb_shards_read(uint64_t first, uint64_t count)
+{
+  /* read the given consecutive sequences of the UDB file into memory */
+
+  if (first == 0)
+    {
+      udb_shards_next = 0;
+      udb_shards_next_p = 0;
+    }
+
+  if ((first != udb_shards_next) || (first + count > udb_shards_seqcount))
+    {
+      fatal("Internal error in sharded reading of UDB file");
+    }
+
+  uint64_t header_start = udb_shards_header_index[first];
+  uint64_t headerchars = udb_shards_header_index[first + count] - header_start;
+
+  uint64_t nucleotides = 0;
+  for(uint64_t i = first; i < first + count; i++)
+    {
+      nucleotides += udb_shards_lengths[i];
+    }
+
+  datap = (char *) xmalloc(headerchars + nucleotides + count);
+  seqindex = (seqinfo_t *) xmalloc(count * sizeof(seqinfo_t));
+
+  udb_read_exact(udb_shards_fd, datap, headerchars,
+                 udb_shards_headers_pos + header_start);
+  udb_read_exact(udb_shards_fd, datap + headerchars, nucleotides,
+                 udb_shards_sequences_pos + udb_shards_next_p);
+
+  uint64_t longestheader = 0;
+  uint64_t longest = 0;
+  uint64_t shortest = UINT_MAX;
+  uint64_t sum = 0;
+
+  for(uint64_t i = 0; i < count; i++)
+    {
+      seqinfo_t * p = seqindex + i;
+      p->header_p = udb_shards_header_index[first + i] - header_start;
+      p->headerlen = udb_shards_header_index[first + i + 1]
+        - udb_shards_header_index[first + i] - 1;
+      p->seq_p = headerchars + sum;
+      p->seqlen = udb_shards_lengths[first + i];
+      p->qual_p = 0;
+
+      header_scan_attributes(datap + p->header_p,
+                             p->headerlen,
+                             & p->attributes);
+      int64_t size = header_get_size_attributes(datap + p->header_p,
+                                                & p->attributes);
+      p->size = size > 0 ? size : 1;
+
+      longestheader = MAX(longestheader, p->headerlen);
+      longest = MAX(longest, p->seqlen);
+      shortest = MIN(shortest, p->seqlen);
+      sum += p->seqlen;
+    }
+
+  /* move sequences and insert zero at end of each sequence */
+
+  for(uint64_t i = count; i > 0; i--)
+    {
+      seqinfo_t * p = seqindex + i - 1;
+      size_t new_p = p->seq_p + i - 1;
+      memmove(datap + new_p, datap + p->seq_p, p->seqlen);
+      *(datap + new_p + p->seqlen) = 0;
+      p->seq_p = new_p;
+    }
+
+  db_setinfo(false, count, nucleotides, longest, shortest, longestheader);
+
+  udb_shards_next += count;
+  udb_shards_next_p += nucleotides;
+}
+
+void udb_shards_close()
+{
+  if (udb_shards_header_index)
+    {
+      close(udb_shards_fd);
+      xfree(udb_shards_header_index);
+      xfree(udb_shards_lengths);
+      udb_shards_header_index = nullptr;
+      udb_shards_lengths = nullptr;
+    }
+}
+
+void udb_make()
+{
+  int fd_output = 0;
+  int fd_udb = 0;
+  unsigned int header[50];
+
+  if (opt_udb_append)
+    {
+      /* the old file must be read while the new one is written */
+      xstat_t fs_udb;
+      xstat_t fs_output;
+      if (xstat(opt_udb_append, & fs_udb))
+        {
+          fatal("Unable to get status for input file (%s)", opt_udb_append);
+        }
+      if ((strcmp(opt_udb_append, opt_output) == 0)
+#ifndef _WIN32
+          || ((xstat(opt_output, & fs_output) == 0) &&
+              (fs_output.st_dev == fs_udb.st_dev) &&
+              (fs_output.st_ino == fs_udb.st_ino))
+#endif
+          )
+        {
+          fatal("The output file must differ from the UDB file given with --udb_append");
+        }
+
+      fd_udb = udb_append_open(header);
+    }
+
+  fd_output = xopen_write(opt_output);
+  if (!fd_output)
+    {
+      fatal("Unable to open output file for writing");
+    }
+
+  db_read(opt_makeudb_usearch, 1);
+
+  if (opt_dbmask == MASK_DUST)
+    {
+      dust_all();
+    }
+  else if ((opt_dbmask == MASK_SOFT) && (opt_hardmask))
+    {
+      hardmask_all();
+    }
+
+  if (opt_udb_append)
+    {
+      /* word lists only, they are merged with those of the old file */
+      dbindex_prepare(0, opt_dbmask);
+      dbindex_addallsequences(opt_dbmask);
+      udb_append(fd_udb, header, fd_output);
+    }
+  else
+    {
+      dbindex_prepare(1, opt_dbmask);
+      dbindex_addallsequences(opt_dbmask);
+      udb_write(fd_output, nullptr);
+    }
+
   dbindex_free();
   db_free();
-  xfree(buffer);
+}
+
+unsigned int * udb_read_kmercounts(const char * filename, uint64_t * sequences)
+{
+  /*
+    Read only the number of sequences containing each word from an UDB
+    file, without the word matches or the sequences.
+  */
+
+  xstat_t fs;
+  if (xstat(filename, & fs))
+    {
+      fatal("Unable to get status for input file (%s)", filename);
+    }
+
+  if (S_ISFIFO(fs.st_mode))
+    {
+      fatal("Cannot read UDB file from a pipe");
+    }
+
+  int fd_udb = xopen_read(filename);
+  if (fd_udb < 0)
+    {
+      fatal("Unable to open UDB file for reading");
+    }
+
+  unsigned int buffer[50];
+  udb_read_exact(fd_udb, buffer, 4 * 50, 0);
+
+  if (! udb_valid_header(buffer))
+    {
+      fatal("Invalid UDB file");
+    }
+
+  unsigned int udb_wordlength = buffer[4];
+  * sequences = buffer[13];
+
+  if (buffer[22])
+    {
+      fatal("UDB files of minimizers (--minimizer_window) cannot be used here");
+    }
+
+  if (udb_wordlength != opt_wordlength)
+    {
+      fprintf(stderr, "\nWARNING: Wordlength adjusted to %u as indicated in UDB file\n", udb_wordlength);
+      opt_wordlength = udb_wordlength;
+    }
+
+  uint64_t udb_kmerhashsize = 1 << (2 * udb_wordlength);
+  auto * counts =
+    (unsigned int *) xmalloc(udb_kmerhashsize * sizeof(unsigned int));
+  udb_read_exact(fd_udb, counts, 4 * udb_kmerhashsize, 4 * 50);
+
+  close(fd_udb);
+
+  return counts;
 }
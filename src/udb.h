@@ -68,4 +68,9 @@ void udb_read(const char * filename,
 void udb_fasta();
 void udb_info();
 void udb_make();
+void udb_write(int fd_output, int64_t * abundances);
 void udb_stats();
+void udb_shards_scan(const char * filename);
+void udb_shards_read(uint64_t first, uint64_t count);
+void udb_shards_close();
+unsigned int * udb_read_kmercounts(const char * filename, uint64_t * sequences);
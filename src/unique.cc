@@ -78,6 +78,13 @@ struct bucket_s
   unsigned int count;
 };
 
+struct minimizer_s
+{
+  uint64_t order;
+  unsigned int kmer;
+  int pos;
+};
+
 struct uhandle_s
 {
   struct bucket_s * hash;
@@ -88,6 +95,12 @@ struct uhandle_s
 
   uint64_t bitmap_size;
   uint64_t * bitmap;
+  unsigned int bitmap_listlen;
+
+  struct minimizer_s * window;
+  int window_alloc;
+  unsigned int * picked;
+  int picked_alloc;
 };
 
 struct uhandle_s * unique_init()
@@ -102,6 +115,12 @@ struct uhandle_s * unique_init()
 
   uh->bitmap_size = 0;
   uh->bitmap = nullptr;
+  uh->bitmap_listlen = 0;
+
+  uh->window = nullptr;
+  uh->window_alloc = 0;
+  uh->picked = nullptr;
+  uh->picked_alloc = 0;
 
   return uh;
 }
@@ -120,6 +139,14 @@ void unique_exit(struct uhandle_s * uh)
     {
       xfree(uh->list);
     }
+  if (uh->window)
+    {
+      xfree(uh->window);
+    }
+  if (uh->picked)
+    {
+      xfree(uh->picked);
+    }
   xfree(uh);
 }
 
@@ -172,9 +199,21 @@ void unique_count_bitmap(struct uhandle_s * uh,
     {
       uh->bitmap = (uint64_t *) xrealloc(uh->bitmap, size >> 3ULL);
       uh->bitmap_size = size;
+      memset(uh->bitmap, 0, size >> 3ULL);
+    }
+  else if (8ULL * uh->bitmap_listlen < (size >> 6ULL))
+    {
+      /* only the bits of the previous list are set, clear them one
+         by one rather than the whole bitmap */
+      for(unsigned int i = 0; i < uh->bitmap_listlen; i++)
+        {
+          uh->bitmap[uh->list[i] >> 6U] = 0;
+        }
+    }
+  else
+    {
+      memset(uh->bitmap, 0, size >> 3ULL);
     }
-
-  memset(uh->bitmap, 0, size >> 3ULL);
 
   uint64_t bad = 0;
   uint64_t kmer = 0;
@@ -224,6 +263,7 @@ void unique_count_bitmap(struct uhandle_s * uh,
         }
     }
 
+  uh->bitmap_listlen = unique;
   *listlen = unique;
   *list = uh->list;
 }
@@ -338,6 +378,237 @@ void unique_count(struct uhandle_s * uh,
     }
 }
 
+/*
+  Window minimizers. Of each window of w consecutive k-mers, only the
+  one with the lowest order value is kept, which samples about 2/(w+1)
+  of the k-mers. Two sequences sharing a stretch of at least w+k-1
+  nucleotides share the minimizers of the windows within it, whatever
+  the rest of the sequences. The order value is a mixing function of
+  the k-mer, as ordering the k-mers themselves would prefer poly-A
+  and other low complexity words. Windows with masked or ambiguous
+  k-mers only consider the others, and sequences shorter than one
+  window keep their lowest k-mer. The minimizers are made unique as
+  in unique_count, so unique_count_shared works on them as well.
+*/
+
+inline uint64_t unique_minimizer_order(uint64_t kmer)
+{
+  /* invertible, so that only equal k-mers have equal order values */
+  uint64_t x = kmer * 0x9e3779b97f4a7c15ULL;
+  return x ^ (x >> 29U);
+}
+
+static unsigned int unique_minimizers_pick(struct uhandle_s * uh,
+                                           int k,
+                                           int w,
+                                           int seqlen,
+                                           char * seq,
+                                           int seqmask)
+{
+  /* store the minimizers of consecutive windows in uh->picked */
+
+  if (uh->window_alloc < w)
+    {
+      uh->window_alloc = w;
+      uh->window = (struct minimizer_s *)
+        xrealloc(uh->window, sizeof(struct minimizer_s) * w);
+    }
+
+  if (uh->picked_alloc < seqlen)
+    {
+      uh->picked_alloc = MAX(seqlen, 2 * uh->picked_alloc);
+      uh->picked = (unsigned int *)
+        xrealloc(uh->picked, sizeof(unsigned int) * uh->picked_alloc);
+    }
+
+  /* the window holds a queue of increasing order values */
+  struct minimizer_s * queue = uh->window;
+  int head = 0;
+  int tail = 0;
+  int queued = 0;
+
+  uint64_t bad = 0;
+  uint64_t kmer = 0;
+  uint64_t mask = (1ULL << (2ULL * k)) - 1ULL;
+  char * s = seq;
+  char * e1 = s + k-1;
+  char * e2 = s + seqlen;
+  if (e2 < e1)
+    {
+      e1 = e2;
+    }
+
+  unsigned int * maskmap = (seqmask != MASK_NONE) ?
+    chrmap_mask_lower : chrmap_mask_ambig;
+
+  while (s < e1)
+    {
+      bad <<= 2ULL;
+      bad |= maskmap[(int)(*s)];
+
+      kmer <<= 2ULL;
+      kmer |= chrmap_2bit[(int)(*s++)];
+    }
+
+  int kmers = seqlen - k + 1;
+  unsigned int picked = 0;
+  int last_pos = -1;
+  int pos = 0;
+
+  while (s < e2)
+    {
+      bad <<= 2ULL;
+      bad |= maskmap[(int)(*s)];
+      bad &= mask;
+
+      kmer <<= 2ULL;
+      kmer |= chrmap_2bit[(int)(*s++)];
+      kmer &= mask;
+
+      /* drop the k-mer leaving the window */
+      if (queued && (queue[head].pos <= pos - w))
+        {
+          head = (head + 1) % w;
+          queued--;
+        }
+
+      if (!bad)
+        {
+          uint64_t order = unique_minimizer_order(kmer);
+          while (queued &&
+                 (queue[(tail + w - 1) % w].order >= order))
+            {
+              tail = (tail + w - 1) % w;
+              queued--;
+            }
+          queue[tail].order = order;
+          queue[tail].kmer = kmer;
+          queue[tail].pos = pos;
+          tail = (tail + 1) % w;
+          queued++;
+        }
+
+      if (((pos >= w - 1) || (pos == kmers - 1)) &&
+          queued && (queue[head].pos != last_pos))
+        {
+          uh->picked[picked++] = queue[head].kmer;
+          last_pos = queue[head].pos;
+        }
+
+      pos++;
+    }
+
+  return picked;
+}
+
+void unique_count_minimizers(struct uhandle_s * uh,
+                             int k,
+                             int w,
+                             int seqlen,
+                             char * seq,
+                             unsigned int * listlen,
+                             unsigned int * * list,
+                             int seqmask)
+{
+  unsigned int picked = unique_minimizers_pick(uh, k, w, seqlen, seq, seqmask);
+
+  int unique = 0;
+
+  if (k<10)
+    {
+      /* as in unique_count_bitmap */
+
+      if (uh->alloc < seqlen)
+        {
+          while (uh->alloc < seqlen)
+            {
+              uh->alloc *= 2;
+            }
+          uh->list = (unsigned int *)
+            xrealloc(uh->list, sizeof(unsigned int) * uh->alloc);
+        }
+
+      uint64_t size = 1ULL << (k << 1ULL);
+
+      if (uh->bitmap_size < size)
+        {
+          uh->bitmap = (uint64_t *) xrealloc(uh->bitmap, size >> 3ULL);
+          uh->bitmap_size = size;
+          memset(uh->bitmap, 0, size >> 3ULL);
+        }
+      else if (8ULL * uh->bitmap_listlen < (size >> 6ULL))
+        {
+          for(unsigned int i = 0; i < uh->bitmap_listlen; i++)
+            {
+              uh->bitmap[uh->list[i] >> 6U] = 0;
+            }
+        }
+      else
+        {
+          memset(uh->bitmap, 0, size >> 3ULL);
+        }
+
+      for(unsigned int i = 0; i < picked; i++)
+        {
+          unsigned int kmer = uh->picked[i];
+          uint64_t x = kmer >> 6ULL;
+          uint64_t y = 1ULL << (kmer & 63ULL);
+          if (!(uh->bitmap[x] & y))
+            {
+              uh->list[unique++] = kmer;
+              uh->bitmap[x] |= y;
+            }
+        }
+
+      uh->bitmap_listlen = unique;
+    }
+  else
+    {
+      /* as in unique_count_hash */
+
+      if (uh->alloc < 2*seqlen)
+        {
+          while (uh->alloc < 2*seqlen)
+            {
+              uh->alloc *= 2;
+            }
+          uh->hash = (struct bucket_s *)
+            xrealloc(uh->hash, sizeof(struct bucket_s) * uh->alloc);
+          uh->list = (unsigned int *)
+            xrealloc(uh->list, sizeof(unsigned int) * uh->alloc);
+        }
+
+      uh->size = 1;
+      while (uh->size < 2*seqlen)
+        {
+          uh->size *= 2;
+        }
+      uh->hash_mask = uh->size - 1;
+
+      memset(uh->hash, 0, sizeof(struct bucket_s) * uh->size);
+
+      for(unsigned int i = 0; i < picked; i++)
+        {
+          unsigned int kmer = uh->picked[i];
+          uint64_t j = HASH((char*)&kmer, (k+3)/4) & uh->hash_mask;
+          while((uh->hash[j].count) && (uh->hash[j].kmer != kmer))
+            {
+              j = (j + 1) & uh->hash_mask;
+            }
+
+          if (!(uh->hash[j].count))
+            {
+              uh->list[unique++] = kmer;
+              uh->hash[j].kmer = kmer;
+              uh->hash[j].count = 1;
+            }
+        }
+    }
+
+  *listlen = unique;
+  *list = uh->list;
+}
+
 int unique_count_shared(struct uhandle_s * uh,
                         int k,
                         int listlen,
@@ -76,6 +76,15 @@ void unique_count(struct uhandle_s * uh,
                   unsigned int * * list,
                   int seqmask);
 
+void unique_count_minimizers(struct uhandle_s * uh,
+                             int k,
+                             int w,
+                             int seqlen,
+                             char * seq,
+                             unsigned int * listlen,
+                             unsigned int * * list,
+                             int seqmask);
+
 int unique_count_shared(struct uhandle_s * uh,
                         int k,
                         int listlen,
@@ -232,56 +232,112 @@ void reverse_complement(char * rc, char * seq, int64_t len)
      The memory for rc must be long enough for the rc of the sequence
      (identical to the length of seq + 1. */
 
-  for(int64_t i=0; i<len; i++)
+  int64_t done = 0;
+
+#ifdef __x86_64__
+  if (ssse3_present)
+    {
+      done = reverse_complement_blocks_ssse3(rc, seq, len);
+    }
+#else
+  done = reverse_complement_blocks(rc, seq, len);
+#endif
+
+  for(int64_t i=done; i<len; i++)
     {
-      rc[i] = chrmap_complement[(int)(seq[len-1-i])];
+      rc[i] = chrmap_complement[(unsigned char)(seq[len-1-i])];
     }
   rc[len] = 0;
 }
 
-void random_init()
+void reverse_string(char * dst, char * src, int64_t len)
 {
-  arch_srandom();
+  /* Write the characters of src in reverse order to dst, which must
+     have room for len + 1 characters. */
+
+  int64_t done = 0;
+
+#ifdef __x86_64__
+  if (ssse3_present)
+    {
+      done = reverse_blocks_ssse3(dst, src, len);
+    }
+#else
+  done = reverse_blocks(dst, src, len);
+#endif
+
+  for(int64_t i=done; i<len; i++)
+    {
+      dst[i] = src[len-1-i];
+    }
+  dst[len] = 0;
 }
 
-int64_t random_int(int64_t n)
+/*
+  Pseudo-random numbers from xoshiro256** (Blackman & Vigna), seeded by
+  splitmix64. Each random_s holds an independent stream, selected by a
+  number. Stream 0 is used by random_int and random_ulong; commands
+  running in several threads give each query its own stream, so that
+  their results depend only on --randseed and not on the threads.
+*/
+
+static uint64_t random_seed = 0;
+static struct random_s random_main;
+
+static uint64_t random_splitmix64(uint64_t * x)
 {
-  /*
-    Generate a random integer in the range 0 to n-1, inclusive.
-    n must be > 0
-    The random() function returns a random number in the range
-    0 to 2147483647 (=2^31-1=RAND_MAX), inclusive.
-    We should avoid some of the upper generated numbers to
-    avoid modulo bias.
-  */
+  uint64_t z = (* x += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30U)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27U)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31U);
+}
+
+void random_init()
+{
+  random_seed = arch_random_seed();
+  random_stream(& random_main, 0);
+}
 
-  int64_t random_max = RAND_MAX;
-  int64_t limit = random_max - (random_max + 1) % n;
-  int64_t r = arch_random();
-  while (r > limit)
+void random_stream(struct random_s * r, uint64_t stream)
+{
+  /* the streams start from disjoint parts of the splitmix64 sequence */
+  uint64_t x = random_seed + stream * 4 * 0x9e3779b97f4a7c15ULL;
+  for(int i = 0; i < 4; i++)
     {
-      r = arch_random();
+      r->s[i] = random_splitmix64(& x);
     }
-  return r % n;
 }
 
-uint64_t random_ulong(uint64_t n)
+uint64_t random_ulong_r(struct random_s * r, uint64_t n)
 {
   /*
     Generate a random integer in the range 0 to n-1, inclusive,
-    n must be > 0
+    n must be > 0. Avoid the upper generated numbers that would
+    cause modulo bias.
   */
 
-  uint64_t random_max = ULONG_MAX;
+  uint64_t random_max = UINT64_MAX;
   uint64_t limit = random_max - (random_max - n + 1) % n;
-  uint64_t r = ((arch_random() << 48) ^ (arch_random() << 32) ^
-                (arch_random() << 16) ^ (arch_random()));
-  while (r > limit)
+  uint64_t x = random_next(r);
+  while (x > limit)
     {
-      r = ((arch_random() << 48) ^ (arch_random() << 32) ^
-           (arch_random() << 16) ^ (arch_random()));
+      x = random_next(r);
     }
-  return r % n;
+  return x % n;
+}
+
+int64_t random_int(int64_t n)
+{
+  /* Generate a random integer in the range 0 to n-1, inclusive. */
+
+  return random_ulong_r(& random_main, n);
+}
+
+uint64_t random_ulong(uint64_t n)
+{
+  /* Generate a random integer in the range 0 to n-1, inclusive. */
+
+  return random_ulong_r(& random_main, n);
 }
 
 void string_normalize(char * normalized, char * s, unsigned int len)
@@ -380,14 +436,20 @@ void get_hex_seq_digest_md5(char * hex, char * seq, int seqlen)
 void fprint_seq_digest_sha1(FILE * fp, char * seq, int seqlen)
 {
   char digest[LEN_HEX_DIG_SHA1];
-  get_hex_seq_digest_sha1(digest, seq, seqlen);
+  if (! digest_prefetch_get(seq, seqlen, digest))
+    {
+      get_hex_seq_digest_sha1(digest, seq, seqlen);
+    }
   fprintf(fp, "%s", digest);
 }
 
 void fprint_seq_digest_md5(FILE * fp, char * seq, int seqlen)
 {
   char digest[LEN_HEX_DIG_MD5];
-  get_hex_seq_digest_md5(digest, seq, seqlen);
+  if (! digest_prefetch_get(seq, seqlen, digest))
+    {
+      get_hex_seq_digest_md5(digest, seq, seqlen);
+    }
   fprintf(fp, "%s", digest);
 }
 
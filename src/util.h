@@ -94,13 +94,37 @@ void progress_init(const char * prompt, uint64_t size);
 void progress_update(uint64_t progress);
 void progress_done();
 
+struct random_s
+{
+  uint64_t s[4];
+};
+
 void random_init();
+void random_stream(struct random_s * r, uint64_t stream);
+uint64_t random_ulong_r(struct random_s * r, uint64_t n);
 int64_t random_int(int64_t n);
 uint64_t random_ulong(uint64_t n);
 
+inline uint64_t random_next(struct random_s * r)
+{
+  /* xoshiro256** */
+  uint64_t * s = r->s;
+  uint64_t x = s[1] * 5;
+  uint64_t result = ((x << 7U) | (x >> 57U)) * 9;
+  uint64_t t = s[1] << 17U;
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = (s[3] << 45U) | (s[3] >> 19U);
+  return result;
+}
+
 void string_normalize(char * normalized, char * s, unsigned int len);
 
 void reverse_complement(char * rc, char * seq, int64_t len);
+void reverse_string(char * dst, char * src, int64_t len);
 
 void fprint_hex(FILE * fp, unsigned char * data, int len);
 
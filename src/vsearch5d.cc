@@ -65,6 +65,7 @@
 
 /* options */
 
+bool opt_abskew_prune;
 bool opt_bzip2_decompress;
 bool opt_clusterout_id;
 bool opt_clusterout_sort;
@@ -74,8 +75,13 @@ bool opt_fastq_allowmergestagger;
 bool opt_fastq_eeout;
 bool opt_fastq_nostagger;
 bool opt_gzip_decompress;
+bool opt_hugepages;
+bool opt_idoffset_split;
 bool opt_label_substr_match;
 bool opt_no_progress;
+bool opt_numa_interleave;
+bool opt_pin_threads;
+bool opt_query_cache;
 bool opt_quiet;
 bool opt_relabel_keep;
 bool opt_relabel_md5;
@@ -88,6 +94,7 @@ bool opt_xee;
 bool opt_xsize;
 char * opt_allpairs_global;
 char * opt_alnout;
+char * opt_bamout;
 char * opt_biomout;
 char * opt_blast6out;
 char * opt_borderline;
@@ -97,6 +104,8 @@ char * opt_cluster_fast;
 char * opt_cluster_size;
 char * opt_cluster_smallmem;
 char * opt_cluster_unoise;
+char * opt_clusterdb;
+char * opt_clusterdbout;
 char * opt_clusters;
 char * opt_consout;
 char * opt_cut;
@@ -138,6 +147,9 @@ char * opt_fastx_getsubseq;
 char * opt_fastx_mask;
 char * opt_fastx_revcomp;
 char * opt_fastx_subsample;
+char * opt_hits2text;
+char * opt_hitsout;
+char * opt_index_cache;
 char * opt_join_padgap;
 char * opt_join_padgapq;
 char * opt_label;
@@ -147,6 +159,7 @@ char * opt_label_word;
 char * opt_label_words;
 char * opt_label_field;
 char * opt_log;
+char * opt_makeorientmodel;
 char * opt_makeudb_usearch;
 char * opt_maskfasta;
 char * opt_matched;
@@ -172,6 +185,7 @@ char * opt_sortbylength;
 char * opt_sortbysize;
 char * opt_tabbedout;
 char * opt_udb2fasta;
+char * opt_udb_append;
 char * opt_udbinfo;
 char * opt_udbstats;
 char * opt_uc;
@@ -196,6 +210,7 @@ double opt_maxid;
 double opt_maxqt;
 double opt_maxsizeratio;
 double opt_maxsl;
+double opt_maxwordfreq;
 double opt_mid;
 double opt_min_unmasked_pct;
 double opt_mindiv;
@@ -236,6 +251,7 @@ int opt_uchimeout5;
 int opt_usersort;
 int opt_version;
 int64_t opt_dbmask;
+int64_t opt_dbshard_size;
 int64_t opt_fasta_width;
 int64_t opt_fastq_ascii;
 int64_t opt_fastq_asciiout;
@@ -274,6 +290,7 @@ int64_t opt_maxsize;
 int64_t opt_maxsubs;
 int64_t opt_maxuniquesize;
 int64_t opt_mincols;
+int64_t opt_minimizer_window;
 int64_t opt_minseqlength;
 int64_t opt_minsize;
 int64_t opt_mintsize;
@@ -289,6 +306,7 @@ int64_t opt_rowlen;
 int64_t opt_sample_size;
 int64_t opt_self;
 int64_t opt_selfid;
+int64_t opt_shard_count;
 int64_t opt_sizein;
 int64_t opt_sizeout;
 int64_t opt_strand;
@@ -334,6 +352,11 @@ char * STDOUT_NAME = (char*) "/dev/stdout";
   __asm__ __volatile__ ("cpuid"                                         \
                         : "=a" (a), "=b" (b), "=c" (c), "=d" (d)        \
                         : "a" (f1), "c" (f2));
+
+#define xgetbv(n, a, d)                                                 \
+  __asm__ __volatile__ ("xgetbv"                                        \
+                        : "=a" (a), "=d" (d)                            \
+                        : "c" (n));
 #endif
 
 void cpu_features_detect()
@@ -365,11 +388,17 @@ void cpu_features_detect()
       sse42_present  = (c >> 20) & 1;
       popcnt_present = (c >> 23) & 1;
       avx_present    = (c >> 28) & 1;
+      unsigned int osxsave = (c >> 27) & 1;
 
-      if (maxlevel >= 7)
+      /* AVX2 also needs the OS to save the YMM state (XCR0 bits 1-2) */
+      if ((maxlevel >= 7) && avx_present && osxsave)
         {
-          cpuid(7, 0, a, b, c, d);
-          avx2_present = (b >>  5) & 1;
+          xgetbv(0, a, d);
+          if ((a & 6) == 6)
+            {
+              cpuid(7, 0, a, b, c, d);
+              avx2_present = (b >>  5) & 1;
+            }
         }
     }
 #else
@@ -734,10 +763,12 @@ void args_init(int argc, char **argv)
   progname = argv[0];
 
   opt_abskew = -1.0;
+  opt_abskew_prune = false;
   opt_acceptall = 0;
   opt_alignwidth = 80;
   opt_allpairs_global = nullptr;
   opt_alnout = nullptr;
+  opt_bamout = nullptr;
   opt_blast6out = nullptr;
   opt_biomout = nullptr;
   opt_borderline = nullptr;
@@ -748,6 +779,8 @@ void args_init(int argc, char **argv)
   opt_cluster_size = nullptr;
   opt_cluster_smallmem = nullptr;
   opt_cluster_unoise = nullptr;
+  opt_clusterdb = nullptr;
+  opt_clusterdbout = nullptr;
   opt_clusterout_id = false;
   opt_clusterout_sort = false;
   opt_clusters = nullptr;
@@ -759,6 +792,7 @@ void args_init(int argc, char **argv)
   opt_dbmask = MASK_DUST;
   opt_dbmatched = nullptr;
   opt_dbnotmatched = nullptr;
+  opt_dbshard_size = 0;
   opt_derep_fulllength = nullptr;
   opt_derep_id = nullptr;
   opt_derep_prefix = nullptr;
@@ -844,11 +878,16 @@ void args_init(int argc, char **argv)
   opt_gzip_decompress = false;
   opt_hardmask = 0;
   opt_help = 0;
+  opt_hits2text = nullptr;
+  opt_hitsout = nullptr;
+  opt_hugepages = false;
   opt_id = -1.0;
   opt_iddef = 2;
   opt_idoffset = 0;
+  opt_idoffset_split = false;
   opt_idprefix = 0;
   opt_idsuffix = 0;
+  opt_index_cache = nullptr;
   opt_join_padgap = nullptr;
   opt_join_padgapq = nullptr;
   opt_label = nullptr;
@@ -863,6 +902,7 @@ void args_init(int argc, char **argv)
   opt_length_cutoffs_longest = INT_MAX;
   opt_length_cutoffs_shortest = 50;
   opt_log = nullptr;
+  opt_makeorientmodel = nullptr;
   opt_makeudb_usearch = nullptr;
   opt_maskfasta = nullptr;
   opt_match = 2;
@@ -882,12 +922,14 @@ void args_init(int argc, char **argv)
   opt_maxsl = DBL_MAX;
   opt_maxsubs = INT_MAX;
   opt_maxuniquesize = LONG_MAX;
+  opt_maxwordfreq = 1.0;
   opt_mid = 0.0;
   opt_min_unmasked_pct = 0.0;
   opt_mincols = 0;
   opt_mindiffs = 3;
   opt_mindiv = 0.8;
   opt_minh = 0.28;
+  opt_minimizer_window = -1;
   opt_minqt = 0.0;
   opt_minseqlength = -1;
   opt_minsize = 0;
@@ -904,13 +946,16 @@ void args_init(int argc, char **argv)
   opt_notmatched = nullptr;
   opt_notmatched = nullptr;
   opt_notrunclabels = 0;
+  opt_numa_interleave = false;
   opt_orient = nullptr;
   opt_otutabout = nullptr;
   opt_output = nullptr;
   opt_output_no_hits = 0;
   opt_pattern = nullptr;
+  opt_pin_threads = false;
   opt_profile = nullptr;
   opt_qmask = MASK_DUST;
+  opt_query_cache = false;
   opt_query_cov = 0.0;
   opt_quiet = false;
   opt_randseed = 0;
@@ -932,6 +977,7 @@ void args_init(int argc, char **argv)
   opt_selfid = 0;
   opt_sff_convert = nullptr;
   opt_sff_clip = false;
+  opt_shard_count = 1;
   opt_shuffle = nullptr;
   opt_sintax = nullptr;
   opt_sintax_cutoff = 0.0;
@@ -950,6 +996,7 @@ void args_init(int argc, char **argv)
   opt_top_hits_only = 0;
   opt_topn = LONG_MAX;
   opt_udb2fasta = nullptr;
+  opt_udb_append = nullptr;
   opt_udbinfo = nullptr;
   opt_udbstats = nullptr;
   opt_uc = nullptr;
@@ -1204,7 +1251,25 @@ void args_init(int argc, char **argv)
       option_xee,
       option_xn,
       option_xsize,
-      option_idoffset
+      option_idoffset,
+      option_clusterdb,
+      option_clusterdbout,
+      option_shard_count,
+      option_idoffset_split,
+      option_udb_append,
+      option_dbshard_size,
+      option_hitsout,
+      option_hits2text,
+      option_bamout,
+      option_makeorientmodel,
+      option_index_cache,
+      option_query_cache,
+      option_maxwordfreq,
+      option_minimizer_window,
+      option_hugepages,
+      option_numa_interleave,
+      option_pin_threads,
+      option_abskew_prune
     };
 
   static struct option long_options[] =
@@ -1438,6 +1503,24 @@ void args_init(int argc, char **argv)
       {"xn",                    required_argument, nullptr, 0 },
       {"xsize",                 no_argument,       nullptr, 0 },
       {"idoffset",              required_argument, nullptr, 0 },
+      {"clusterdb",             required_argument, nullptr, 0 },
+      {"clusterdbout",          required_argument, nullptr, 0 },
+      {"shard_count",           required_argument, nullptr, 0 },
+      {"idoffset_split",        no_argument,       nullptr, 0 },
+      {"udb_append",            required_argument, nullptr, 0 },
+      {"dbshard_size",          required_argument, nullptr, 0 },
+      {"hitsout",               required_argument, nullptr, 0 },
+      {"hits2text",             required_argument, nullptr, 0 },
+      {"bamout",                required_argument, nullptr, 0 },
+      {"makeorientmodel",       required_argument, nullptr, 0 },
+      {"index_cache",           required_argument, nullptr, 0 },
+      {"query_cache",           no_argument,       nullptr, 0 },
+      {"maxwordfreq",           required_argument, nullptr, 0 },
+      {"minimizer_window",      required_argument, nullptr, 0 },
+      {"hugepages",             no_argument,       nullptr, 0 },
+      {"numa_interleave",       no_argument,       nullptr, 0 },
+      {"pin_threads",           no_argument,       nullptr, 0 },
+      {"abskew_prune",          no_argument,       nullptr, 0 },
       { nullptr,                      0,                 nullptr, 0 }
     };
 
@@ -2440,6 +2523,82 @@ void args_init(int argc, char **argv)
           opt_idoffset = args_getlong(optarg);
           break;
 
+        case option_clusterdb:
+          opt_clusterdb = optarg;
+          break;
+
+        case option_clusterdbout:
+          opt_clusterdbout = optarg;
+          break;
+
+        case option_shard_count:
+          opt_shard_count = args_getlong(optarg);
+          break;
+
+        case option_idoffset_split:
+          opt_idoffset_split = true;
+          break;
+
+        case option_udb_append:
+          opt_udb_append = optarg;
+          break;
+
+        case option_dbshard_size:
+          opt_dbshard_size = args_getlong(optarg);
+          break;
+
+        case option_hitsout:
+          opt_hitsout = optarg;
+          break;
+
+        case option_hits2text:
+          opt_hits2text = optarg;
+          break;
+
+        case option_bamout:
+          opt_bamout = optarg;
+          break;
+
+        case option_makeorientmodel:
+          opt_makeorientmodel = optarg;
+          break;
+
+        case option_index_cache:
+          opt_index_cache = optarg;
+          break;
+
+        case option_query_cache:
+          opt_query_cache = true;
+          break;
+
+        case option_maxwordfreq:
+          opt_maxwordfreq = args_getdouble(optarg);
+          break;
+
+        case option_minimizer_window:
+          opt_minimizer_window = args_getlong(optarg);
+          if ((opt_minimizer_window < 0) || (opt_minimizer_window > 255))
+            {
+              fatal("The argument to --minimizer_window must be in the range 0 to 255");
+            }
+          break;
+
+        case option_hugepages:
+          opt_hugepages = true;
+          break;
+
+        case option_numa_interleave:
+          opt_numa_interleave = true;
+          break;
+
+        case option_pin_threads:
+          opt_pin_threads = true;
+          break;
+
+        case option_abskew_prune:
+          opt_abskew_prune = true;
+          break;
+
         default:
           fatal("Internal error in option parsing");
         }
@@ -2489,6 +2648,8 @@ void args_init(int argc, char **argv)
       option_fastx_subsample,
       option_h,
       option_help,
+      option_hits2text,
+      option_makeorientmodel,
       option_makeudb_usearch,
       option_maskfasta,
       option_orient,
@@ -2518,7 +2679,7 @@ void args_init(int argc, char **argv)
     The first line is the command and the lines below are the valid options.
   */
 
-  const int valid_options[][93] =
+  const int valid_options[][101] =
     {
       {
         option_allpairs_global,
@@ -2537,6 +2698,7 @@ void args_init(int argc, char **argv)
         option_hspw,
         option_id,
         option_iddef,
+        option_idoffset_split,
         option_idprefix,
         option_idsuffix,
         option_idoffset,
@@ -2608,6 +2770,8 @@ void args_init(int argc, char **argv)
         option_blast6out,
         option_bzip2_decompress,
         option_centroids,
+        option_clusterdb,
+        option_clusterdbout,
         option_clusterout_id,
         option_clusterout_sort,
         option_clusters,
@@ -2621,8 +2785,10 @@ void args_init(int argc, char **argv)
         option_gzip_decompress,
         option_hardmask,
         option_hspw,
+        option_hugepages,
         option_id,
         option_iddef,
+        option_idoffset_split,
         option_idprefix,
         option_idsuffix,
         option_idoffset,
@@ -2657,9 +2823,11 @@ void args_init(int argc, char **argv)
         option_no_progress,
         option_notmatched,
         option_notrunclabels,
+        option_numa_interleave,
         option_otutabout,
         option_output_no_hits,
         option_pattern,
+        option_pin_threads,
         option_profile,
         option_qmask,
         option_query_cov,
@@ -2675,6 +2843,7 @@ void args_init(int argc, char **argv)
         option_samout,
         option_self,
         option_selfid,
+        option_shard_count,
         option_sizein,
         option_sizeorder,
         option_sizeout,
@@ -2700,6 +2869,8 @@ void args_init(int argc, char **argv)
         option_blast6out,
         option_bzip2_decompress,
         option_centroids,
+        option_clusterdb,
+        option_clusterdbout,
         option_clusterout_id,
         option_clusterout_sort,
         option_clusters,
@@ -2713,8 +2884,10 @@ void args_init(int argc, char **argv)
         option_gzip_decompress,
         option_hardmask,
         option_hspw,
+        option_hugepages,
         option_id,
         option_iddef,
+        option_idoffset_split,
         option_idprefix,
         option_idsuffix,
         option_idoffset,
@@ -2749,9 +2922,11 @@ void args_init(int argc, char **argv)
         option_no_progress,
         option_notmatched,
         option_notrunclabels,
+        option_numa_interleave,
         option_otutabout,
         option_output_no_hits,
         option_pattern,
+        option_pin_threads,
         option_profile,
         option_qmask,
         option_query_cov,
@@ -2767,6 +2942,7 @@ void args_init(int argc, char **argv)
         option_samout,
         option_self,
         option_selfid,
+        option_shard_count,
         option_sizein,
         option_sizeorder,
         option_sizeout,
@@ -2792,6 +2968,8 @@ void args_init(int argc, char **argv)
         option_blast6out,
         option_bzip2_decompress,
         option_centroids,
+        option_clusterdb,
+        option_clusterdbout,
         option_clusterout_id,
         option_clusterout_sort,
         option_clusters,
@@ -2805,8 +2983,10 @@ void args_init(int argc, char **argv)
         option_gzip_decompress,
         option_hardmask,
         option_hspw,
+        option_hugepages,
         option_id,
         option_iddef,
+        option_idoffset_split,
         option_idprefix,
         option_idsuffix,
         option_idoffset,
@@ -2841,9 +3021,11 @@ void args_init(int argc, char **argv)
         option_no_progress,
         option_notmatched,
         option_notrunclabels,
+        option_numa_interleave,
         option_otutabout,
         option_output_no_hits,
         option_pattern,
+        option_pin_threads,
         option_profile,
         option_qmask,
         option_query_cov,
@@ -2859,6 +3041,7 @@ void args_init(int argc, char **argv)
         option_samout,
         option_self,
         option_selfid,
+        option_shard_count,
         option_sizein,
         option_sizeorder,
         option_sizeout,
@@ -2885,6 +3068,8 @@ void args_init(int argc, char **argv)
         option_blast6out,
         option_bzip2_decompress,
         option_centroids,
+        option_clusterdb,
+        option_clusterdbout,
         option_clusterout_id,
         option_clusterout_sort,
         option_clusters,
@@ -2898,8 +3083,10 @@ void args_init(int argc, char **argv)
         option_gzip_decompress,
         option_hardmask,
         option_hspw,
+        option_hugepages,
         option_id,
         option_iddef,
+        option_idoffset_split,
         option_idprefix,
         option_idsuffix,
         option_idoffset,
@@ -2935,9 +3122,11 @@ void args_init(int argc, char **argv)
         option_no_progress,
         option_notmatched,
         option_notrunclabels,
+        option_numa_interleave,
         option_otutabout,
         option_output_no_hits,
         option_pattern,
+        option_pin_threads,
         option_profile,
         option_qmask,
         option_query_cov,
@@ -2953,6 +3142,7 @@ void args_init(int argc, char **argv)
         option_samout,
         option_self,
         option_selfid,
+        option_shard_count,
         option_sizein,
         option_sizeorder,
         option_sizeout,
@@ -3561,18 +3751,49 @@ void args_init(int argc, char **argv)
         option_threads,
         -1 },
 
+      { option_hits2text,
+        option_blast6out,
+        option_log,
+        option_no_progress,
+        option_output_no_hits,
+        option_quiet,
+        option_threads,
+        option_userfields,
+        option_userout,
+        -1 },
+
+      { option_makeorientmodel,
+        option_bzip2_decompress,
+        option_dbmask,
+        option_gzip_decompress,
+        option_hardmask,
+        option_log,
+        option_no_progress,
+        option_notrunclabels,
+        option_output,
+        option_quiet,
+        option_threads,
+        option_wordlength,
+        -1 },
+
       { option_makeudb_usearch,
         option_bzip2_decompress,
         option_dbmask,
         option_gzip_decompress,
         option_hardmask,
+        option_hugepages,
         option_log,
+        option_maxwordfreq,
+        option_minimizer_window,
         option_minseqlength,
         option_no_progress,
         option_notrunclabels,
+        option_numa_interleave,
         option_output,
+        option_pin_threads,
         option_quiet,
         option_threads,
+        option_udb_append,
         option_wordlength,
         -1 },
 
@@ -3611,6 +3832,7 @@ void args_init(int argc, char **argv)
         option_fastaout,
         option_fastqout,
         option_gzip_decompress,
+        option_index_cache,
         option_log,
         option_no_progress,
         option_notmatched,
@@ -3765,10 +3987,15 @@ void args_init(int argc, char **argv)
         option_fastq_qmax,
         option_fastq_qmin,
         option_gzip_decompress,
+        option_hugepages,
+        option_index_cache,
         option_log,
         option_no_progress,
         option_notrunclabels,
+        option_numa_interleave,
+        option_pin_threads,
         option_quiet,
+        option_randseed,
         option_sintax_cutoff,
         option_strand,
         option_tabbedout,
@@ -3834,6 +4061,7 @@ void args_init(int argc, char **argv)
 
       { option_uchime2_denovo,
         option_abskew,
+        option_abskew_prune,
         option_alignwidth,
         option_borderline,
         option_chimeras,
@@ -3872,6 +4100,7 @@ void args_init(int argc, char **argv)
 
       { option_uchime3_denovo,
         option_abskew,
+        option_abskew_prune,
         option_alignwidth,
         option_borderline,
         option_chimeras,
@@ -3910,6 +4139,7 @@ void args_init(int argc, char **argv)
 
       { option_uchime_denovo,
         option_abskew,
+        option_abskew_prune,
         option_alignwidth,
         option_borderline,
         option_chimeras,
@@ -3959,6 +4189,8 @@ void args_init(int argc, char **argv)
         option_gapext,
         option_gapopen,
         option_hardmask,
+        option_hugepages,
+        option_index_cache,
         option_log,
         option_match,
         option_mindiffs,
@@ -3968,6 +4200,8 @@ void args_init(int argc, char **argv)
         option_no_progress,
         option_nonchimeras,
         option_notrunclabels,
+        option_numa_interleave,
+        option_pin_threads,
         option_qmask,
         option_quiet,
         option_relabel,
@@ -4022,6 +4256,7 @@ void args_init(int argc, char **argv)
 
       { option_usearch_global,
         option_alnout,
+        option_bamout,
         option_band,
         option_biomout,
         option_blast6out,
@@ -4030,6 +4265,7 @@ void args_init(int argc, char **argv)
         option_dbmask,
         option_dbmatched,
         option_dbnotmatched,
+        option_dbshard_size,
         option_fasta_width,
         option_fastapairs,
         option_fulldp,
@@ -4037,12 +4273,16 @@ void args_init(int argc, char **argv)
         option_gapopen,
         option_gzip_decompress,
         option_hardmask,
+        option_hitsout,
         option_hspw,
+        option_hugepages,
         option_id,
         option_iddef,
+        option_idoffset_split,
         option_idprefix,
         option_idsuffix,
         option_idoffset,
+        option_index_cache,
         option_leftjust,
         option_log,
         option_match,
@@ -4059,9 +4299,11 @@ void args_init(int argc, char **argv)
         option_maxsizeratio,
         option_maxsl,
         option_maxsubs,
+        option_maxwordfreq,
         option_mid,
         option_mincols,
         option_minhsp,
+        option_minimizer_window,
         option_minqt,
         option_minseqlength,
         option_minsizeratio,
@@ -4073,10 +4315,13 @@ void args_init(int argc, char **argv)
         option_no_progress,
         option_notmatched,
         option_notrunclabels,
+        option_numa_interleave,
         option_otutabout,
         option_output_no_hits,
         option_pattern,
+        option_pin_threads,
         option_qmask,
+        option_query_cache,
         option_query_cov,
         option_quiet,
         option_relabel,
@@ -4220,8 +4465,12 @@ void args_init(int argc, char **argv)
 
   if (opt_allpairs_global || opt_cluster_fast || opt_cluster_size ||
       opt_cluster_smallmem || opt_cluster_unoise || opt_fastq_mergepairs ||
-      opt_fastx_mask || opt_maskfasta || opt_search_exact || opt_sintax ||
-      opt_uchime_ref || opt_usearch_global)
+      opt_fastx_mask || opt_makeudb_usearch || opt_maskfasta ||
+      opt_search_exact || opt_sintax ||
+      opt_uchime_ref || opt_usearch_global ||
+      ((opt_derep_fulllength || opt_derep_id || opt_derep_prefix ||
+        opt_sortbylength || opt_sortbysize) &&
+       (opt_relabel_sha1 || opt_relabel_md5)))
     {
       if (opt_threads == 0)
         {
@@ -4272,7 +4521,7 @@ void args_init(int argc, char **argv)
   if (opt_wordlength == 0)
     {
       /* set default word length */
-      if (opt_orient)
+      if (opt_orient || opt_makeorientmodel)
         {
           opt_wordlength = 12;
         }
@@ -4294,6 +4543,38 @@ void args_init(int argc, char **argv)
 
   if ((opt_idoffset < 0) || (opt_idoffset > 16))
     fatal("The argument to --idoffset must in the range 0 to 16");
+
+  if (opt_shard_count < 1)
+    {
+      fatal("The argument to --shard_count must be at least 1");
+    }
+
+  if ((opt_shard_count > 1) &&
+      (opt_clusters || opt_msaout || opt_consout || opt_profile || opt_samout))
+    {
+      fatal("--shard_count cannot be used with --clusters, --msaout, --consout, --profile or --samout");
+    }
+
+  if (opt_dbshard_size < 0)
+    {
+      fatal("The argument to --dbshard_size must not be negative");
+    }
+
+  if (opt_dbshard_size && ((opt_maxaccepts == 0) || (opt_maxrejects == 0)))
+    {
+      fatal("The --dbshard_size option cannot be used with --maxaccepts 0 or --maxrejects 0");
+    }
+
+  if (opt_minimizer_window == 1)
+    {
+      /* every word is its own minimizer */
+      opt_minimizer_window = 0;
+    }
+
+  if ((opt_maxwordfreq <= 0.0) || (opt_maxwordfreq > 1.0))
+    {
+      fatal("The argument to --maxwordfreq must be larger than 0 and at most 1");
+    }
 #if 0
 
   if (opt_match <= 0)
@@ -4611,11 +4892,14 @@ void cmd_help()
               "  --fasta_width INT           width of FASTA seq lines, 0 for no wrap (80)\n"
               "  --gzip_decompress           decompress input with gzip (required if pipe)\n"
               "  --help | -h                 display help information\n"
+              "  --hugepages                 use huge pages for the k-mer index and counters\n"
               "  --log FILENAME              write messages, timing and memory info to file\n"
               "  --maxseqlength INT          maximum sequence length (50000)\n"
               "  --minseqlength INT          min seq length (clust/derep/search: 32, other:1)\n"
               "  --no_progress               do not show progress indicator\n"
               "  --notrunclabels             do not truncate labels at first space\n"
+              "  --numa_interleave           spread the k-mer index over the NUMA nodes\n"
+              "  --pin_threads               bind threads to CPUs, spread over NUMA nodes\n"
               "  --quiet                     output just warnings and fatal errors to stderr\n"
               "  --threads INT               number of threads to use, zero for all cores (0)\n"
               "  --version | -v              display version information\n"
@@ -4627,8 +4911,10 @@ void cmd_help()
               "  --uchime_ref FILENAME       detect chimeras using a reference database\n"
               " Data\n"
               "  --db FILENAME               reference database for --uchime_ref\n"
+              "  --index_cache DIRECTORY     save/reuse the db index in the given directory\n"
               " Parameters\n"
               "  --abskew REAL               minimum abundance ratio (2.0, 16.0 for uchime3)\n"
+              "  --abskew_prune              skip k-mer counting for parents failing abskew\n"
               "  --dn REAL                   'no' vote pseudo-count (1.4)\n"
               "  --mindiffs INT              minimum number of differences in segment (3) *\n"
               "  --mindiv REAL               minimum divergence from closest parent (0.8) *\n"
@@ -4659,12 +4945,16 @@ void cmd_help()
               "  --cluster_size FILENAME     cluster sequences after sorting by abundance\n"
               "  --cluster_smallmem FILENAME cluster already sorted sequences (see -usersort)\n"
               "  --cluster_unoise FILENAME   denoise Illumina amplicon reads\n"
+              " Data\n"
+              "  --clusterdb FILENAME        centroids (FASTA/UDB) of earlier run to extend\n"
               " Parameters (most searching options also apply)\n"
               "  --cons_truncate             do not ignore terminal gaps in MSA for consensus\n"
               "  --id REAL                   reject if identity lower, accepted values: 0-1.0\n"
               "  --iddef INT                 id definition, 0-4=CD-HIT,all,int,MBL,BLAST (2)\n"
               "  --idoffset INT              id offset (0)\n"
+              "  --idoffset_split            align each side of idoffset Ns separately\n"
               "  --qmask none|dust|soft      mask seqs with dust, soft or no method (dust)\n"
+              "  --shard_count INT           cluster the input in this many shards (1)\n"
               "  --sizein                    propagate abundance annotation from input\n"
               "  --strand plus|both          cluster using plus or both strands (plus)\n"
               "  --usersort                  indicate sequences not pre-sorted by length\n"
@@ -4673,6 +4963,7 @@ void cmd_help()
               " Output\n"
               "  --biomout FILENAME          filename for OTU table output in biom 1.0 format\n"
               "  --centroids FILENAME        output centroid sequences to FASTA file\n"
+              "  --clusterdbout FILENAME     write all centroids with updated sizes to UDB\n"
               "  --clusterout_id             add cluster id info to consout and profile files\n"
               "  --clusterout_sort           order msaout, consout, profile by decr abundance\n"
               "  --clusters STRING           output each cluster to a separate FASTA file\n"
@@ -4762,6 +5053,15 @@ void cmd_help()
               "  --log FILENAME              output file for fastq_stats statistics\n"
               "  --output FILENAME           output file for fastq_eestats(2) statistics\n"
               "\n"
+              "Hits file conversion\n"
+              "  --hits2text FILENAME        convert binary hits file from --hitsout to text\n"
+              " Parameters\n"
+              "  --output_no_hits            output non-matching queries to output files\n"
+              "  --userfields STRING         fields to output in userout file\n"
+              " Output\n"
+              "  --blast6out FILENAME        filename for blast-like tab-separated output\n"
+              "  --userout FILENAME          filename for user-defined tab-separated output\n"
+              "\n"
               "Masking (new)\n"
               "  --fastx_mask FILENAME       mask sequences in the given FASTA or FASTQ file\n"
               " Parameters\n"
@@ -4788,7 +5088,9 @@ void cmd_help()
               "  --orient FILENAME           orient sequences in given FASTA/FASTQ file\n"
               " Data\n"
               "  --db FILENAME               database of sequences in correct orientation\n"
+              "                              (FASTA, FASTQ, UDB or orientation model file)\n"
               "  --dbmask none|dust|soft     mask db seqs with dust, soft or no method (dust)\n"
+              "  --index_cache DIRECTORY     save/reuse the db index in the given directory\n"
               "  --qmask none|dust|soft      mask query with dust, soft or no method (dust)\n"
               "  --wordlength INT            length of words used for matching 3-15 (12)\n"
               " Output\n"
@@ -4797,6 +5099,14 @@ void cmd_help()
               "  --notmatched FILENAME       output filename for undetermined sequences\n"
               "  --tabbedout FILENAME        output filename for result information\n"
               "\n"
+              "Orientation model\n"
+              "  --makeorientmodel FILENAME  save k-mer counts of FASTA/FASTQ/UDB db for orient\n"
+              " Parameters\n"
+              "  --dbmask none|dust|soft     mask db seqs with dust, soft or no method (dust)\n"
+              "  --wordlength INT            length of words used for matching 3-15 (12)\n"
+              " Output\n"
+              "  --output FILENAME           output to specified orientation model file\n"
+              "\n"
               "Paired-end reads joining\n"
               "  --fastq_join FILENAME       join paired-end reads into one sequence with gap\n"
               "  --fastq_join2 FILENAME      join paired-end reads into one sequence with gap\n"
@@ -4873,8 +5183,10 @@ void cmd_help()
               "  --usearch_global FILENAME   filename of queries for global alignment search\n"
               " Data\n"
               "  --db FILENAME               name of UDB or FASTA database for search\n"
+              "  --index_cache DIRECTORY     save/reuse the db index in the given directory\n"
               " Parameters\n"
               "  --dbmask none|dust|soft     mask db with dust, soft or no method (dust)\n"
+              "  --dbshard_size INT          search db in shards of about INT MB memory\n"
               "  --fulldp                    full dynamic programming alignment (always on)\n"
               "  --gapext STRING             penalties for gap extension (2I/1E)\n"
               "  --gapopen STRING            penalties for gap opening (20I/2E)\n"
@@ -4882,6 +5194,7 @@ void cmd_help()
               "  --id REAL                   reject if identity lower\n"
               "  --iddef INT                 id definition, 0-4=CD-HIT,all,int,MBL,BLAST (2)\n"
               "  --idoffset INT              id offset (0)\n"
+              "  --idoffset_split            align each side of idoffset Ns separately\n"
               "  --idprefix INT              reject if first n nucleotides do not match\n"
               "  --idsuffix INT              reject if last n nucleotides do not match\n"
               "  --leftjust                  reject if terminal gaps at alignment left end\n"
@@ -4897,8 +5210,10 @@ void cmd_help()
               "  --maxsizeratio REAL         reject if query/target abundance ratio higher\n"
               "  --maxsl REAL                reject if shorter/longer length ratio higher\n"
               "  --maxsubs INT               reject if more substitutions\n"
+              "  --maxwordfreq REAL          ignore words in a larger fraction of db seqs (1.0)\n"
               "  --mid REAL                  reject if percent identity lower, ignoring gaps\n"
               "  --mincols INT               reject if alignment length shorter\n"
+              "  --minimizer_window INT      index only minimizers of windows of INT words\n"
               "  --minqt REAL                reject if query/target length ratio lower\n"
               "  --minsizeratio REAL         reject if query/target abundance ratio lower\n"
               "  --minsl REAL                reject if shorter/longer length ratio lower\n"
@@ -4907,6 +5222,7 @@ void cmd_help()
               "  --mismatch INT              score for mismatch (-4)\n"
               "  --pattern STRING            option is ignored\n"
               "  --qmask none|dust|soft      mask query with dust, soft or no method (dust)\n"
+              "  --query_cache               search identical queries only once\n"
               "  --query_cov REAL            reject if fraction of query seq. aligned lower\n"
               "  --rightjust                 reject if terminal gaps at alignment right end\n"
               "  --sizein                    propagate abundance annotation from input\n"
@@ -4919,11 +5235,13 @@ void cmd_help()
               "  --wordlength INT            length of words for database index 3-15 (8)\n"
               " Output\n"
               "  --alnout FILENAME           filename for human-readable alignment output\n"
+              "  --bamout FILENAME           filename for BAM format output\n"
               "  --biomout FILENAME          filename for OTU table output in biom 1.0 format\n"
               "  --blast6out FILENAME        filename for blast-like tab-separated output\n"
               "  --dbmatched FILENAME        FASTA file for matching database sequences\n"
               "  --dbnotmatched FILENAME     FASTA file for non-matching database sequences\n"
               "  --fastapairs FILENAME       FASTA file with pairs of query and target\n"
+              "  --hitsout FILENAME          binary columnar hits file, see --hits2text\n"
               "  --matched FILENAME          FASTA file for matching query sequences\n"
               "  --mothur_shared_out FN      filename for OTU table output in mothur format\n"
               "  --notmatched FILENAME       FASTA file for non-matching query sequences\n"
@@ -4986,6 +5304,8 @@ void cmd_help()
               "  --sintax FILENAME           classify sequences in given FASTA/FASTQ file\n"
               " Parameters\n"
               "  --db FILENAME               taxonomic reference db in given FASTA or UDB file\n"
+              "  --index_cache DIRECTORY     save/reuse the db index in the given directory\n"
+              "  --randseed INT              seed for PRNG, zero to use random data source (0)\n"
               "  --sintax_cutoff REAL        confidence value cutoff level (0.0)\n"
               " Output\n"
               "  --tabbedout FILENAME        write results to given tab-delimited file\n"
@@ -5038,6 +5358,9 @@ void cmd_help()
               " Parameters\n"
               "  --dbmask none|dust|soft     mask db with dust, soft or no method (dust)\n"
               "  --hardmask                  mask by replacing with N instead of lower case\n"
+              "  --maxwordfreq REAL          ignore words in a larger fraction of db seqs (1.0)\n"
+              "  --minimizer_window INT      index only minimizers of windows of INT words\n"
+              "  --udb_append FILENAME       add the new sequences to given UDB file\n"
               "  --wordlength INT            length of words for database index 3-15 (8)\n"
               " Output\n"
               "  --output FILENAME           UDB or FASTA output file\n"
@@ -5075,7 +5398,8 @@ void cmd_usearch_global()
       (!opt_dbmatched) && (!opt_dbnotmatched) &&
       (!opt_samout) && (!opt_otutabout) &&
       (!opt_biomout) && (!opt_mothur_shared_out) &&
-      (!opt_fastapairs))
+      (!opt_fastapairs) && (!opt_hitsout) &&
+      (!opt_bamout))
     {
       fatal("No output files specified");
     }
@@ -5247,6 +5571,24 @@ void cmd_udb2fasta()
   udb_fasta();
 }
 
+void cmd_makeorientmodel()
+{
+  if (!opt_output)
+    {
+      fatal("Output file for orientation model must be specified with --output");
+    }
+  orient_makemodel();
+}
+
+void cmd_hits2text()
+{
+  if ((!opt_userout) && (!opt_blast6out))
+    {
+      fatal("Output file must be specified with --userout or --blast6out");
+    }
+  hitsout_convert();
+}
+
 void cmd_fastx_mask()
 {
   if ((!opt_fastaout) && (!opt_fastqout))
@@ -5295,9 +5637,9 @@ void cmd_none()
               "\n"
               "Other commands: cluster_fast, cluster_smallmem, cluster_unoise, cut, derep_id,\n"
               "                derep_prefix, fastq_filter, fastq_join, fastq_join2,\n"
-              "                fastx_getseqs, fastx_getsubseqs, maskfasta, orient,\n"
-              "                rereplicate, uchime2_denovo, uchime3_denovo, udb2fasta,\n"
-              "                udbinfo, udbstats, version\n"
+              "                fastx_getseqs, fastx_getsubseqs, hits2text, makeorientmodel,\n"
+              "                maskfasta, orient, rereplicate, uchime2_denovo,\n"
+              "                uchime3_denovo, udb2fasta, udbinfo, udbstats, version\n"
               "\n",
               progname);
     }
@@ -5332,7 +5674,7 @@ void cmd_cluster()
       (!opt_consout) && (!opt_msaout) &&
       (!opt_samout) && (!opt_profile) &&
       (!opt_otutabout) && (!opt_biomout) &&
-      (!opt_mothur_shared_out))
+      (!opt_mothur_shared_out) && (!opt_clusterdbout))
     {
       fatal("No output files specified");
     }
@@ -5507,6 +5849,8 @@ int main(int argc, char** argv)
 
   dynlibs_open();
 
+  arch_pin_init();
+
 #ifdef __x86_64__
   if (!sse2_present)
     {
@@ -5666,6 +6010,14 @@ int main(int argc, char** argv)
     {
       fasta2fastq();
     }
+  else if (opt_hits2text)
+    {
+      cmd_hits2text();
+    }
+  else if (opt_makeorientmodel)
+    {
+      cmd_makeorientmodel();
+    }
   else
     {
       cmd_none();
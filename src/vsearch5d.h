@@ -87,14 +87,6 @@
 #include <set>
 #include <string>
 
-/* include appropriate regex library */
-
-#ifdef HAVE_REGEX_H
-#include <regex.h>
-#else
-#include <regex>
-#endif
-
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/time.h>
@@ -159,6 +151,9 @@
 #include <sys/sysinfo.h>
 #include <byteswap.h>
 #include <sys/resource.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sched.h>
 
 #elif __FreeBSD__
 
@@ -222,6 +217,7 @@
 #include "unique.h"
 #include "bitmap.h"
 #include "dbindex.h"
+#include "dbcache.h"
 #include "minheap.h"
 #include "search.h"
 #include "linmemalign.h"
@@ -232,6 +228,7 @@
 #include "sortbysize.h"
 #include "sortbylength.h"
 #include "derep.h"
+#include "digest.h"
 #include "shuffle.h"
 #include "mask.h"
 #include "cluster.h"
@@ -260,9 +257,13 @@
 #include "cut.h"
 #include "orient.h"
 #include "fa2fq.h"
+#include "hitsout.h"
+#include "bgzf.h"
+#include "bam.h"
 
 /* options */
 
+extern bool opt_abskew_prune;
 extern bool opt_bzip2_decompress;
 extern bool opt_clusterout_id;
 extern bool opt_clusterout_sort;
@@ -272,8 +273,13 @@ extern bool opt_fastq_allowmergestagger;
 extern bool opt_fastq_eeout;
 extern bool opt_fastq_nostagger;
 extern bool opt_gzip_decompress;
+extern bool opt_hugepages;
+extern bool opt_idoffset_split;
 extern bool opt_label_substr_match;
 extern bool opt_no_progress;
+extern bool opt_numa_interleave;
+extern bool opt_pin_threads;
+extern bool opt_query_cache;
 extern bool opt_quiet;
 extern bool opt_relabel_keep;
 extern bool opt_relabel_md5;
@@ -286,6 +292,7 @@ extern bool opt_xee;
 extern bool opt_xsize;
 extern char * opt_allpairs_global;
 extern char * opt_alnout;
+extern char * opt_bamout;
 extern char * opt_biomout;
 extern char * opt_blast6out;
 extern char * opt_borderline;
@@ -295,6 +302,8 @@ extern char * opt_cluster_fast;
 extern char * opt_cluster_size;
 extern char * opt_cluster_smallmem;
 extern char * opt_cluster_unoise;
+extern char * opt_clusterdb;
+extern char * opt_clusterdbout;
 extern char * opt_clusters;
 extern char * opt_consout;
 extern char * opt_cut;
@@ -336,6 +345,9 @@ extern char * opt_fastx_getsubseq;
 extern char * opt_fastx_mask;
 extern char * opt_fastx_revcomp;
 extern char * opt_fastx_subsample;
+extern char * opt_hits2text;
+extern char * opt_hitsout;
+extern char * opt_index_cache;
 extern char * opt_join_padgap;
 extern char * opt_join_padgapq;
 extern char * opt_label;
@@ -345,6 +357,7 @@ extern char * opt_label_word;
 extern char * opt_label_words;
 extern char * opt_label_field;
 extern char * opt_log;
+extern char * opt_makeorientmodel;
 extern char * opt_makeudb_usearch;
 extern char * opt_maskfasta;
 extern char * opt_matched;
@@ -377,6 +390,7 @@ extern char * opt_uchime_ref;
 extern char * opt_uchimealns;
 extern char * opt_uchimeout;
 extern char * opt_udb2fasta;
+extern char * opt_udb_append;
 extern char * opt_udbinfo;
 extern char * opt_udbstats;
 extern char * opt_usearch_global;
@@ -394,6 +408,7 @@ extern double opt_maxid;
 extern double opt_maxqt;
 extern double opt_maxsizeratio;
 extern double opt_maxsl;
+extern double opt_maxwordfreq;
 extern double opt_mid;
 extern double opt_min_unmasked_pct;
 extern double opt_mindiv;
@@ -434,6 +449,7 @@ extern int opt_uchimeout5;
 extern int opt_usersort;
 extern int opt_version;
 extern int64_t opt_dbmask;
+extern int64_t opt_dbshard_size;
 extern int64_t opt_fasta_width;
 extern int64_t opt_fastq_ascii;
 extern int64_t opt_fastq_asciiout;
@@ -472,6 +488,7 @@ extern int64_t opt_maxsize;
 extern int64_t opt_maxsubs;
 extern int64_t opt_maxuniquesize;
 extern int64_t opt_mincols;
+extern int64_t opt_minimizer_window;
 extern int64_t opt_minseqlength;
 extern int64_t opt_minsize;
 extern int64_t opt_mintsize;
@@ -487,6 +504,7 @@ extern int64_t opt_rowlen;
 extern int64_t opt_sample_size;
 extern int64_t opt_self;
 extern int64_t opt_selfid;
+extern int64_t opt_shard_count;
 extern int64_t opt_sizein;
 extern int64_t opt_sizeout;
 extern int64_t opt_strand;